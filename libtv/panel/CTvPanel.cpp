@@ -15,7 +15,13 @@
 #include <CTvLog.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <tvutils.h>
+#include <CFlashDevice.h>
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h>
 
@@ -32,24 +38,87 @@ CTvPanel *CTvPanel::getInstance()
 
 CTvPanel::CTvPanel()
 {
-
 }
 CTvPanel::~CTvPanel()
 {
-
+    PANEL_SpiClose();
 }
 int CTvPanel::PANEL_Flash_Read(const char *partition_name, long offset,unsigned char *buffer, unsigned int length) {
     return tvFlashRead(partition_name, offset, buffer, length);
 }
 
 int CTvPanel::PANEL_Flash_Write(const char *partition_name, long offset,unsigned char *buffer, unsigned int length) {
-    return tvFlashWrite(partition_name, offset, buffer, length);
+    if (offset != 0) {
+        return tvFlashWrite(partition_name, offset, buffer, length);
+    }
+    if (partition_name == NULL || buffer == NULL) {
+        LOGE("%s, illegal parameter, null pointer.", __FUNCTION__);
+        return -1;
+    }
+
+    //whole file: write a temp file and rename it over, so a reboot in the
+    //middle never leaves a torn table or the tail of an older, longer one
+    char tmp_path[PATH_MAX] = {0};
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", partition_name);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        LOGE("%s, open file %s error(%s)", __FUNCTION__, tmp_path, strerror(errno));
+        return -1;
+    }
+    unsigned int done = 0;
+    while (done < length) {
+        ssize_t n = write(fd, buffer + done, length - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGE("%s, write error(%s)", __FUNCTION__, strerror(errno));
+            close(fd);
+            unlink(tmp_path);
+            return -1;
+        }
+        done += n;
+    }
+    if (fsync(fd) != 0 || close(fd) != 0) {
+        LOGE("%s, sync %s error(%s)", __FUNCTION__, tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    if (rename(tmp_path, partition_name) != 0) {
+        LOGE("%s, rename to %s error(%s)", __FUNCTION__, partition_name, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    char dir_path[PATH_MAX] = {0};
+    snprintf(dir_path, sizeof(dir_path), "%s", partition_name);
+    char *slash = strrchr(dir_path, '/');
+    if (slash != NULL) {
+        *slash = 0;
+        int dir_fd = open(dir_path[0] ? dir_path : "/", O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+    return 0;
+}
+
+int CTvPanel::PANEL_SpiRead(unsigned int offset, unsigned int length, unsigned char *buffer) {
+    return tvSpiRead(offset, length, buffer);
+}
+
+void CTvPanel::PANEL_SpiClose() {
+    CFlashDevice *dev = CFlashDevice::getSpiFlash();
+    if (dev != NULL) {
+        dev->dropCache();
+    }
 }
 
 int CTvPanel::AM_PANEL_Init()
 {
     LOGD("%s, AM_PANEL_Init entering\n",__FUNCTION__);
     PANEL_SIZE_CHOICE();
+    PANEL_SpiClose();
     return 0;
 }
 
@@ -208,7 +277,7 @@ int CTvPanel::PANEL_43D10_data_Conversion(unsigned int offset,const char *partit
     unsigned int data_size = 0x9B9D0;                        //LUT SIZE IN FLASH
     unsigned int ulength=36;
     unsigned char Parameter[36] = {0x0};
-    int fdread1=tvSpiRead(offset, ulength, Parameter);
+    int fdread1=PANEL_SpiRead(offset, ulength, Parameter);
     if (fdread1<0)
     {
         LOGE("%s,TvSpiRead Failed!\n", __FUNCTION__);
@@ -233,7 +302,7 @@ int CTvPanel::PANEL_43D10_data_Conversion(unsigned int offset,const char *partit
         return -1;
     }
     //tvSpiRead(36, data_size, lutbuffer);
-    int ret1 = tvSpiRead(36, data_size, lutbuffer);
+    int ret1 = PANEL_SpiRead(offset + 36, data_size, lutbuffer);
     if (ret1 < 0) {
         LOGE("%s, read lutbuffer Failed!\n", __FUNCTION__);
         free(lutbuffer);
@@ -277,27 +346,21 @@ int CTvPanel::PANEL_43D10_data_Conversion(unsigned int offset,const char *partit
     }
     free(crc_buffer);
     crc_buffer = NULL;
-    free(lutbuffer);
-    lutbuffer = NULL;
 
+    //parameters and lut were read above, no need to read them again
     unsigned int ulength1=data_size+36;
     unsigned char *buffer = NULL;
     buffer = (unsigned char *)malloc(ulength1*sizeof(unsigned char));
     if (buffer == NULL) {
         ALOGE("%s,Malloc memory failed!\n", __FUNCTION__);
+        free(lutbuffer);
+        lutbuffer = NULL;
         return -1;
     }
-    int fdread2=tvSpiRead(offset, ulength1, buffer);
-
-    if (fdread2<0)
-    {
-        LOGE("%s,tvSpiRead Failed!\n", __FUNCTION__);
-        free(buffer);
-        buffer = NULL;
-        return -1;
-    } else {
-        LOGD("%s,fdread2 IS %d\n", __FUNCTION__, fdread2);
-    }
+    memcpy(buffer, Parameter, 36);
+    memcpy(buffer + 36, lutbuffer, data_size);
+    free(lutbuffer);
+    lutbuffer = NULL;
 
     int a,b;
     int m,n,k;
@@ -551,7 +614,7 @@ int CTvPanel::PANEL_50INX_data_Conversion(const char *partition_name_Table_data,
         }
 
     unsigned char address_buffer[2] = {0x0};
-    int fdread = tvSpiRead(46,2,address_buffer);
+    int fdread = PANEL_SpiRead(46,2,address_buffer);
     if (fdread<0)
     {
         LOGE("%s,tvSpiRead Failed!\n", __FUNCTION__);
@@ -561,7 +624,7 @@ int CTvPanel::PANEL_50INX_data_Conversion(const char *partition_name_Table_data,
     LOGE("%s,address = 0x%x!\n", __FUNCTION__,address);
 
     unsigned char  data_size[3] = {0x0};
-    fdread = tvSpiRead(49,3,data_size);
+    fdread = PANEL_SpiRead(49,3,data_size);
     if (fdread<0)
     {
         LOGE("%s,tvSpiRead Failed!\n", __FUNCTION__);
@@ -578,7 +641,7 @@ int CTvPanel::PANEL_50INX_data_Conversion(const char *partition_name_Table_data,
         LOGE("%s,Malloc memory failed!\n", __FUNCTION__);
         return -1;
     }
-    fdread=tvSpiRead(address, LUT_SIZE_ALL_50, all_buffer_1);
+    fdread=PANEL_SpiRead(address, LUT_SIZE_ALL_50, all_buffer_1);
     if (fdread<0)
     {
         LOGE("%s,tvSpiRead Failed!\n", __FUNCTION__);
@@ -588,7 +651,7 @@ int CTvPanel::PANEL_50INX_data_Conversion(const char *partition_name_Table_data,
     }
     //crc
     unsigned char crc_buffer[2] = {0x0};
-    fdread = tvSpiRead(0x2a,2,crc_buffer);
+    fdread = PANEL_SpiRead(0x2a,2,crc_buffer);
     if (fdread<0)
     {
         LOGE("%s,tvSpiRead crc Failed!\n", __FUNCTION__);
@@ -1141,7 +1204,7 @@ int CTvPanel::PANEL_50INX_data_Conversion(const char *partition_name_Table_data,
 
     unsigned char plane[6] = {0x0};
 
-    ret = tvSpiRead(0x71,6,plane);
+    ret = PANEL_SpiRead(0x71,6,plane);
     if (ret < 0)
     {
         LOGE("%s,AML_HAL_SPI_Read for which plane is valid Failed!\n", __FUNCTION__);
@@ -1309,7 +1372,7 @@ int CTvPanel::PANEL_50T01_data_Conversion(const char *partition_name_Table_data,
         return -1;
     }
     memset(buffer_flash_lut, 0x0, sizeof(unsigned char) * LUT_SIZE_FLASH_50T01);
-    if (0 > tvSpiRead(0x42,LUT_SIZE_FLASH_50T01,buffer_flash_lut)) {
+    if (0 > PANEL_SpiRead(0x42,LUT_SIZE_FLASH_50T01,buffer_flash_lut)) {
         LOGE("%s,buffer_flash_lut read flash failed\n",__FUNCTION__);
         free(buffer_flash_lut);
         buffer_flash_lut = NULL;
@@ -1321,7 +1384,7 @@ int CTvPanel::PANEL_50T01_data_Conversion(const char *partition_name_Table_data,
     crc address start in 0x40 in flash,length is 2
     */
     unsigned char buffer_crc[2] = {0x0};
-    if (0 > tvSpiRead(0x40,2,buffer_crc)) {
+    if (0 > PANEL_SpiRead(0x40,2,buffer_crc)) {
         LOGE("%s,buffer_crc read flash failed\n",__FUNCTION__);
         free(buffer_flash_lut);
         buffer_flash_lut = NULL;
@@ -1457,7 +1520,7 @@ int CTvPanel::PANEL_65D02_3_data_Conversion(const char *partition_name_Table_dat
 
     memset(flash_info, 0x0, sizeof(unsigned char)*INFO_LEN_65D2_3);
 
-    fdread=tvSpiRead(0,INFO_LEN_65D2_3,flash_info);
+    fdread=PANEL_SpiRead(0,INFO_LEN_65D2_3,flash_info);
     if (fdread < 0) {
         LOGD("%s,tvSpiRead info failed\n",__FUNCTION__);
         free(flash_info);
@@ -1516,7 +1579,7 @@ int CTvPanel::PANEL_65D02_3_data_Conversion(const char *partition_name_Table_dat
 
     memset(flash_demura, 0x0, sizeof(unsigned char)*LUT_LEN_65D2_3);
 
-    fdread = tvSpiRead(LUT_OFFSET, LUT_LEN_65D2_3, flash_demura);
+    fdread = PANEL_SpiRead(LUT_OFFSET, LUT_LEN_65D2_3, flash_demura);
     if (fdread < 0) {
         ALOGD("%s,tvSpiRead lut failed\n",__FUNCTION__);
         free(flash_demura);
@@ -1664,7 +1727,7 @@ int CTvPanel::PANEL_65D02_H_data_Conversion(const char *partition_name_Table_dat
     }
 
     unsigned int offset_1 = 0x200;
-    int fdread=tvSpiRead( offset_1, data_size, buffer);
+    int fdread=PANEL_SpiRead( offset_1, data_size, buffer);
     if (fdread<0)
     {
         free(buffer);
@@ -1674,7 +1737,7 @@ int CTvPanel::PANEL_65D02_H_data_Conversion(const char *partition_name_Table_dat
     }
 
     unsigned char crc_buffer[2] = {0x0};
-    fdread=tvSpiRead(0x99, 2, crc_buffer);
+    fdread=PANEL_SpiRead(0x99, 2, crc_buffer);
     if (fdread<0)
     {
         free(buffer);
@@ -1965,49 +2028,23 @@ int CTvPanel::PANEL_55SDC_data_Conversion(const char *partition_name_Table_data,
     memset(flash_demura, 0, DEMURA_FLASH_LEN);
 
     for (int j = 0; j < 3; j++) {
-        memset(flash_demura,0,DEMURA_FLASH_LEN);
         check = 0;
         check_sum_mura = 0;
 
-        for (int i = 0; i < 892; i++) {
-            if (i == 891) {
-                //tvSpiRead((DEMURA_FLASH_ADDR+1024*i),81,(flash_demura+1024*i));
-                ret = tvSpiRead((DEMURA_FLASH_ADDR+1024*i),81,(flash_demura+1024*i));
-                if (ret < 0) {
-                    LOGE("%s, flash_demura_81 Failed!\n", __FUNCTION__);
-                     free(Demura_Data);
-                     Demura_Data = NULL;
-                     free(flash_demura);
-                     flash_demura = NULL;
-                    return -1;
-                }
-            } else {
-                //tvSpiRead((DEMURA_FLASH_ADDR+1024*i),1024,(flash_demura+1024*i));
-                ret = tvSpiRead((DEMURA_FLASH_ADDR+1024*i),1024,(flash_demura+1024*i));
-                if (ret < 0) {
-                    LOGE("%s, flash_demura_1024 Failed!\n", __FUNCTION__);
-                    free(Demura_Data);
-                    Demura_Data = NULL;
-                    free(flash_demura);
-                    flash_demura = NULL;
-                    return -1;
-                }
-            }
-        }
-        for (int i = 0; i< (DEMURA_FLASH_LEN - 1); i++) {
-            check_sum_mura += flash_demura[i];
-        }
-        check = 0xFC - check_sum_mura;
-        //tvSpiRead(0x12FC50,1,(flash_demura+912464));
-        ret = tvSpiRead(0x12FC50,1,(flash_demura+912464));
-        if (ret < 0) {
-            LOGE("%s, flash_demura_1 Failed!\n", __FUNCTION__);
+        //the whole table with its checksum byte at 0x12FC50 in one read
+        ret = PANEL_SpiRead(DEMURA_FLASH_ADDR, DEMURA_FLASH_LEN, flash_demura);
+        if (ret != DEMURA_FLASH_LEN) {
+            LOGE("%s, flash_demura Failed!\n", __FUNCTION__);
             free(Demura_Data);
             Demura_Data = NULL;
             free(flash_demura);
             flash_demura = NULL;
             return -1;
         }
+        for (int i = 0; i< (DEMURA_FLASH_LEN - 1); i++) {
+            check_sum_mura += flash_demura[i];
+        }
+        check = 0xFC - check_sum_mura;
         demura_check_count++;
 
         if (flash_demura[912464] == check) {
@@ -2032,7 +2069,7 @@ int CTvPanel::PANEL_55SDC_data_Conversion(const char *partition_name_Table_data,
         check_sum_para = 0;
         check_p = 0;
         //tvSpiRead(GAIN_FLASH_ADDR, 129, tmp);
-        ret = tvSpiRead(GAIN_FLASH_ADDR, 129, tmp);
+        ret = PANEL_SpiRead(GAIN_FLASH_ADDR, 129, tmp);
         if (ret < 0) {
             LOGE("%s,GAIN_FLASH_ADDR Failed!\n", __FUNCTION__);
             free(Demura_Data);
@@ -2150,7 +2187,7 @@ int CTvPanel::PANEL_55SDC_Acc_Conversion(const char *partition_name_Table_ACC) {
     }
 
     //read acc data in flash
-    ret = tvSpiRead(0x1FA000,ACC_FLASH_LEN, ACC_Data);
+    ret = PANEL_SpiRead(0x1FA000,ACC_FLASH_LEN, ACC_Data);
     if (ret < 0) {
         LOGE("%s,AML_HAL_SPI_Read Failed!\n", __FUNCTION__);
         free(ACC_Data_12);
@@ -2269,7 +2306,7 @@ int CTvPanel::PANEL_AutoFlicker(void) {
     int data[4];
 
     //read Dvr value;
-    ret=tvSpiRead(0x10000,8, tmp);
+    ret=PANEL_SpiRead(0x10000,8, tmp);
     if (ret < 0) {
         LOGE("%s,AML_HAL_SPI_Read flicker Failed!\n", __FUNCTION__);
         return -1;
@@ -2330,7 +2367,7 @@ int CTvPanel::PANEL_SPI_PGAMMA(int spi_offset, int spi_len ,const char *spi_bin_
 
     LOGD("%s,p_gamma len = %d.\n", __FUNCTION__,spi_len);
     unsigned char buffer[PANEL_BUFFER_MAX_LEN] = {0x0};
-    int ret = tvSpiRead(spi_offset, spi_len, buffer);
+    int ret = PANEL_SpiRead(spi_offset, spi_len, buffer);
     if (ret < 0) {
         LOGE("%s,Read spi flash failed!\n", __FUNCTION__);
         PANEL_REMOVE_BIN_FILE(1);
@@ -2396,7 +2433,7 @@ int CTvPanel::PANEL_SPI_PGAMMA_SPEC(int spi_offset, int spi_len ,const char *spi
 
     LOGD("%s,p_gamma len = %d.\n", __FUNCTION__,spi_len);
     unsigned char buffer[PANEL_BUFFER_MAX_LEN] = {0x0};
-    int ret = tvSpiRead(spi_offset, spi_len, buffer);
+    int ret = PANEL_SpiRead(spi_offset, spi_len, buffer);
     if (ret < 0) {
         LOGE("%s,Read spi flash failed!\n", __FUNCTION__);
         PANEL_REMOVE_BIN_FILE(1);
@@ -2522,7 +2559,7 @@ int CTvPanel::PANEL_SPI_PGAMMA_SPEC_65D02_3(int spi_offset, int spi_len ,const c
 
     LOGD("%s,p_gamma len = %d.\n", __FUNCTION__,spi_len);
     unsigned char buffer[PANEL_BUFFER_MAX_LEN] = {0x0};
-    int ret = tvSpiRead(spi_offset, spi_len, buffer);
+    int ret = PANEL_SpiRead(spi_offset, spi_len, buffer);
     if (ret < 0) {
         LOGE("%s,Read spi flash failed!\n", __FUNCTION__);
         PANEL_REMOVE_BIN_FILE(1);
@@ -2741,7 +2778,7 @@ int CTvPanel::PANEL_BIN_FILE_CEHCK(int address_1,int address_2 __unused, int add
     unsigned char crc_sdc_check[4]= {0x0};
 
     if (len_1 != 0 && len_2 == 0 && len_3 == 0 && len_4 == 0) {
-        ret = tvSpiRead(address_1, len_1, crc_data);
+        ret = PANEL_SpiRead(address_1, len_1, crc_data);
         if (ret < 0)
         {
             LOGE("%s,AML_HAL_SPI_Read1 Failed!\n", __FUNCTION__);
@@ -2773,17 +2810,17 @@ int CTvPanel::PANEL_BIN_FILE_CEHCK(int address_1,int address_2 __unused, int add
     } else if ( len_1 != 0 && len_2 != 0 && len_3 != 0 && len_4 == 0) {
         LOGD("%s,crc_sdc check,len1:%x,len2:%x,len3:%x\n", __FUNCTION__, len_1, len_2, len_3);
 
-        ret = tvSpiRead(0x10004, 2, crc_sdc_data);
+        ret = PANEL_SpiRead(0x10004, 2, crc_sdc_data);
         if (ret < 0) {
             LOGD("%s,AML_HAL_SPI_Read1 Failed!\n", __FUNCTION__);
             return -1;
         }
-        ret = tvSpiRead(0x12fc50, 1, crc_sdc_data+2);
+        ret = PANEL_SpiRead(0x12fc50, 1, crc_sdc_data+2);
         if (ret < 0) {
             LOGD("%s,AML_HAL_SPI_Read2 Failed!\n", __FUNCTION__);
             return -1;
         }
-        ret = tvSpiRead(0x1FB800, 1, crc_sdc_data+3);
+        ret = PANEL_SpiRead(0x1FB800, 1, crc_sdc_data+3);
         if (ret < 0) {
             LOGD("%s,AML_HAL_SPI_Read3 Failed!\n", __FUNCTION__);
             return -1;
@@ -2804,36 +2841,116 @@ int CTvPanel::PANEL_BIN_FILE_CEHCK(int address_1,int address_2 __unused, int add
 }
 
 
+/*
+the panel crcs as lookup tables, built once: CalcCRC16 and the 43 crc are
+the same msb first crc16 (poly 0x8005), CalcCRC16 takes 8 bytes per step.
+The 50T01 and 50INX crcs are bit serial xor networks, so one byte step is
+the xor of a table of the old crc and a table of the data byte.
+*/
+static const unsigned short CRC16_TABLE[256] = {
+        0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011, 0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022, 0x8063, 0x0066, 0x006C, 0x8069,
+        0x0078, 0x807D, 0x8077, 0x0072, 0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041, 0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+        0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1, 0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1, 0x8093, 0x0096, 0x009C, 0x8099,
+        0x0088, 0x808D, 0x8087, 0x0082, 0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192, 0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+        0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1, 0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2, 0x0140, 0x8145, 0x814F, 0x014A,
+        0x815B, 0x015E, 0x0154, 0x8151, 0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162, 0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+        0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101, 0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312, 0x0330, 0x8335, 0x833F, 0x033A,
+        0x832B, 0x032E, 0x0324, 0x8321, 0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371, 0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+        0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1, 0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2, 0x83A3, 0x03A6, 0x03AC, 0x83A9,
+        0x03B8, 0x83BD, 0x83B7, 0x03B2, 0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381, 0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+        0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2, 0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2, 0x02D0, 0x82D5, 0x82DF, 0x02DA,
+        0x82CB, 0x02CE, 0x02C4, 0x82C1, 0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252, 0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+        0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231, 0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202};
+
+static unsigned short sCrc16Slice[8][256];
+static unsigned short s50T01CrcLo[256];
+static unsigned short s50T01CrcHi[256];
+static unsigned short s50T01CrcData[256];
+static unsigned char s50InxCrc[256];
+static unsigned char s50InxCrcData[256];
+static pthread_once_t sCrcTableOnce = PTHREAD_ONCE_INIT;
+
+static unsigned short Crc50T01Byte(unsigned short crc, unsigned char data_buffer) {
+    unsigned short crc_temp_1,crc_temp_2,crc_temp_3;
+    for (int j = 0;j < 8;j++) {
+        crc_temp_1 = ((crc >> 15) ^ data_buffer) & 0x0001;
+        crc_temp_2 = ((crc >> 1) ^ crc_temp_1) & 0x0001;
+        crc_temp_3 = ((crc >> 14) ^ crc_temp_1) & 0x0001;
+        crc = crc << 1;
+        crc &= 0x7ffa;
+        crc |= crc_temp_1;
+        crc |= (crc_temp_2 << 2);
+        crc |= (crc_temp_3 << 15);
+        data_buffer >>= 1;
+    }
+    return crc;
+}
+
+static unsigned char Crc50InxByte(unsigned char crc_in, unsigned char data) {
+    unsigned char shift[9];
+    unsigned char crc[8];
+    unsigned char din[8];
+    for (int i = 0; i < 8; i++) {
+        crc[i] = (crc_in >> i) & 1;
+        din[i] = (data >> i) & 1;
+    }
+
+    shift[1] = (unsigned char)(din[7] ^ crc[7]);
+    shift[2] = (unsigned char)(din[6] ^ crc[6]);
+    shift[3] = (unsigned char)(din[5] ^ crc[5]);
+    shift[4] = (unsigned char)(din[4] ^ crc[4]);
+    shift[5] = (unsigned char)(din[3] ^ crc[3] ^ shift[1]);
+    shift[6] = (unsigned char)(din[2] ^ crc[2] ^ shift[1] ^ shift[2]);
+    shift[7] = (unsigned char)(din[1] ^ crc[1] ^ shift[1] ^ shift[2] ^ shift[3]);
+    shift[8] = (unsigned char)(din[0] ^ crc[0] ^ shift[2] ^ shift[3] ^ shift[4]);
+
+    crc[7] = (unsigned char)(shift[1] ^ shift[3] ^ shift[4] ^ shift[5]);
+    crc[6] = (unsigned char)(shift[2] ^ shift[4] ^ shift[5] ^ shift[6]);
+    crc[5] = (unsigned char)(shift[3] ^ shift[5] ^ shift[6] ^ shift[7]);
+    crc[4] = (unsigned char)(shift[4] ^ shift[6] ^ shift[7] ^ shift[8]);
+    crc[3] = (unsigned char)(shift[5] ^ shift[7] ^ shift[8]);
+    crc[2] = (unsigned char)(shift[6] ^ shift[8]);
+    crc[1] = (unsigned char)(shift[7]);
+    crc[0] = (unsigned char)(shift[8]);
+
+    unsigned char crc_out = 0;
+    for (int i = 0; i < 8; i++) {
+        crc_out |= (unsigned char)(crc[i] << i);
+    }
+    return crc_out;
+}
+
+static void BuildCrcTables(void) {
+    for (int i = 0; i < 256; i++) {
+        sCrc16Slice[0][i] = CRC16_TABLE[i];
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            unsigned short prev = sCrc16Slice[k - 1][i];
+            sCrc16Slice[k][i] = (unsigned short)((prev << 8) ^ CRC16_TABLE[prev >> 8]);
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        s50T01CrcLo[i] = Crc50T01Byte((unsigned short)i, 0);
+        s50T01CrcHi[i] = Crc50T01Byte((unsigned short)(i << 8), 0);
+        s50T01CrcData[i] = Crc50T01Byte(0, (unsigned char)i);
+        s50InxCrc[i] = Crc50InxByte((unsigned char)i, 0);
+        s50InxCrcData[i] = Crc50InxByte(0, (unsigned char)i);
+    }
+}
+
 /*43 crc check*/
 unsigned short CTvPanel::PANEL_43_CRC_Check(unsigned int *addr, int num) {
-    int  i, j;
-    unsigned int   data_int;
-    unsigned int   data_temp;
-    unsigned short data_short;
+    pthread_once(&sCrcTableOnce, BuildCrcTables);
     unsigned short crc_data = 0xffff;
 
     while (num--)
     {
-        data_int = *addr;
-        for (j = 4; j > 0; j--)
+        unsigned int data_int = *addr;
+        for (int j = 3; j >= 0; j--)
         {
-            {
-                data_temp  = data_int >> 8 * (j - 1);
-                data_short = data_temp << 8;
-                crc_data = crc_data ^ data_short;
-                for (i = 0; i < 8; i++)
-                {
-                    if (crc_data & 0x8000)
-                    {
-                        crc_data = (crc_data << 1) ^ 0x8005;
-                    }
-                    else
-                    {
-                        crc_data <<= 1;
-                    }
-                }
-                crc_data &= 0xFFFF;
-            }
+            unsigned char data = (unsigned char)(data_int >> (8 * j));
+            crc_data = (unsigned short)((crc_data << 8) ^ CRC16_TABLE[(crc_data >> 8) ^ data]);
         }
         addr++;
     }
@@ -2841,148 +2958,52 @@ unsigned short CTvPanel::PANEL_43_CRC_Check(unsigned int *addr, int num) {
 }
 
 
-#define   LUT_SIZE_65_CRC        590238
-#define   LUT_SIZE_65_CRC_HALF  295119
 unsigned short CTvPanel::PANEL_65D02_H_DEMURA_CRC(unsigned char *buffer,unsigned int data_size) {
-    int i = 0;
-    //unsigned short cat[LUT_SIZE_65_CRC_HALF] = {0x0};
-    int data_size_half = data_size/2;
-    unsigned short *cat = NULL;
-    cat = (unsigned short *)malloc(data_size_half*sizeof(unsigned short));
-    if (cat == NULL) {
-        LOGE("%s,Malloc memory failed!\n", __FUNCTION__);
-        return -1;
-    }
-    //unsigned short buffer_1[LUT_SIZE_65_CRC] = {0x0};
-    unsigned short *buffer_1 = NULL;
-    buffer_1 = (unsigned short *)malloc(data_size*sizeof(unsigned short));
-    if (buffer_1 == NULL) {
-        LOGE("%s,Malloc memory failed!\n", __FUNCTION__);
-        free(cat);
-        cat = NULL;
-        return -1;
-    }
-    int j = 0;
-    while (data_size--) {
-        buffer_1[j] = (unsigned short)buffer[j];
-        i++;
-    }
+    //sum of the big endian 16 bit words
     unsigned short demura_crc = 0;
-    int buffer_num = 0;
-    while (data_size_half--) {
-        cat[i] = buffer_1[buffer_num] * 256 + buffer_1[buffer_num + 1];
-        demura_crc = (unsigned short)(demura_crc + cat[i]);
-        buffer_num = buffer_num + 2;
-        i++;
-    }
-    free(cat);
-    cat = NULL;
-    free(buffer_1);
-    buffer_1 = NULL;
+    for (unsigned int i = 0; i + 1 < data_size; i += 2) {
+        demura_crc = (unsigned short)(demura_crc + buffer[i] * 256 + buffer[i + 1]);
+    }
     return demura_crc;
 }
 
 unsigned char CTvPanel::PANEL_50INX_DEMURA_CRC(unsigned char *data, unsigned char *const crc_out, int crcStart, int crcLength) {
-    unsigned char coef[8] = {1, 2, 4, 8, 16, 32, 64, 128};
-    unsigned char shift[9];
-    unsigned char crc[9];
-    unsigned char din[9];
+    pthread_once(&sCrcTableOnce, BuildCrcTables);
+    unsigned char crc = *crc_out;
     for (int index = crcStart; index < crcStart + crcLength; index += 1)
     {
-
-        for (int i = 0; i < 8; i += 1)
-        {
-            if ((*crc_out & coef[i]) != 0)
-                crc[i] = 1;
-            else
-                crc[i] = 0;
-
-            if ((data[index] & coef[i]) != 0)
-                din[i] = 1;
-            else
-                din[i] = 0;
-        }
-
-        shift[1] = (unsigned char)(din[7] ^ crc[7]);
-        shift[2] = (unsigned char)(din[6] ^ crc[6]);
-        shift[3] = (unsigned char)(din[5] ^ crc[5]);
-        shift[4] = (unsigned char)(din[4] ^ crc[4]);
-        shift[5] = (unsigned char)(din[3] ^ crc[3] ^ shift[1]);
-        shift[6] = (unsigned char)(din[2] ^ crc[2] ^ shift[1] ^ shift[2]);
-        shift[7] = (unsigned char)(din[1] ^ crc[1] ^ shift[1] ^ shift[2] ^ shift[3]);
-        shift[8] = (unsigned char)(din[0] ^ crc[0] ^ shift[2] ^ shift[3] ^ shift[4]);
-
-        crc[7] = (unsigned char)(shift[1] ^ shift[3] ^ shift[4] ^ shift[5]);
-        crc[6] = (unsigned char)(shift[2] ^ shift[4] ^ shift[5] ^ shift[6]);
-        crc[5] = (unsigned char)(shift[3] ^ shift[5] ^ shift[6] ^ shift[7]);
-        crc[4] = (unsigned char)(shift[4] ^ shift[6] ^ shift[7] ^ shift[8]);
-        crc[3] = (unsigned char)(shift[5] ^ shift[7] ^ shift[8]);
-        crc[2] = (unsigned char)(shift[6] ^ shift[8]);
-        crc[1] = (unsigned char)(shift[7]);
-        crc[0] = (unsigned char)(shift[8]);
-
-        *crc_out = 0;
-
-        for (int i = 0; i < 8; i += 1)
-        {
-            *crc_out += (unsigned char)(crc[i] * coef[i]);
-        }
+        crc = s50InxCrc[crc] ^ s50InxCrcData[data[index]];
     }
+    *crc_out = crc;
     return 0;
 }
 
 /*crc for 50T01 demura*/
 unsigned short CTvPanel::PANEL_50T01_DEMURA_CRC(unsigned char *buf, int length) {
-    unsigned int i,j;
+    pthread_once(&sCrcTableOnce, BuildCrcTables);
     unsigned short crc = 0x0;
-    unsigned short crc_temp_1,crc_temp_2,crc_temp_3;
-    unsigned char data_buffer;
-    i = 0;
-    while (length--) {
-        data_buffer = buf[i++];
-        crc_temp_1 = 0;
-        crc_temp_2 = 0;
-        crc_temp_3 = 0;
-        for (j = 0;j < 8;j++) {
-            crc_temp_1 = ((crc >> 15) ^ data_buffer) & 0x0001;
-            crc_temp_2 = ((crc >> 1) ^ crc_temp_1) & 0x0001;
-            crc_temp_3 = ((crc >> 14) ^ crc_temp_1) & 0x0001;
-            crc = crc << 1;
-            crc &= 0x7ffa;
-            crc |= crc_temp_1;
-            crc |= (crc_temp_2 << 2);
-            crc |= (crc_temp_3 << 15);
-            data_buffer >>= 1;
-        }
+    for (int i = 0; i < length; i++) {
+        crc = s50T01CrcLo[crc & 0xff] ^ s50T01CrcHi[crc >> 8] ^ s50T01CrcData[buf[i]];
     }
     return (crc);
 }
 
 /*for auto pgamma and demura data crc*/
 unsigned short CTvPanel::CalcCRC16(unsigned char *dataBuffer,unsigned long len) {
-    const unsigned short CRC16_TABLE[256] = {
-        0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011, 0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022, 0x8063, 0x0066, 0x006C, 0x8069,
-        0x0078, 0x807D, 0x8077, 0x0072, 0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041, 0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
-        0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1, 0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1, 0x8093, 0x0096, 0x009C, 0x8099,
-        0x0088, 0x808D, 0x8087, 0x0082, 0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192, 0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
-        0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1, 0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2, 0x0140, 0x8145, 0x814F, 0x014A,
-        0x815B, 0x015E, 0x0154, 0x8151, 0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162, 0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
-        0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101, 0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312, 0x0330, 0x8335, 0x833F, 0x033A,
-        0x832B, 0x032E, 0x0324, 0x8321, 0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371, 0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
-        0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1, 0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2, 0x83A3, 0x03A6, 0x03AC, 0x83A9,
-        0x03B8, 0x83BD, 0x83B7, 0x03B2, 0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381, 0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
-        0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2, 0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2, 0x02D0, 0x82D5, 0x82DF, 0x02DA,
-        0x82CB, 0x02CE, 0x02C4, 0x82C1, 0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252, 0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
-        0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231, 0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202};
-    unsigned char dat;
-    unsigned long offset = 0;
-    unsigned long crcData = 0;
+    pthread_once(&sCrcTableOnce, BuildCrcTables);
+    unsigned short crc = 0;
+    const unsigned char *p = dataBuffer;
+    while (len >= 8) {
+        crc = sCrc16Slice[7][(crc >> 8) ^ p[0]] ^ sCrc16Slice[6][(crc & 0xff) ^ p[1]]
+            ^ sCrc16Slice[5][p[2]] ^ sCrc16Slice[4][p[3]] ^ sCrc16Slice[3][p[4]]
+            ^ sCrc16Slice[2][p[5]] ^ sCrc16Slice[1][p[6]] ^ sCrc16Slice[0][p[7]];
+        p += 8;
+        len -= 8;
+    }
     while (len--) {
-        dat = (unsigned char)(crcData>>8);
-        crcData <<= 8;
-        crcData ^= CRC16_TABLE[dat^dataBuffer[offset++]];
+        crc = (unsigned short)((crc << 8) ^ CRC16_TABLE[(crc >> 8) ^ *p++]);
     }
-    return crcData;
+    return crc;
 }
 
 /*
@@ -3025,19 +3046,19 @@ int CTvPanel::PANEL_CreatSdcCheckBin() {
     LOGD("%s,creat crc_sdc check bin \n", __FUNCTION__);
     unsigned char crc_sdc_data[4]= {0x0};
 
-    ret = tvSpiRead( 0x10004, 2, crc_sdc_data);
+    ret = PANEL_SpiRead( 0x10004, 2, crc_sdc_data);
     if (ret < 0) {
         LOGE("%s,tvSpiRead Failed!\n", __FUNCTION__);
         return -1;
     }
 
-    ret = tvSpiRead( 0x12fc50, 1, crc_sdc_data+2);
+    ret = PANEL_SpiRead( 0x12fc50, 1, crc_sdc_data+2);
     if (ret < 0) {
         LOGE("%s,tvSpiRead1 Failed!\n", __FUNCTION__);
         return -1;
     }
 
-    ret = tvSpiRead(0x1FB800, 1, crc_sdc_data+3);
+    ret = PANEL_SpiRead(0x1FB800, 1, crc_sdc_data+3);
     if (ret < 0) {
         LOGE("%s,tvSpiRead2 Failed!\n", __FUNCTION__);
         return -1;
@@ -74,6 +74,9 @@ public:
     int PANEL_AutoFlicker(void);
     int PANEL_Flash_Read(const char *partition_name, long offset,unsigned char *buffer, unsigned int length);
     int PANEL_Flash_Write(const char *partition_name, long offset,unsigned char *buffer, unsigned int length) ;
+    //reads go through the cached spi flash, PANEL_SpiClose drops the cache
+    int PANEL_SpiRead(unsigned int offset, unsigned int length, unsigned char *buffer);
+    void PANEL_SpiClose();
 
     static CTvPanel *getInstance();
 
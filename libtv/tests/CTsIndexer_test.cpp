@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "CTsIndexer.h"
+
+#define TEST_PMT_PID        0x100
+#define TEST_VIDEO_PID      0x101
+#define TEST_FRAME_TICKS    3600 //40 ms at 90 kHz
+#define TEST_GOP            25
+#define TEST_FRAMES         100
+
+static void putPacket(std::vector<uint8_t> &ts, int pid, const uint8_t *payload, int len)
+{
+    uint8_t pkt[TS_PACKET_SIZE];
+    memset(pkt, 0xff, sizeof(pkt));
+    pkt[0] = TS_SYNC_BYTE;
+    pkt[1] = 0x40 | ((pid >> 8) & 0x1f);
+    pkt[2] = pid & 0xff;
+    pkt[3] = 0x10;
+    memcpy(pkt + 4, payload, len);
+    ts.insert(ts.end(), pkt, pkt + TS_PACKET_SIZE);
+}
+
+static void putPsi(std::vector<uint8_t> &ts)
+{
+    //pat with program 1 on TEST_PMT_PID, crc is not checked
+    const uint8_t pat[] = {
+        0x00, 0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0x00, 0x01, 0xe0 | (TEST_PMT_PID >> 8), TEST_PMT_PID & 0xff,
+        0x00, 0x00, 0x00, 0x00,
+    };
+    //pmt with one h264 stream carrying the pcr
+    const uint8_t pmt[] = {
+        0x00, 0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+        0xe0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xff, 0xf0, 0x00,
+        0x1b, 0xe0 | (TEST_VIDEO_PID >> 8), TEST_VIDEO_PID & 0xff, 0xf0, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+    };
+    putPacket(ts, 0, pat, sizeof(pat));
+    putPacket(ts, TEST_PMT_PID, pmt, sizeof(pmt));
+}
+
+static void putFrame(std::vector<uint8_t> &ts, int64_t pts, bool key)
+{
+    uint8_t pes[24];
+    memset(pes, 0, sizeof(pes));
+    pes[2] = 0x01;
+    pes[3] = 0xe0;
+    pes[6] = 0x80;
+    pes[7] = 0x80;
+    pes[8] = 5;
+    pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+    pes[10] = (pts >> 22) & 0xff;
+    pes[11] = 0x01 | ((pts >> 14) & 0xfe);
+    pes[12] = (pts >> 7) & 0xff;
+    pes[13] = 0x01 | ((pts << 1) & 0xfe);
+    pes[16] = 0x01;
+    pes[17] = key ? 0x65 : 0x41;
+    putPacket(ts, TEST_VIDEO_PID, pes, sizeof(pes));
+}
+
+static std::vector<uint8_t> makeStream()
+{
+    std::vector<uint8_t> ts;
+    putPsi(ts);
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        putFrame(ts, 90000 + (int64_t)i * TEST_FRAME_TICKS, i % TEST_GOP == 0);
+    }
+    return ts;
+}
+
+class CTsIndexerTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/tsindexXXXXXX";
+        ASSERT_TRUE(mkdtemp(dir) != NULL);
+        mDir = dir;
+        mPath = mDir + "/rec.ts";
+        mIdxPath = mPath + TS_INDEX_FILE_SUFFIX;
+        std::vector<uint8_t> ts = makeStream();
+        writeFile(mPath, ts.data(), ts.size());
+    }
+
+    void TearDown() override
+    {
+        unlink(mIdxPath.c_str());
+        unlink(mPath.c_str());
+        rmdir(mDir.c_str());
+    }
+
+    static void writeFile(const std::string &path, const void *data, size_t len)
+    {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ((ssize_t)len, write(fd, data, len));
+        close(fd);
+    }
+
+    static off_t fileSize(const std::string &path)
+    {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+    }
+
+    static void checkIndex(const CTsIndexer &indexer)
+    {
+        CTsIndexer::IndexEntry entry;
+        EXPECT_EQ(TEST_VIDEO_PID, indexer.getVideoPid());
+        EXPECT_EQ(TEST_VIDEO_PID, indexer.getPcrPid());
+        //the duration is the last time point kept, not the last frame
+        EXPECT_EQ(3520, indexer.getDurationMs());
+
+        //key frames every second, after the pat and pmt packets
+        ASSERT_EQ(0, indexer.findKeyFrame(1500, &entry));
+        EXPECT_EQ(1000, entry.timeMs);
+        EXPECT_EQ((2 + TEST_GOP) * TS_PACKET_SIZE, entry.offset);
+        ASSERT_EQ(0, indexer.findNextKeyFrame(1500, &entry));
+        EXPECT_EQ(2000, entry.timeMs);
+        EXPECT_NE(0, indexer.findNextKeyFrame(3000, &entry));
+
+        ASSERT_EQ(0, indexer.findOffset(2600, &entry));
+        EXPECT_EQ(2520, entry.timeMs);
+        EXPECT_EQ(2520, indexer.findTime(entry.offset + 1));
+    }
+
+    std::string mDir;
+    std::string mPath;
+    std::string mIdxPath;
+};
+
+TEST_F(CTsIndexerTest, FeedSplitBlocks)
+{
+    std::vector<uint8_t> ts = makeStream();
+    CTsIndexer indexer;
+    //odd block sizes split packets and the pes headers
+    for (size_t pos = 0; pos < ts.size(); pos += 1000) {
+        int len = (int)std::min<size_t>(1000, ts.size() - pos);
+        indexer.feed(ts.data() + pos, len, pos);
+    }
+    checkIndex(indexer);
+
+    CTsIndexer::StreamInfo streams[CTsIndexer::MAX_STREAM];
+    ASSERT_EQ(1, indexer.getStreams(streams, CTsIndexer::MAX_STREAM));
+    EXPECT_EQ(0x1b, streams[0].type);
+}
+
+TEST_F(CTsIndexerTest, OpenBuildsAndReloads)
+{
+    CTsIndexer indexer;
+    ASSERT_EQ(0, indexer.open(mPath.c_str()));
+    checkIndex(indexer);
+    ASSERT_GT(fileSize(mIdxPath), 0);
+
+    CTsIndexer reloaded;
+    ASSERT_EQ(0, reloaded.open(mPath.c_str()));
+    checkIndex(reloaded);
+}
+
+TEST_F(CTsIndexerTest, RejectsIndexOfWrongSize)
+{
+    CTsIndexer indexer;
+    ASSERT_EQ(0, indexer.open(mPath.c_str()));
+    off_t goodSize = fileSize(mIdxPath);
+
+    //a truncated index keeps a valid header whose counts no longer fit
+    ASSERT_EQ(0, truncate(mIdxPath.c_str(), goodSize - 1));
+    CTsIndexer truncated;
+    ASSERT_EQ(0, truncated.open(mPath.c_str()));
+    checkIndex(truncated);
+    EXPECT_EQ(goodSize, fileSize(mIdxPath));
+
+    //and so does one with trailing bytes
+    int fd = open(mIdxPath.c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(4, write(fd, "junk", 4));
+    close(fd);
+    CTsIndexer padded;
+    ASSERT_EQ(0, padded.open(mPath.c_str()));
+    checkIndex(padded);
+    EXPECT_EQ(goodSize, fileSize(mIdxPath));
+}
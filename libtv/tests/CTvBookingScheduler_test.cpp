@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <string.h>
+#include <gtest/gtest.h>
+#include "CTvBookingScheduler.h"
+
+#define PREROLL     30
+#define POSTROLL    60
+
+static CTvBookingScheduler::Booking makeBooking(int eventId, long start, long duration, int flag)
+{
+    CTvBookingScheduler::Booking b;
+    memset(&b, 0, sizeof(b));
+    b.eventId = eventId;
+    b.programId = 1;
+    b.flag = flag;
+    b.start = start;
+    b.duration = duration;
+    return b;
+}
+
+TEST(CTvBookingSchedulerTest, NoOverlap)
+{
+    Vector<CTvBookingScheduler::Booking> bookings;
+    bookings.add(makeBooking(1, 1000, 600, CTvBookingScheduler::FLAG_RECORD));
+    //back to back once the rolls are counted
+    CTvBookingScheduler::Booking b = makeBooking(2, 1000 + 600 + POSTROLL + PREROLL, 600,
+                                                 CTvBookingScheduler::FLAG_RECORD);
+    Vector<int> overlaps;
+    EXPECT_EQ(0, CTvBookingScheduler::peakRecordings(bookings, b, PREROLL, POSTROLL, &overlaps));
+    EXPECT_EQ(0u, overlaps.size());
+}
+
+TEST(CTvBookingSchedulerTest, RollsMakeOverlap)
+{
+    Vector<CTvBookingScheduler::Booking> bookings;
+    bookings.add(makeBooking(1, 1000, 600, CTvBookingScheduler::FLAG_RECORD));
+    CTvBookingScheduler::Booking b = makeBooking(2, 1000 + 600 + POSTROLL, 600,
+                                                 CTvBookingScheduler::FLAG_RECORD);
+    Vector<int> overlaps;
+    EXPECT_EQ(1, CTvBookingScheduler::peakRecordings(bookings, b, PREROLL, POSTROLL, &overlaps));
+    ASSERT_EQ(1u, overlaps.size());
+    EXPECT_EQ(1, overlaps[0]);
+}
+
+TEST(CTvBookingSchedulerTest, PeakIsNotTheOverlapCount)
+{
+    //two recordings within the new one, one after the other
+    Vector<CTvBookingScheduler::Booking> bookings;
+    bookings.add(makeBooking(1, 1000, 600, CTvBookingScheduler::FLAG_RECORD));
+    bookings.add(makeBooking(2, 3000, 600, CTvBookingScheduler::FLAG_RECORD));
+    CTvBookingScheduler::Booking b = makeBooking(3, 900, 3000, CTvBookingScheduler::FLAG_RECORD);
+    Vector<int> overlaps;
+    EXPECT_EQ(1, CTvBookingScheduler::peakRecordings(bookings, b, PREROLL, POSTROLL, &overlaps));
+    EXPECT_EQ(2u, overlaps.size());
+
+    //a third one over both of them
+    bookings.add(makeBooking(4, 1500, 1600, CTvBookingScheduler::FLAG_RECORD));
+    EXPECT_EQ(2, CTvBookingScheduler::peakRecordings(bookings, b, PREROLL, POSTROLL, NULL));
+}
+
+TEST(CTvBookingSchedulerTest, RemindersAndSameEventDoNotCount)
+{
+    Vector<CTvBookingScheduler::Booking> bookings;
+    bookings.add(makeBooking(1, 1000, 600, CTvBookingScheduler::FLAG_REMIND));
+    bookings.add(makeBooking(2, 1000, 600, CTvBookingScheduler::FLAG_RECORD));
+    //booking event 2 again replaces it
+    CTvBookingScheduler::Booking b = makeBooking(2, 1100, 600, CTvBookingScheduler::FLAG_RECORD);
+    EXPECT_EQ(0, CTvBookingScheduler::peakRecordings(bookings, b, PREROLL, POSTROLL, NULL));
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <gtest/gtest.h>
+#include "CTvDatabase.h"
+
+//the tables resetTables knows, with subtitle_table standing in for the ones
+//it only finds through their db_srv_id
+static const char *TEST_SCHEMA =
+    "create table net_table(db_id integer primary key);"
+    "create table ts_table(db_id integer primary key, db_net_id int);"
+    "create table srv_table(db_id integer primary key, db_ts_id int);"
+    "create table evt_table(db_id integer primary key, db_srv_id int);"
+    "create table booking_table(db_id integer primary key, db_srv_id int, db_evt_id int);"
+    "create table grp_table(db_id integer primary key);"
+    "create table grp_map_table(db_id integer primary key, db_srv_id int, db_grp_id int);"
+    "create table subtitle_table(db_id integer primary key, db_srv_id int);"
+    "create table region_table(db_id integer primary key);";
+
+static const char *TEST_ROWS =
+    "insert into net_table values(1);"
+    "insert into ts_table values(1, 1);"
+    "insert into srv_table values(1, 1);"
+    "insert into evt_table values(1, 1);"
+    "insert into booking_table values(1, 1, 1);"
+    "insert into grp_table values(1);"
+    "insert into grp_map_table values(1, 1, 1);"
+    "insert into subtitle_table values(1, 1);"
+    "insert into region_table values(1);";
+
+class CTvDatabaseTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char dir[] = "/tmp/tvdbXXXXXX";
+        ASSERT_TRUE(mkdtemp(dir) != NULL);
+        mDir = dir;
+        mPath = mDir + "/tv.db";
+        ASSERT_EQ(0, mDb.openDb(mPath.c_str()));
+        ASSERT_TRUE(mDb.exeSql(TEST_SCHEMA));
+        ASSERT_TRUE(mDb.exeSql(TEST_ROWS));
+    }
+
+    void TearDown() override
+    {
+        mDb.UnInitTvDb();
+        unlink((mPath + "-wal").c_str());
+        unlink((mPath + "-shm").c_str());
+        unlink(mPath.c_str());
+        rmdir(mDir.c_str());
+    }
+
+    int rows(const char *table)
+    {
+        CTvDatabase::Cursor c;
+        mDb.select((std::string("select db_id from ") + table).c_str(), c);
+        int count = c.getCount();
+        c.close();
+        return count;
+    }
+
+    CTvDatabase mDb;
+    std::string mDir;
+    std::string mPath;
+};
+
+TEST_F(CTvDatabaseTest, EpgResetKeepsBookings)
+{
+    ASSERT_EQ(0, mDb.resetTables(CTvDatabase::RESET_EPG));
+    EXPECT_EQ(0, rows("evt_table"));
+    //db_evt_id is not followed, a booking keeps its copy of the event
+    EXPECT_EQ(1, rows("booking_table"));
+    EXPECT_EQ(1, rows("srv_table"));
+}
+
+TEST_F(CTvDatabaseTest, ScanResetTakesTheRowsReferringToIt)
+{
+    ASSERT_EQ(0, mDb.resetTables(CTvDatabase::RESET_SCAN));
+    EXPECT_EQ(0, rows("net_table"));
+    EXPECT_EQ(0, rows("ts_table"));
+    EXPECT_EQ(0, rows("srv_table"));
+    EXPECT_EQ(0, rows("evt_table"));
+    EXPECT_EQ(0, rows("booking_table"));
+    EXPECT_EQ(0, rows("grp_map_table"));
+    EXPECT_EQ(0, rows("subtitle_table"));
+    //grp_map_table goes with the services, the groups stay
+    EXPECT_EQ(1, rows("grp_table"));
+    EXPECT_EQ(1, rows("region_table"));
+}
+
+TEST_F(CTvDatabaseTest, MissingTablesAreSkipped)
+{
+    //the schema has no sat_para_table and no dimension_table
+    ASSERT_EQ(0, mDb.resetTables(CTvDatabase::RESET_ALL));
+    EXPECT_EQ(0, rows("grp_table"));
+    EXPECT_EQ(0, rows("region_table"));
+    EXPECT_EQ(0, rows("srv_table"));
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include <tvconfig.h>
+#include "CTvRecArbiter.h"
+
+#define FREQ_A      474000000
+#define FREQ_B      482000000
+
+class RecordingObserver : public CTvRecArbiter::IObserver {
+public:
+    void onRecPreempt(const char *id)
+    {
+        preempted.push_back(id);
+    }
+    void onRecGranted(const char *id, const char *param)
+    {
+        granted.push_back(std::string(id) + ":" + param);
+    }
+
+    std::vector<std::string> preempted;
+    std::vector<std::string> granted;
+};
+
+//one tuner, three demuxes and two dvr channels
+class CTvRecArbiterTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        char path[] = "/tmp/arbiterXXXXXX";
+        int fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        const char conf[] = "[TV]\n" CFG_DTV_RES_TUNER_COUNT " = 1\n"
+                            CFG_DTV_RES_DEMUX_COUNT " = 3\n" CFG_DTV_RES_DVR_COUNT " = 2\n";
+        ASSERT_EQ((ssize_t)sizeof(conf) - 1, write(fd, conf, sizeof(conf) - 1));
+        close(fd);
+        tv_config_load(path);
+        unlink(path);
+
+        mArbiter = new CTvRecArbiter();
+        mArbiter->setObserver(&mObserver);
+    }
+
+    void TearDown() override
+    {
+        delete mArbiter;
+    }
+
+    CTvRecArbiter *mArbiter;
+    RecordingObserver mObserver;
+};
+
+TEST_F(CTvRecArbiterTest, SameFrequencySharesTheTuner)
+{
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request(REC_ARBITER_LIVE_ID, NULL, CTvRecArbiter::PRIORITY_LIVE, 0, FREQ_A, -1));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 0));
+    //the only tuner is on FREQ_A, a scheduled recording waits for it
+    EXPECT_EQ(CTvRecArbiter::ARBITER_QUEUED,
+              mArbiter->request("rec1", "p1", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_B, 1));
+    EXPECT_TRUE(mArbiter->isQueued("rec1"));
+    EXPECT_TRUE(mObserver.preempted.empty());
+}
+
+TEST_F(CTvRecArbiterTest, DvrIsExclusive)
+{
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 0));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_QUEUED,
+              mArbiter->request("rec1", "p1", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 0));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec2", "p2", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 1));
+    //a dvr channel the device does not have never fits
+    EXPECT_EQ(CTvRecArbiter::ARBITER_DENIED,
+              mArbiter->request("rec3", "p3", CTvRecArbiter::PRIORITY_TIMESHIFT, 0, FREQ_A, 2));
+
+    mArbiter->release("rec0");
+    ASSERT_EQ(1u, mObserver.granted.size());
+    EXPECT_EQ("rec1:p1", mObserver.granted[0]);
+    EXPECT_TRUE(mArbiter->isGranted("rec1"));
+}
+
+TEST_F(CTvRecArbiterTest, DemuxPoolIsShared)
+{
+    //live takes a demux, the recordings on its frequency one each
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request(REC_ARBITER_LIVE_ID, NULL, CTvRecArbiter::PRIORITY_LIVE, 0, FREQ_A, -1));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_BACKGROUND, 0, FREQ_A, 0));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec1", "p1", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 1));
+    //a fourth demux is not there, and rec0 is no lower than a background request
+    EXPECT_EQ(CTvRecArbiter::ARBITER_QUEUED,
+              mArbiter->request("rec2", "p2", CTvRecArbiter::PRIORITY_BACKGROUND, 0, FREQ_A, -1));
+}
+
+TEST_F(CTvRecArbiterTest, LivePreemptsLowerPriority)
+{
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 0));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request(REC_ARBITER_LIVE_ID, NULL, CTvRecArbiter::PRIORITY_LIVE, 0, FREQ_B, -1));
+    ASSERT_EQ(1u, mObserver.preempted.size());
+    EXPECT_EQ("rec0", mObserver.preempted[0]);
+    EXPECT_FALSE(mArbiter->isGranted("rec0"));
+}
+
+TEST_F(CTvRecArbiterTest, DeniedHolderKeepsItsGrant)
+{
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request(REC_ARBITER_LIVE_ID, NULL, CTvRecArbiter::PRIORITY_LIVE, 0, FREQ_A, -1));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("timeshifting", "t", CTvRecArbiter::PRIORITY_TIMESHIFT, 0, FREQ_A, 0));
+    //live holds the tuner on FREQ_A and can not be preempted
+    EXPECT_EQ(CTvRecArbiter::ARBITER_DENIED,
+              mArbiter->request("timeshifting", "t", CTvRecArbiter::PRIORITY_TIMESHIFT, 0, FREQ_B, 0));
+    EXPECT_TRUE(mArbiter->isGranted("timeshifting"));
+    EXPECT_EQ(CTvRecArbiter::ARBITER_QUEUED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_SCHEDULED, 0, FREQ_A, 0));
+    EXPECT_TRUE(mObserver.granted.empty());
+}
+
+TEST_F(CTvRecArbiterTest, FindFreeSharesTheTunerFirst)
+{
+    int fend = -1, dvr = -1;
+    ASSERT_EQ(0, mArbiter->findFree("rec0", FREQ_A, &fend, &dvr));
+    EXPECT_EQ(0, fend);
+    EXPECT_EQ(0, dvr);
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec0", "p0", CTvRecArbiter::PRIORITY_SCHEDULED, fend, FREQ_A, dvr));
+
+    //the next recording of FREQ_A gets the other dvr channel
+    ASSERT_EQ(0, mArbiter->findFree("rec1", FREQ_A, &fend, &dvr));
+    EXPECT_EQ(0, fend);
+    EXPECT_EQ(1, dvr);
+    EXPECT_EQ(CTvRecArbiter::ARBITER_GRANTED,
+              mArbiter->request("rec1", "p1", CTvRecArbiter::PRIORITY_SCHEDULED, fend, FREQ_A, dvr));
+
+    //out of dvr channels, and the only tuner is on FREQ_A
+    EXPECT_NE(0, mArbiter->findFree("rec2", FREQ_A, &fend, &dvr));
+    mArbiter->release("rec0");
+    EXPECT_NE(0, mArbiter->findFree("rec2", FREQ_B, &fend, &dvr));
+    EXPECT_EQ(0, mArbiter->findFree("rec2", FREQ_A, &fend, &dvr));
+    EXPECT_EQ(0, dvr);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <time.h>
+#include <gtest/gtest.h>
+#include "CTvTime.h"
+
+#define STREAM_TIME     1700000000L
+
+TEST(CTvTimeTest, SystemTimeUntilSynced)
+{
+    CTvTime tvTime;
+    EXPECT_FALSE(tvTime.isSynced());
+    EXPECT_NEAR((long)time(NULL), tvTime.getTime(), 1);
+}
+
+TEST(CTvTimeTest, FirstTableSetsTheClock)
+{
+    CTvTime tvTime;
+    tvTime.setTime(STREAM_TIME);
+    EXPECT_TRUE(tvTime.isSynced());
+    EXPECT_EQ(STREAM_TIME, tvTime.getTime());
+    EXPECT_NEAR((int64_t)STREAM_TIME * 1000, tvTime.nowMs(), 100);
+}
+
+TEST(CTvTimeTest, LateTableDoesNotPullBack)
+{
+    CTvTime tvTime;
+    tvTime.setTime(STREAM_TIME);
+    //a table delivered a second late is within the outlier range
+    tvTime.setTime(STREAM_TIME - 1);
+    EXPECT_EQ(STREAM_TIME, tvTime.getTime());
+}
+
+TEST(CTvTimeTest, OutliersStepOnlyWhenTheyAgree)
+{
+    CTvTime tvTime;
+    tvTime.setTime(STREAM_TIME);
+
+    //a single far off table is dropped
+    tvTime.setTime(STREAM_TIME + 3600);
+    EXPECT_EQ(STREAM_TIME, tvTime.getTime());
+    //outliers which disagree start over
+    tvTime.setTime(STREAM_TIME - 3600);
+    tvTime.setTime(STREAM_TIME + 3600);
+    EXPECT_EQ(STREAM_TIME, tvTime.getTime());
+
+    for (int i = 1; i < CTvTime::STEP_SAMPLES; i++) {
+        tvTime.setTime(STREAM_TIME + 3600);
+    }
+    EXPECT_EQ(STREAM_TIME + 3600, tvTime.getTime());
+}
+
+TEST(CTvTimeTest, DiffTimeRoundTrip)
+{
+    CTvTime tvTime;
+    tvTime.setDiffTime(1000);
+    EXPECT_TRUE(tvTime.isSynced());
+    EXPECT_NEAR(1000, tvTime.getDiffTime(), 1);
+}
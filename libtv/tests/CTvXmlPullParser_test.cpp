@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <gtest/gtest.h>
+#include "CTvXmlPullParser.h"
+
+class CTvXmlPullParserTest : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        mParser.close();
+        if (!mPath.empty()) {
+            unlink(mPath.c_str());
+        }
+    }
+
+    void openXml(const char *xml)
+    {
+        char path[] = "/tmp/xmlpullXXXXXX";
+        int fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        mPath = path;
+        ASSERT_EQ((ssize_t)strlen(xml), write(fd, xml, strlen(xml)));
+        close(fd);
+        ASSERT_EQ(0, mParser.open(path));
+    }
+
+    void expectTag(int type, const char *name, int depth)
+    {
+        ASSERT_EQ(type, mParser.next());
+        EXPECT_STREQ(name, mParser.getName());
+        EXPECT_EQ(depth, mParser.getDepth());
+    }
+
+    CTvXmlPullParser mParser;
+    std::string mPath;
+};
+
+TEST_F(CTvXmlPullParserTest, SkipsEverythingButElements)
+{
+    openXml("<?xml version=\"1.0\"?>\n"
+            "<!DOCTYPE regions>\n"
+            "<!-- <fake a=\"1\"/> -->\n"
+            "<regions>\n"
+            "  text <![CDATA[<fake/>]]>\n"
+            "  <region name=\"a\">\n"
+            "    <channel_entry/>\n"
+            "  </region>\n"
+            "</regions>\n");
+
+    expectTag(CTvXmlPullParser::XML_START_TAG, "regions", 1);
+    expectTag(CTvXmlPullParser::XML_START_TAG, "region", 2);
+    expectTag(CTvXmlPullParser::XML_START_TAG, "channel_entry", 3);
+    //the end of a self closing tag comes as its own event
+    expectTag(CTvXmlPullParser::XML_END_TAG, "channel_entry", 2);
+    expectTag(CTvXmlPullParser::XML_END_TAG, "region", 1);
+    expectTag(CTvXmlPullParser::XML_END_TAG, "regions", 0);
+    EXPECT_EQ(CTvXmlPullParser::XML_END_DOCUMENT, mParser.next());
+}
+
+TEST_F(CTvXmlPullParserTest, DecodesAttributes)
+{
+    openXml("<e a=\"x &amp; &lt;y&gt; &quot;q&quot;\" b='&apos;&#65;&#x42;'"
+            " c=\"&unknown; &#0;\" d=\"1\r\n2\r3\"/>");
+
+    ASSERT_EQ(CTvXmlPullParser::XML_START_TAG, mParser.next());
+    EXPECT_STREQ("x & <y> \"q\"", mParser.getAttribute("a"));
+    EXPECT_STREQ("'AB", mParser.getAttribute("b"));
+    EXPECT_STREQ("&unknown; &#0;", mParser.getAttribute("c"));
+    EXPECT_STREQ("1\n2\n3", mParser.getAttribute("d"));
+    EXPECT_TRUE(mParser.getAttribute("e") == NULL);
+}
+
+TEST_F(CTvXmlPullParserTest, IntAttributes)
+{
+    openXml("<e dec=\"-12\" hex=\"0x1F\" pad=\" 7\" bad=\"abc\"/>");
+
+    ASSERT_EQ(CTvXmlPullParser::XML_START_TAG, mParser.next());
+    EXPECT_EQ(-12, mParser.getIntAttribute("dec", 0));
+    EXPECT_EQ(0x1f, mParser.getIntAttribute("hex", 0));
+    EXPECT_EQ(7, mParser.getIntAttribute("pad", 0));
+    EXPECT_EQ(-1, mParser.getIntAttribute("bad", -1));
+    EXPECT_EQ(-1, mParser.getIntAttribute("missing", -1));
+}
+
+TEST_F(CTvXmlPullParserTest, TruncatedFileIsAnError)
+{
+    openXml("<regions><region name=\"a\">");
+
+    expectTag(CTvXmlPullParser::XML_START_TAG, "regions", 1);
+    expectTag(CTvXmlPullParser::XML_START_TAG, "region", 2);
+    EXPECT_EQ(CTvXmlPullParser::XML_ERROR, mParser.next());
+}
+
+TEST_F(CTvXmlPullParserTest, BrokenTagIsAnError)
+{
+    openXml("<regions><region name=a/></regions>");
+
+    expectTag(CTvXmlPullParser::XML_START_TAG, "regions", 1);
+    EXPECT_EQ(CTvXmlPullParser::XML_ERROR, mParser.next());
+}
+
+TEST_F(CTvXmlPullParserTest, HashFollowsTheContent)
+{
+    openXml("<regions/>");
+    uint64_t hash = mParser.getContentHash();
+    EXPECT_EQ(10u, mParser.getSize());
+
+    CTvXmlPullParser same;
+    ASSERT_EQ(0, same.open(mPath.c_str()));
+    EXPECT_EQ(hash, same.getContentHash());
+    same.close();
+
+    mParser.close();
+    unlink(mPath.c_str());
+    openXml("<regions />");
+    EXPECT_NE(hash, mParser.getContentHash());
+}
@@ -47,6 +47,9 @@ CAv::CAv()
     memset(&play_params, 0, sizeof(play_params));
     memset(&player, 0, sizeof(player));
     memset(&mPids, 0, sizeof(mPids));
+    mTimeshiftCurMs = 0;
+    mTimeshiftStartMs = 0;
+    mTimeshiftEndMs = 0;
     tunnelid = -1;
 #ifdef SUPPORT_ADTV
     memset(&mAdParams, 0, sizeof(mAdParams));
@@ -1270,6 +1273,12 @@ int CAv::startTimeShift(void *para)
     //set dmx source to hiu
     AM_DMX_SetSource ( 0, AM_DMX_SRC_HIU );
     this->mCurAvEvent.timeshiftStarttime = -1;
+    {
+        AutoMutex _l(mTimeshiftLock);
+        mTimeshiftCurMs = 0;
+        mTimeshiftStartMs = 0;
+        mTimeshiftEndMs = 0;
+    }
 
     memset(&play_params, 0, sizeof(play_params));
     memset(&mPids, 0, sizeof(mPids));
@@ -1383,9 +1392,9 @@ int CAv::seekTimeShift(int pos, bool start)
     if (mIsTsplayer == false) {
         return AM_AV_SeekTimeshift (mTvPlayDevId, pos, start);
     }
-    // TODO:
-    if (player && mSession != INVALID_PLAYER_HDLE )
-         dvr_wrapper_seek_playback (player, pos);
+    //libdvr keeps the paused or playing state across a seek
+    if (player && mSession != INVALID_PLAYER_HDLE)
+        return (dvr_wrapper_seek_playback(player, pos) == DVR_SUCCESS) ? 0 : -1;
     return -1;
 #else
     return -1;
@@ -1434,6 +1443,37 @@ int CAv::switchTimeShiftAudio(int apid, int afmt)
 #endif
 }
 
+int CAv::getTimeShiftTime(int *cur, int *start, int *end)
+{
+#ifdef SUPPORT_ADTV
+    if (mIsTsplayer == false) {
+        AM_AV_TimeshiftInfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (AM_AV_GetTimeshiftInfo(mTvPlayDevId, &info) != DVB_SUCCESS) {
+            return -1;
+        }
+        if (cur)
+            *cur = info.current_time;
+        if (start)
+            *start = 0;
+        if (end)
+            *end = info.full_time;
+        return 0;
+    }
+#endif
+    AutoMutex _l(mTimeshiftLock);
+    if (!mIsTimeshift) {
+        return -1;
+    }
+    if (cur)
+        *cur = mTimeshiftCurMs;
+    if (start)
+        *start = mTimeshiftStartMs;
+    if (end)
+        *end = mTimeshiftEndMs;
+    return 0;
+}
+
 int CAv::playTimeShift()
 {
     LOGD("%s", __FUNCTION__);
@@ -1863,6 +1903,12 @@ DVR_Result_t CAv::PlayEventHandler(DVR_PlaybackEvent_t event, void *params, void
                     pAv->mCurAvEvent.timeshiftStarttime = status->info_obsolete.time;
                     pAv->mpObserver->onEvent(pAv->mCurAvEvent);
                 }
+                {
+                    AutoMutex _l(pAv->mTimeshiftLock);
+                    pAv->mTimeshiftStartMs = status->info_obsolete.time;
+                    pAv->mTimeshiftEndMs = status->info_full.time;
+                    pAv->mTimeshiftCurMs = status->info_cur.time + status->info_obsolete.time;
+                }
                 LOGD("CURRENT TIME CHANGE----------");
                 pAv->mCurAvEvent.type = AVEvent::EVENT_PLAY_CURTIME_CHANGE;
                 pAv->mCurAvEvent.param = status->info_cur.time + status->info_obsolete.time;
@@ -17,6 +17,7 @@
 #include <dvr_wrapper.h>
 
 #endif
+#include <utils/Mutex.h>
 #include "CTvEv.h"
 #include "CTvLog.h"
 #include "../tvin/CTvin.h"
@@ -175,6 +176,9 @@ public:
     int seekTimeShift(int pos, bool start);
     int setTimeShiftSpeed(int speed);
     int switchTimeShiftAudio(int apid, int afmt);
+    //play time of the playback, in ms: as last reported by libdvr with the
+    //tsplayer, asked from the am_av timeshift player otherwise
+    int getTimeShiftTime(int *cur, int *start, int *end);
 
     int AudioSetPreGain(float pre_gain);
     int AudioGetPreGain(float *gain);
@@ -230,6 +234,11 @@ private:
     DVR_WrapperPlayback_t player;
     am_tsplayer_handle mSession;
     DVR_PlaybackPids_t mPids;
+    //written by the libdvr playback callback
+    int mTimeshiftCurMs;
+    int mTimeshiftStartMs;
+    int mTimeshiftEndMs;
+    mutable Mutex mTimeshiftLock;
     int tunnelid;
 #ifdef SUPPORT_ADTV
     am_tsplayer_audio_params mAdParams;
@@ -7,6 +7,7 @@
  * Description: c++ file
  */
 
+#include <string.h>
 #include <CTvLog.h>
 #include <cutils/properties.h>
 #include "CBootvideoStatusDetect.h"
@@ -16,33 +17,70 @@
 #define LOG_TAG "CBootvideoStatusDetect"
 #endif
 
+// 1: boot video;  other: boot animation
+#define PROP_BOOTVIDEO_TYPE     "service.bootvideo"
+// stopped: bootvideo stopped;  running: bootvideo is running
+// now bootanim and boot service use the same service name
+#define PROP_BOOTVIDEO          "init.svc.bootanim"
+
 CBootvideoStatusDetect::CBootvideoStatusDetect()
 {
     LOGD("%s", __FUNCTION__);
     mpObserver = NULL;
+    mState = STATE_UNKNOWN;
     mIsRunning = false;
 }
 
-CBootvideoStatusDetect::~CBootvideoStatusDetect() {}
+CBootvideoStatusDetect::~CBootvideoStatusDetect()
+{
+    stopDetect();
+}
 
 int CBootvideoStatusDetect::startDetect()
 {
     LOGD("%s", __FUNCTION__);
-    if (!mIsRunning)
-        this->run("CBootvideoStatusDetect");
-
+    AutoMutex _l(mLock);
+    if (mIsRunning)
+        return 0;
+
+    mState = STATE_UNKNOWN;
+    mpWatch = new CPropertyWatch();
+    mpWatch->addProperty(PROP_BOOTVIDEO_TYPE, "null");
+    mpWatch->addProperty(PROP_BOOTVIDEO, "null");
+    mpWatch->setObserver(this);
+    if (mpWatch->startWatch() != 0) {
+        mpWatch.clear();
+        return -1;
+    }
+    mIsRunning = true;
     return 0;
 }
 
 int CBootvideoStatusDetect::stopDetect()
 {
     LOGD("%s", __FUNCTION__);
-    requestExit();
-    mIsRunning = false;
+    sp<CPropertyWatch> watch;
+    {
+        AutoMutex _l(mLock);
+        watch = mpWatch;
+        mpWatch.clear();
+        mIsRunning = false;
+    }
+    if (watch != NULL) {
+        //no callback runs once stopped, the observer may go right after
+        watch->stopWatch();
+    }
 
     return 0;
 }
 
+bool CBootvideoStatusDetect::isStopped(const char *bootvideoType, const char *bootvideo)
+{
+    if ((strcmp(bootvideoType, "1") == 0 && strcmp(bootvideo, "stopped") != 0))
+        return false;
+    else
+        return true;
+}
 
 bool CBootvideoStatusDetect::isBootvideoStopped() {
     char prop_bootvideo_type[PROPERTY_VALUE_MAX];
@@ -51,34 +89,39 @@ bool CBootvideoStatusDetect::isBootvideoStopped() {
     memset(prop_bootvideo_type, '\0', PROPERTY_VALUE_MAX);
     memset(prop_bootvideo, '\0', PROPERTY_VALUE_MAX);
 
-    // 1: boot video;  other: boot animation
-    property_get("service.bootvideo", prop_bootvideo_type, "null");
-    // stopped: bootvideo stopped;  running: bootvideo is running
-    // now bootanim and boot service use the same service name
-    property_get("init.svc.bootanim", prop_bootvideo, "null");
-
-    if ((strcmp(prop_bootvideo_type, "1") == 0 && strcmp(prop_bootvideo, "stopped") != 0))
-        return false;
-    else
-        return true;
+    {
+        AutoMutex _l(mLock);
+        if (mState != STATE_UNKNOWN)
+            return mState == STATE_STOPPED;
+    }
+    property_get(PROP_BOOTVIDEO_TYPE, prop_bootvideo_type, "null");
+    property_get(PROP_BOOTVIDEO, prop_bootvideo, "null");
+    return isStopped(prop_bootvideo_type, prop_bootvideo);
 }
 
-bool CBootvideoStatusDetect::threadLoop()
+void CBootvideoStatusDetect::onPropertyChanged(const char *name __unused, const char *value __unused)
 {
-    if ( mpObserver == NULL ) {
-        return false;
-    }
-    while (!exitPending()) {
-        if (isBootvideoStopped()) {
-            mpObserver->onBootvideoStopped();
-        } else {
-            mpObserver->onBootvideoRunning();
-        }
-        usleep(500 * 1000);
+    char prop_bootvideo_type[CPropertyWatch::VALUE_MAX_LEN];
+    char prop_bootvideo[CPropertyWatch::VALUE_MAX_LEN];
+    int state;
+
+    {
+        AutoMutex _l(mLock);
+        if (mpWatch == NULL)
+            return;
+        mpWatch->getValue(PROP_BOOTVIDEO_TYPE, prop_bootvideo_type, sizeof(prop_bootvideo_type));
+        mpWatch->getValue(PROP_BOOTVIDEO, prop_bootvideo, sizeof(prop_bootvideo));
+        state = isStopped(prop_bootvideo_type, prop_bootvideo) ? STATE_STOPPED : STATE_RUNNING;
+        if (state == mState)
+            return;
+        mState = state;
     }
 
-    LOGD("%s, exiting...\n", "CBootvideoStatusDetect");
-    return false;
+    if (mpObserver == NULL)
+        return;
+    if (state == STATE_STOPPED) {
+        mpObserver->onBootvideoStopped();
+    } else {
+        mpObserver->onBootvideoRunning();
+    }
 }
-
-
@@ -9,10 +9,13 @@
 
 #ifndef C_BOOT_VIDEO_STATUS_DETECT_H
 #define C_BOOT_VIDEO_STATUS_DETECT_H
-#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <CPropertyWatch.h>
 
 using namespace android;
-class CBootvideoStatusDetect: public Thread {
+//the observer is called when the boot video starts or stops, from the
+//property watch thread
+class CBootvideoStatusDetect: public CPropertyWatch::IObserver {
 public:
     CBootvideoStatusDetect();
     ~CBootvideoStatusDetect();
@@ -33,10 +36,19 @@ public:
     };
 
 private:
-    bool threadLoop();
+    enum {
+        STATE_UNKNOWN = -1,
+        STATE_RUNNING = 0,
+        STATE_STOPPED = 1,
+    };
+
+    static bool isStopped(const char *bootvideoType, const char *bootvideo);
+    void onPropertyChanged(const char *name, const char *value);
 
     IBootvideoStatusObserver *mpObserver;
+    sp<CPropertyWatch> mpWatch;
+    int mState;
     bool mIsRunning;
+    Mutex mLock;
 };
 #endif
-
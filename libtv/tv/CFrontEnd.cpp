@@ -28,6 +28,7 @@
 
 #include <string>
 #include <map>
+#include <CStringTable.h>
 
 #ifdef SUPPORT_ADTV
 #include "am_misc.h"
@@ -45,6 +46,12 @@ extern "C" {
 
 CFrontEnd *CFrontEnd::mInstance;
 
+//names of atv_video_std_t and atv_audio_std_t
+static const char videoStdNames[][8] = {"AUTO", "PAL", "NTSC", "SECAM"};
+static const char audioStdNames[][8] = {"DK", "I", "BG", "M", "L", "LC", "AUTO", "MUTE"};
+static const CStringTable videoStdTable(videoStdNames);
+static const CStringTable audioStdTable(audioStdNames);
+
 CFrontEnd *CFrontEnd::getInstance()
 {
     if (NULL == mInstance) mInstance = new CFrontEnd();
@@ -69,10 +76,14 @@ CFrontEnd::CFrontEnd()
     mDemuxDevID = -1;
     mTvPlayDevID = -1;
     mCurPara3 = -1;
+    mSignalSampler = sp<CSignalSampler>::make(this);
 }
 
 CFrontEnd::~CFrontEnd()
 {
+    mSignalSampler->setEnable(false);
+    mSignalSampler->requestExit();
+    mSignalSampler->requestExitAndWait();
 #ifdef SUPPORT_ADTV
     AM_EVT_Unsubscribe(mFrontDevID, AM_FEND_EVT_STATUS_CHANGED, dmd_fend_callback, NULL);
     if (mFrontDevID == FE_DEV_ID)
@@ -172,6 +183,10 @@ int CFrontEnd::Open(int mode)
     mCurPara2 = -1;
     mCurPara3 = -1;
     mCurPara4 = -1;
+    if (mbFEOpened) {
+        mSignalSampler->reset();
+        mSignalSampler->setEnable(true);
+    }
 #endif
     return 0;
 }
@@ -202,6 +217,7 @@ int CFrontEnd::Close()
     mCurPara3 = -1;
     mCurPara4 = -1;
     mFEParas.setFrequency(-1);
+    mSignalSampler->setEnable(false);
 
     if (mbFEOpened) {
         AM_FEND_SetMode(mFrontDevID, FE_ANALOG);
@@ -447,6 +463,7 @@ int CFrontEnd::setPara(const char *paras, bool force )
     }
 
     saveCurrentParas(feparas);
+    mSignalSampler->reset();
     AM_FENDCTRL_DVBFrontendParameters_t dvbfepara;
     memset(&dvbfepara, 0, sizeof(AM_FENDCTRL_DVBFrontendParameters_t));
 
@@ -773,8 +790,13 @@ int CFrontEnd::getSNR()
 {
     int snr = 0;
 #ifdef SUPPORT_ADTV
-    AutoMutex _l( mLock );
-    AM_FEND_GetSNR(mFrontDevID, &snr);
+    fe_signal_sample_t sample;
+    if (mSignalSampler->getCached(&sample)) {
+        snr = sample.snr;
+    } else {
+        AutoMutex _l( mLock );
+        AM_FEND_GetSNR(mFrontDevID, &snr);
+    }
 #endif
     return SNR10ToSQI(snr);
 }
@@ -783,8 +805,13 @@ int CFrontEnd::getBER()
 {
     int ber = 0;
 #ifdef SUPPORT_ADTV
-    AutoMutex _l( mLock );
-    AM_FEND_GetBER(mFrontDevID, &ber);
+    fe_signal_sample_t sample;
+    if (mSignalSampler->getCached(&sample)) {
+        ber = sample.ber;
+    } else {
+        AutoMutex _l( mLock );
+        AM_FEND_GetBER(mFrontDevID, &ber);
+    }
 #endif
     return ber;
 }
@@ -793,12 +820,209 @@ int CFrontEnd::getStrength()
 {
     int Strength = 0;
 #ifdef SUPPORT_ADTV
-    AutoMutex _l( mLock );
-    AM_FEND_GetStrength(mFrontDevID, &Strength);
+    fe_signal_sample_t sample;
+    if (mSignalSampler->getCached(&sample)) {
+        Strength = sample.strength;
+    } else {
+        AutoMutex _l( mLock );
+        AM_FEND_GetStrength(mFrontDevID, &Strength);
+    }
 #endif
     return StrengthToSSI(Strength);
 }
 
+int CFrontEnd::getSignalHistory(fe_signal_sample_t *pSamples, int max)
+{
+    return mSignalSampler->getHistory(pSamples, max);
+}
+
+int CFrontEnd::readSignalLocked(fe_signal_sample_t *pSample)
+{
+#ifdef SUPPORT_ADTV
+    fe_status_t status = (fe_status_t)0;
+    AM_FEND_GetStatus(mFrontDevID, &status);
+    pSample->status = status;
+    pSample->snr = 0;
+    pSample->ber = 0;
+    pSample->strength = 0;
+    AM_FEND_GetSNR(mFrontDevID, &pSample->snr);
+    AM_FEND_GetBER(mFrontDevID, &pSample->ber);
+    AM_FEND_GetStrength(mFrontDevID, &pSample->strength);
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+CFrontEnd::CSignalSampler::CSignalSampler(CFrontEnd *pFrontEnd)
+{
+    mpFrontEnd = pFrontEnd;
+    mEnable = false;
+    mGeneration = 0;
+    mIdle = false;
+    mStaleMs = config_get_int(CFG_SECTION_TV, FRONTEND_SAMPLER_STALE_MS, SIGNAL_SAMPLE_STALE_MS);
+    reset();
+}
+
+CFrontEnd::CSignalSampler::~CSignalSampler()
+{
+}
+
+nsecs_t CFrontEnd::CSignalSampler::getNowMs()
+{
+    return systemTime(SYSTEM_TIME_MONOTONIC) / 1000000;
+}
+
+void CFrontEnd::CSignalSampler::requestExit()
+{
+    //under the lock, the thread checks exitPending before it waits
+    AutoMutex _l(mSampleLock);
+    Thread::requestExit();
+    mSampleCondition.signal();
+}
+
+void CFrontEnd::CSignalSampler::setEnable(bool enable)
+{
+    AutoMutex _l(mSampleLock);
+    if (mEnable == enable) {
+        return;
+    }
+
+    mEnable = enable;
+    if (!enable) {
+        mRingCount = 0;
+    } else if (!isRunning()) {
+        run("CFESignalSampler");
+    }
+    mSampleCondition.signal();
+}
+
+void CFrontEnd::CSignalSampler::reset()
+{
+    AutoMutex _l(mSampleLock);
+    mStableCnt = 0;
+    mRingHead = 0;
+    mRingCount = 0;
+    memset(&mSmoothed, 0, sizeof(mSmoothed));
+    mGeneration++;
+    //a new tune is sampled for a while even before anybody asks
+    mLastReadMs = getNowMs();
+    mIdle = false;
+    mSampleCondition.signal();
+}
+
+int CFrontEnd::CSignalSampler::getGeneration()
+{
+    AutoMutex _l(mSampleLock);
+    return mGeneration;
+}
+
+void CFrontEnd::CSignalSampler::onReadLocked()
+{
+    mLastReadMs = getNowMs();
+    if (mIdle) {
+        mIdle = false;
+        mSampleCondition.signal();
+    }
+}
+
+void CFrontEnd::CSignalSampler::addSample(const fe_signal_sample_t &sample, int generation)
+{
+    AutoMutex _l(mSampleLock);
+    if (generation != mGeneration) {
+        return;
+    }
+    if (mRingCount == 0) {
+        mSmoothed = sample;
+    } else {
+        mSmoothed.snr += (sample.snr - mSmoothed.snr) >> SIGNAL_SAMPLE_EWMA_SHIFT;
+        mSmoothed.ber += (sample.ber - mSmoothed.ber) >> SIGNAL_SAMPLE_EWMA_SHIFT;
+        mSmoothed.strength += (sample.strength - mSmoothed.strength) >> SIGNAL_SAMPLE_EWMA_SHIFT;
+        if ((sample.status & TV_FE_HAS_LOCK) == (mSmoothed.status & TV_FE_HAS_LOCK)) {
+            mStableCnt++;
+        } else {
+            mStableCnt = 0;
+        }
+        mSmoothed.status = sample.status;
+        mSmoothed.timeMs = sample.timeMs;
+    }
+
+    mRing[mRingHead] = sample;
+    mRingHead = (mRingHead + 1) % SIGNAL_SAMPLE_RING_SIZE;
+    if (mRingCount < SIGNAL_SAMPLE_RING_SIZE) {
+        mRingCount++;
+    }
+}
+
+bool CFrontEnd::CSignalSampler::getCached(fe_signal_sample_t *pSample)
+{
+    AutoMutex _l(mSampleLock);
+    onReadLocked();
+    if (!mEnable || mRingCount == 0 || getNowMs() - mSmoothed.timeMs > mStaleMs) {
+        return false;
+    }
+    *pSample = mSmoothed;
+    return true;
+}
+
+int CFrontEnd::CSignalSampler::getHistory(fe_signal_sample_t *pSamples, int max)
+{
+    AutoMutex _l(mSampleLock);
+    onReadLocked();
+    int count = (max < mRingCount) ? max : mRingCount;
+    //newest first
+    for (int i = 0; i < count; i++) {
+        int index = (mRingHead - 1 - i + SIGNAL_SAMPLE_RING_SIZE) % SIGNAL_SAMPLE_RING_SIZE;
+        pSamples[i] = mRing[index];
+    }
+    return count;
+}
+
+bool CFrontEnd::CSignalSampler::threadLoop()
+{
+    while (!exitPending()) {
+        {
+            //frontend closed, sleep until it is opened again
+            AutoMutex _l(mSampleLock);
+            while (!mEnable && !exitPending()) {
+                mSampleCondition.wait(mSampleLock);
+            }
+            //nobody reads, no driver calls until a getter wakes it
+            while (mEnable && !exitPending() && getNowMs() - mLastReadMs > SIGNAL_SAMPLE_IDLE_MS) {
+                mIdle = true;
+                mSampleCondition.wait(mSampleLock);
+            }
+            mIdle = false;
+            if (!mEnable || exitPending()) {
+                continue;
+            }
+        }
+
+        fe_signal_sample_t sample;
+        memset(&sample, 0, sizeof(sample));
+        int ret = 0;
+        int generation;
+        {
+            AutoMutex _l(mpFrontEnd->mLock);
+            generation = getGeneration();
+            ret = mpFrontEnd->readSignalLocked(&sample);
+        }
+        sample.timeMs = getNowMs();
+        if (ret == 0) {
+            addSample(sample, generation);
+        }
+
+        AutoMutex _l(mSampleLock);
+        //poll fast until lock state stays the same for a while
+        int delayMs = (mStableCnt >= SIGNAL_SAMPLE_STABLE_CNT && (sample.status & TV_FE_HAS_LOCK)) ?
+                      SIGNAL_SAMPLE_SLOW_MS : SIGNAL_SAMPLE_FAST_MS;
+        mSampleCondition.waitRelative(mSampleLock, (nsecs_t)delayMs * 1000000);
+    }
+
+    LOGD("%s, signal sampler exit", __FUNCTION__);
+    return false;
+}
+
 int CFrontEnd::formatATVFreq(int tmp_freq)
 {
     //const int ATV_1MHZ = 1000000;
@@ -816,57 +1040,15 @@ int CFrontEnd::formatATVFreq(int tmp_freq)
 
 int CFrontEnd::printVideoStdStr(int compStd, char strBuffer[], int buff_size)
 {
-    memset(strBuffer, 0, buff_size);
     int videoStd = stdAndColorToVideoEnum(compStd);
-    switch (videoStd) {
-    case CC_ATV_VIDEO_STD_AUTO:
-        strcpy(strBuffer, "AUTO");
-        break;
-    case CC_ATV_VIDEO_STD_PAL:
-        strcpy(strBuffer, "PAL");
-        break;
-    case CC_ATV_VIDEO_STD_NTSC:
-        strcpy(strBuffer, "NTSC");
-        break;
-    case CC_ATV_VIDEO_STD_SECAM:
-        strcpy(strBuffer, "SECAM");
-        break;
-    default:
-        strcpy(strBuffer, "UnknownAudio");
-        break;
-    }
-
+    snprintf(strBuffer, buff_size, "%s", videoStdTable.nameOf(videoStd, "UnknownVideo"));
     return 0;
 }
 
 int CFrontEnd::printAudioStdStr(int compStd, char strBuffer[], int buff_size)
 {
-    memset(strBuffer, 0, buff_size);
     int audioStd = stdAndColorToAudioEnum(compStd);
-    switch (audioStd) {
-    case CC_ATV_AUDIO_STD_DK:
-        strcpy(strBuffer, "DK");
-        break;
-    case CC_ATV_AUDIO_STD_I:
-        strcpy(strBuffer, "I");
-        break;
-    case CC_ATV_AUDIO_STD_BG:
-        strcpy(strBuffer, "BG");
-        break;
-    case CC_ATV_AUDIO_STD_M:
-        strcpy(strBuffer, "M");
-        break;
-    case CC_ATV_AUDIO_STD_L:
-        strcpy(strBuffer, "L");
-        break;
-    case CC_ATV_AUDIO_STD_AUTO:
-        strcpy(strBuffer, "AUTO");
-        break;
-    default:
-        strcpy(strBuffer, "UnknownAudio");
-        break;
-    }
-
+    snprintf(strBuffer, buff_size, "%s", audioStdTable.nameOf(audioStd, "UnknownAudio"));
     return 0;
 }
 
@@ -1021,8 +1203,14 @@ int CFrontEnd::checkStatusOnce()
 {
 #ifdef SUPPORT_ADTV
     fe_status_t status;
+    fe_signal_sample_t sample;
+    bool cached = mSignalSampler->getCached(&sample);
     AutoMutex _l( mLock );
-    AM_FEND_GetStatus(mFrontDevID, &status);
+    if (cached) {
+        status = (fe_status_t)sample.status;
+    } else {
+        AM_FEND_GetStatus(mFrontDevID, &status);
+    }
     LOGD("%s,get status = %x", __FUNCTION__, status);
     if (status &  TV_FE_HAS_LOCK) {
         mCurSigEv.mCurSigStaus = FEEvent::EVENT_FE_HAS_SIG;
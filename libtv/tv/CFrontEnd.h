@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <utils/Thread.h>
 #include "CTvLog.h"
 #include "CTvEv.h"
 
@@ -96,6 +97,14 @@ typedef struct dtv_channel_info_s {
     int ber;
 } dtv_channel_info_t;
 
+typedef struct fe_signal_sample_s {
+    nsecs_t timeMs;
+    int status;
+    int snr;
+    int ber;
+    int strength;
+} fe_signal_sample_t;
+
 typedef struct channel_info_s {
     int freq;
     union {
@@ -145,6 +154,16 @@ public:
     static int SNR10ToSQI(int snr);
     static int StrengthToSSI(int strength);
 
+    //background signal quality sampler, getters below are served from its cache
+    static const int SIGNAL_SAMPLE_RING_SIZE = 32;
+    static const int SIGNAL_SAMPLE_FAST_MS = 200;
+    static const int SIGNAL_SAMPLE_SLOW_MS = 1000;
+    static const int SIGNAL_SAMPLE_STALE_MS = 2000;
+    static const int SIGNAL_SAMPLE_STABLE_CNT = 5;
+    static const int SIGNAL_SAMPLE_EWMA_SHIFT = 2;
+    //no getter called for this long, the sampler sleeps until the next one
+    static const int SIGNAL_SAMPLE_IDLE_MS = 10000;
+
     static CFrontEnd *getInstance();
 
     class FEEvent: public CTvEv {
@@ -188,12 +207,17 @@ public:
         return 0;
     }
 
+    int getFrontDevId() const
+    {
+        return mFrontDevID;
+    }
     int getSNR();
     int getBER();
     int getInfo();
     int getStatus();
     int checkStatusOnce();
     int getStrength();
+    int getSignalHistory(fe_signal_sample_t *pSamples, int max);
     int setCvbsAmpOut(int amp);
     int setThreadDelay(int delay) ;
     int getPara(int *mode, int *freq, int *para1, int *para2);
@@ -298,7 +322,46 @@ public:
     static int convertParas(char *paras, int mode, int freq1, int freq2, int para1, int para2, int para3, int para4);
 
 private:
+    class CSignalSampler: public Thread {
+    public:
+        CSignalSampler(CFrontEnd *pFrontEnd);
+        ~CSignalSampler();
+        //also wakes the thread when it is disabled
+        void requestExit();
+        void setEnable(bool enable);
+        //forget samples of the previous tune and go back to fast sampling
+        void reset();
+        //return false if there is no sample newer than the staleness bound
+        bool getCached(fe_signal_sample_t *pSample);
+        int getHistory(fe_signal_sample_t *pSamples, int max);
+    private:
+        bool threadLoop();
+        nsecs_t getNowMs();
+        int getGeneration();
+        //a sample of an older tune is dropped
+        void addSample(const fe_signal_sample_t &sample, int generation);
+        void onReadLocked();
+
+        CFrontEnd *mpFrontEnd;
+        bool mEnable;
+        int mStableCnt;
+        int mStaleMs;
+        fe_signal_sample_t mSmoothed;
+        fe_signal_sample_t mRing[SIGNAL_SAMPLE_RING_SIZE];
+        int mRingHead;
+        int mRingCount;
+        //bumped by reset, under the frontend lock like the tune itself
+        int mGeneration;
+        nsecs_t mLastReadMs;
+        bool mIdle;
+        mutable Mutex mSampleLock;
+        Condition mSampleCondition;
+    };
+
+    int readSignalLocked(fe_signal_sample_t *pSample);
+
     static CFrontEnd *mInstance;
+    sp<CSignalSampler> mSignalSampler;
 
     int mFrontDevID;
     int mVLFrontDevID;
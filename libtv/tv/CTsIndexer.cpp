@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTsIndexer"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <utils/Timers.h>
+#include "CTsIndexer.h"
+#include "CTvLog.h"
+
+#define TS_INDEX_MAGIC          0x54534958 //"TSIX"
+#define TS_INDEX_VERSION        1
+#define TS_READ_BLOCK_SIZE      (TS_PACKET_SIZE * 1024)
+#define TS_CLOCK_WRAP           (1LL << 33)
+
+struct ts_index_header_s {
+    int magic;
+    int version;
+    int64_t fileSize;
+    int64_t fileMtime;
+    int pmtPid;
+    int pcrPid;
+    int videoPid;
+    int videoType;
+    int streamCount;
+    CTsIndexer::StreamInfo streams[CTsIndexer::MAX_STREAM];
+    int timeCount;
+    int keyCount;
+};
+
+CTsIndexer::CTsIndexer()
+{
+    mAbort = false;
+    reset();
+}
+
+CTsIndexer::~CTsIndexer()
+{
+}
+
+void CTsIndexer::reset()
+{
+    mTimePoints.clear();
+    mKeyFrames.clear();
+    memset(mStreams, 0, sizeof(mStreams));
+    mStreamCount = 0;
+    mPmtPid = -1;
+    mPcrPid = -1;
+    mVideoPid = -1;
+    mVideoType = 0;
+    mFirstClock = -1;
+    mLastClock = -1;
+    mLastSampleMs = -SAMPLE_INTERVAL_MS;
+    mCarryLen = 0;
+    mCarryOffset = 0;
+    mSynced = false;
+}
+
+int CTsIndexer::open(const char *path)
+{
+    struct stat st;
+    char idxPath[512];
+
+    if (path == NULL || stat(path, &st) != 0) {
+        LOGE("%s, can not stat %s", __FUNCTION__, path ? path : "null");
+        return -1;
+    }
+    snprintf(idxPath, sizeof(idxPath), "%s%s", path, TS_INDEX_FILE_SUFFIX);
+
+    if (load(idxPath, st.st_size, st.st_mtime) == 0) {
+        return 0;
+    }
+    if (build(path) != 0) {
+        return -1;
+    }
+    //a recording on read-only media is simply indexed again next time
+    save(idxPath, st.st_size, st.st_mtime);
+    return 0;
+}
+
+int CTsIndexer::build(const char *path)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        LOGE("%s, open %s failed", __FUNCTION__, path);
+        return -1;
+    }
+
+    uint8_t *buf = new uint8_t[TS_READ_BLOCK_SIZE];
+    int64_t offset = 0;
+    int len = 0;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
+
+    reset();
+    while (!mAbort && (len = read(fd, buf, TS_READ_BLOCK_SIZE)) > 0) {
+        feed(buf, len, offset);
+        offset += len;
+    }
+    delete[] buf;
+    close(fd);
+    if (mAbort) {
+        LOGD("index %s aborted at %lld bytes", path, (long long)offset);
+        return -1;
+    }
+
+    int costMs = (int)((systemTime(SYSTEM_TIME_MONOTONIC) - start) / 1000000);
+    LOGD("index %s: %lld bytes in %d ms (%lld KB/s), %zu time points, %zu key frames, duration %d ms",
+         path, (long long)offset, costMs, (long long)(offset / (costMs > 0 ? costMs : 1)),
+         mTimePoints.size(), mKeyFrames.size(), getDurationMs());
+    return len < 0 ? -1 : 0;
+}
+
+int CTsIndexer::load(const char *idxPath, int64_t fileSize, int64_t fileMtime)
+{
+    ts_index_header_s header;
+    int fd = ::open(idxPath, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int ret = -1;
+    struct stat st;
+    //the counts must match the size of the file before anything is allocated
+    if (fstat(fd, &st) == 0 && read(fd, &header, sizeof(header)) == sizeof(header)
+        && header.magic == TS_INDEX_MAGIC && header.version == TS_INDEX_VERSION
+        && header.fileSize == fileSize && header.fileMtime == fileMtime
+        && header.streamCount >= 0 && header.streamCount <= MAX_STREAM
+        && header.timeCount >= 0 && header.keyCount >= 0
+        && ((int64_t)header.timeCount + header.keyCount) * (int64_t)sizeof(IndexEntry) + (int64_t)sizeof(header)
+           == (int64_t)st.st_size) {
+        reset();
+        mTimePoints.resize(header.timeCount);
+        mKeyFrames.resize(header.keyCount);
+        ssize_t timeBytes = header.timeCount * sizeof(IndexEntry);
+        ssize_t keyBytes = header.keyCount * sizeof(IndexEntry);
+        if (read(fd, mTimePoints.data(), timeBytes) == timeBytes
+            && read(fd, mKeyFrames.data(), keyBytes) == keyBytes) {
+            mPmtPid = header.pmtPid;
+            mPcrPid = header.pcrPid;
+            mVideoPid = header.videoPid;
+            mVideoType = header.videoType;
+            mStreamCount = header.streamCount;
+            memcpy(mStreams, header.streams, sizeof(mStreams));
+            ret = 0;
+        } else {
+            reset();
+        }
+    }
+    close(fd);
+
+    if (ret != 0) {
+        LOGD("index %s is stale or invalid", idxPath);
+    }
+    return ret;
+}
+
+int CTsIndexer::save(const char *idxPath, int64_t fileSize, int64_t fileMtime)
+{
+    ts_index_header_s header;
+    char tmpPath[520];
+
+    memset(&header, 0, sizeof(header));
+    header.magic = TS_INDEX_MAGIC;
+    header.version = TS_INDEX_VERSION;
+    header.fileSize = fileSize;
+    header.fileMtime = fileMtime;
+    header.pmtPid = mPmtPid;
+    header.pcrPid = mPcrPid;
+    header.videoPid = mVideoPid;
+    header.videoType = mVideoType;
+    header.streamCount = mStreamCount;
+    memcpy(header.streams, mStreams, sizeof(mStreams));
+    header.timeCount = mTimePoints.size();
+    header.keyCount = mKeyFrames.size();
+
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", idxPath);
+    int fd = ::open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOGW("%s, can not create %s", __FUNCTION__, tmpPath);
+        return -1;
+    }
+    ssize_t timeBytes = mTimePoints.size() * sizeof(IndexEntry);
+    ssize_t keyBytes = mKeyFrames.size() * sizeof(IndexEntry);
+    bool ok = write(fd, &header, sizeof(header)) == sizeof(header)
+              && write(fd, mTimePoints.data(), timeBytes) == timeBytes
+              && write(fd, mKeyFrames.data(), keyBytes) == keyBytes;
+    close(fd);
+
+    if (!ok || rename(tmpPath, idxPath) != 0) {
+        LOGW("%s, write %s failed", __FUNCTION__, idxPath);
+        unlink(tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+//first offset with sync bytes one and two packets later, or -1
+int CTsIndexer::findSync(const uint8_t *data, int len)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+
+    while ((p = (const uint8_t *)memchr(p, TS_SYNC_BYTE, end - p)) != NULL) {
+        if ((p + TS_PACKET_SIZE >= end || p[TS_PACKET_SIZE] == TS_SYNC_BYTE)
+            && (p + 2 * TS_PACKET_SIZE >= end || p[2 * TS_PACKET_SIZE] == TS_SYNC_BYTE)) {
+            return p - data;
+        }
+        p++;
+    }
+    return -1;
+}
+
+void CTsIndexer::feed(const uint8_t *data, int len, int64_t offset)
+{
+    int pos = 0;
+
+    //complete the packet split by the previous block
+    if (mCarryLen > 0) {
+        int need = TS_PACKET_SIZE - mCarryLen;
+        if (len < need) {
+            memcpy(mCarry + mCarryLen, data, len);
+            mCarryLen += len;
+            return;
+        }
+        memcpy(mCarry + mCarryLen, data, need);
+        parsePacket(mCarry, mCarryOffset);
+        mCarryLen = 0;
+        pos = need;
+    }
+
+    while (pos < len) {
+        if (!mSynced || data[pos] != TS_SYNC_BYTE) {
+            int sync = findSync(data + pos, len - pos);
+            if (sync < 0) {
+                mSynced = false;
+                return;
+            }
+            pos += sync;
+            mSynced = true;
+        }
+        if (pos + TS_PACKET_SIZE > len) {
+            mCarryLen = len - pos;
+            mCarryOffset = offset + pos;
+            memcpy(mCarry, data + pos, mCarryLen);
+            return;
+        }
+        parsePacket(data + pos, offset + pos);
+        pos += TS_PACKET_SIZE;
+    }
+}
+
+static int64_t readPesClock(const uint8_t *p)
+{
+    return ((int64_t)(p[0] & 0x0e) << 29) | ((int64_t)p[1] << 22) | ((int64_t)(p[2] & 0xfe) << 14)
+           | ((int64_t)p[3] << 7) | (p[4] >> 1);
+}
+
+void CTsIndexer::parsePacket(const uint8_t *pkt, int64_t offset)
+{
+    if (pkt[0] != TS_SYNC_BYTE || (pkt[1] & 0x80)) {
+        return;
+    }
+    int pid = ((pkt[1] & 0x1f) << 8) | pkt[2];
+    bool pusi = (pkt[1] & 0x40) != 0;
+    int afc = (pkt[3] >> 4) & 0x03;
+    int pos = 4;
+    bool rai = false;
+
+    if (afc & 0x02) {
+        int afLen = pkt[4];
+        if (afLen > 0 && afLen <= 183) {
+            int flags = pkt[5];
+            rai = (flags & 0x40) != 0;
+            //pcr drives the time line only when there is no video
+            if ((flags & 0x10) && afLen >= 7 && pid == mPcrPid && mVideoPid < 0) {
+                int64_t pcr = ((int64_t)pkt[6] << 25) | ((int64_t)pkt[7] << 17) | ((int64_t)pkt[8] << 9)
+                              | ((int64_t)pkt[9] << 1) | (pkt[10] >> 7);
+                addTimePoint(pcr, offset, false);
+            }
+        }
+        pos += 1 + afLen;
+    }
+    if (!(afc & 0x01) || pos >= TS_PACKET_SIZE || !pusi) {
+        return;
+    }
+
+    const uint8_t *payload = pkt + pos;
+    int payloadLen = TS_PACKET_SIZE - pos;
+    if (pid == 0) {
+        parsePat(payload, payloadLen);
+    } else if (pid == mPmtPid) {
+        parsePmt(payload, payloadLen);
+    } else if (pid == mVideoPid && payloadLen >= 19
+               && payload[0] == 0 && payload[1] == 0 && payload[2] == 1) {
+        int ptsDtsFlags = payload[7] >> 6;
+        int headerLen = 9 + payload[8];
+        if (!(ptsDtsFlags & 0x02) || headerLen > payloadLen) {
+            return;
+        }
+        //dts is monotonic, pts is not once b frames are reordered
+        int64_t clock = readPesClock(payload + ((ptsDtsFlags == 3) ? 14 : 9));
+        bool key = rai || isKeyFrame(payload + headerLen, payloadLen - headerLen);
+        addTimePoint(clock, offset, key);
+    }
+}
+
+void CTsIndexer::parsePat(const uint8_t *data, int len)
+{
+    int pointer = data[0];
+    const uint8_t *sec = data + 1 + pointer;
+    int secLen;
+
+    if (1 + pointer + 8 > len || sec[0] != 0x00) {
+        return;
+    }
+    secLen = ((sec[1] & 0x0f) << 8) | sec[2];
+    int end = 3 + secLen - 4;
+    if (end > len - 1 - pointer) {
+        end = len - 1 - pointer;
+    }
+    //recordings carry one program, take the first one
+    for (int i = 8; i + 4 <= end; i += 4) {
+        int program = (sec[i] << 8) | sec[i + 1];
+        if (program != 0) {
+            mPmtPid = ((sec[i + 2] & 0x1f) << 8) | sec[i + 3];
+            return;
+        }
+    }
+}
+
+void CTsIndexer::parsePmt(const uint8_t *data, int len)
+{
+    int pointer = data[0];
+    const uint8_t *sec = data + 1 + pointer;
+
+    if (1 + pointer + 12 > len || sec[0] != 0x02 || mStreamCount > 0) {
+        return;
+    }
+    int secLen = ((sec[1] & 0x0f) << 8) | sec[2];
+    int end = 3 + secLen - 4;
+    if (end > len - 1 - pointer) {
+        end = len - 1 - pointer;
+    }
+    mPcrPid = ((sec[8] & 0x1f) << 8) | sec[9];
+    int infoLen = ((sec[10] & 0x0f) << 8) | sec[11];
+
+    for (int i = 12 + infoLen; i + 5 <= end && mStreamCount < MAX_STREAM; ) {
+        int type = sec[i];
+        int pid = ((sec[i + 1] & 0x1f) << 8) | sec[i + 2];
+        int esInfoLen = ((sec[i + 3] & 0x0f) << 8) | sec[i + 4];
+        mStreams[mStreamCount].pid = pid;
+        mStreams[mStreamCount].type = type;
+        mStreamCount++;
+        //mpeg1/2, mpeg4, h264, hevc, avs
+        if (mVideoPid < 0 && (type == 0x01 || type == 0x02 || type == 0x10 || type == 0x1b
+                              || type == 0x24 || type == 0x42)) {
+            mVideoPid = pid;
+            mVideoType = type;
+        }
+        i += 5 + esInfoLen;
+    }
+}
+
+//look for an intra picture start in the first payload of a video pes
+bool CTsIndexer::isKeyFrame(const uint8_t *data, int len)
+{
+    for (int i = 0; i + 5 < len; i++) {
+        if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+            continue;
+        }
+        int code = data[i + 3];
+        switch (mVideoType) {
+        case 0x1b: {
+            int nal = code & 0x1f;
+            if (nal == 5 || nal == 7) {
+                return true;
+            }
+            if (nal == 1) {
+                return false;
+            }
+            break;
+        }
+        case 0x24: {
+            int nal = (code >> 1) & 0x3f;
+            if ((nal >= 16 && nal <= 21) || nal == 32 || nal == 33) {
+                return true;
+            }
+            if (nal < 16) {
+                return false;
+            }
+            break;
+        }
+        case 0x01:
+        case 0x02:
+            //sequence header, or picture header with coding type I
+            if (code == 0xb3) {
+                return true;
+            }
+            if (code == 0x00) {
+                return ((data[i + 5] >> 3) & 0x07) == 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+void CTsIndexer::addTimePoint(int64_t clock, int64_t offset, bool key)
+{
+    //unwrap the 33 bit clock against the previous value
+    if (mLastClock >= 0) {
+        clock += mLastClock - (mLastClock % TS_CLOCK_WRAP);
+        if (clock < mLastClock - TS_CLOCK_WRAP / 2) {
+            clock += TS_CLOCK_WRAP;
+        } else if (clock > mLastClock + TS_CLOCK_WRAP / 2) {
+            clock -= TS_CLOCK_WRAP;
+        }
+    }
+    if (mFirstClock < 0) {
+        mFirstClock = clock;
+    }
+    mLastClock = clock;
+
+    int timeMs = (int)((clock - mFirstClock) / 90);
+    IndexEntry entry;
+    entry.offset = offset;
+    entry.timeMs = timeMs;
+
+    //keep both lists sorted, a clock jump backwards is skipped until time catches up
+    if (key && (mKeyFrames.empty() || timeMs > mKeyFrames.back().timeMs)) {
+        mKeyFrames.push_back(entry);
+    }
+    if (timeMs >= mLastSampleMs + SAMPLE_INTERVAL_MS || (key && timeMs > mLastSampleMs)) {
+        mTimePoints.push_back(entry);
+        mLastSampleMs = timeMs;
+    }
+}
+
+//index of the last entry with time <= timeMs, or -1
+int CTsIndexer::lookup(const std::vector<IndexEntry> &entries, int timeMs)
+{
+    int lo = 0, hi = (int)entries.size() - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (entries[mid].timeMs <= timeMs) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+int CTsIndexer::findKeyFrame(int timeMs, IndexEntry *entry) const
+{
+    int i = lookup(mKeyFrames, timeMs);
+    if (i < 0) {
+        return -1;
+    }
+    *entry = mKeyFrames[i];
+    return 0;
+}
+
+int CTsIndexer::findNextKeyFrame(int timeMs, IndexEntry *entry) const
+{
+    int i = lookup(mKeyFrames, timeMs) + 1;
+    if (i >= (int)mKeyFrames.size()) {
+        return -1;
+    }
+    *entry = mKeyFrames[i];
+    return 0;
+}
+
+int CTsIndexer::findOffset(int timeMs, IndexEntry *entry) const
+{
+    int i = lookup(mTimePoints, timeMs);
+    if (i < 0) {
+        return -1;
+    }
+    *entry = mTimePoints[i];
+    return 0;
+}
+
+int CTsIndexer::findTime(int64_t offset) const
+{
+    int lo = 0, hi = (int)mTimePoints.size() - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (mTimePoints[mid].offset <= offset) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found < 0 ? 0 : mTimePoints[found].timeMs;
+}
+
+int CTsIndexer::getDurationMs() const
+{
+    return mTimePoints.empty() ? 0 : mTimePoints.back().timeMs;
+}
+
+int CTsIndexer::getStreams(StreamInfo *streams, int max) const
+{
+    int count = mStreamCount < max ? mStreamCount : max;
+    memcpy(streams, mStreams, count * sizeof(StreamInfo));
+    return count;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTSINDEXER_H_)
+#define _CTSINDEXER_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#define TS_PACKET_SIZE          (188)
+#define TS_SYNC_BYTE            (0x47)
+#define TS_INDEX_FILE_SUFFIX    ".idx"
+
+//time -> byte offset index of a recorded transport stream, built from the
+//PAT/PMT, PCR and video PES headers and cached next to the file as <file>.idx
+class CTsIndexer {
+public:
+    static const int MAX_STREAM = 16;
+    //a time point is kept at most every SAMPLE_INTERVAL_MS, key frames always
+    static const int SAMPLE_INTERVAL_MS = 500;
+
+    struct IndexEntry {
+        int64_t offset;
+        int timeMs;
+    };
+
+    struct StreamInfo {
+        int pid;
+        int type;
+    };
+
+    CTsIndexer();
+    ~CTsIndexer();
+
+    //load <file>.idx if it still matches the file, otherwise index the file and save it
+    int open(const char *path);
+    //make an open() running on another thread give up, the index stays invalid
+    void abort()
+    {
+        mAbort = true;
+    }
+    void reset();
+    //feed data which starts at byte offset of the file, may be called incrementally
+    void feed(const uint8_t *data, int len, int64_t offset);
+
+    //last key frame at or before timeMs, O(log n)
+    int findKeyFrame(int timeMs, IndexEntry *entry) const;
+    //first key frame after timeMs
+    int findNextKeyFrame(int timeMs, IndexEntry *entry) const;
+    //nearest time point at or before timeMs
+    int findOffset(int timeMs, IndexEntry *entry) const;
+    //time of the data at offset
+    int findTime(int64_t offset) const;
+    int getDurationMs() const;
+    int getVideoPid() const
+    {
+        return mVideoPid;
+    }
+    int getPcrPid() const
+    {
+        return mPcrPid;
+    }
+    int getStreams(StreamInfo *streams, int max) const;
+
+private:
+    int build(const char *path);
+    int load(const char *idxPath, int64_t fileSize, int64_t fileMtime);
+    int save(const char *idxPath, int64_t fileSize, int64_t fileMtime);
+    int findSync(const uint8_t *data, int len);
+    void parsePacket(const uint8_t *pkt, int64_t offset);
+    void parsePat(const uint8_t *data, int len);
+    void parsePmt(const uint8_t *data, int len);
+    bool isKeyFrame(const uint8_t *data, int len);
+    void addTimePoint(int64_t clock, int64_t offset, bool key);
+    static int lookup(const std::vector<IndexEntry> &entries, int timeMs);
+
+    std::vector<IndexEntry> mTimePoints;
+    std::vector<IndexEntry> mKeyFrames;
+    StreamInfo mStreams[MAX_STREAM];
+    int mStreamCount;
+    int mPmtPid;
+    int mPcrPid;
+    int mVideoPid;
+    int mVideoType;
+    //90kHz clock, unwrapped from 33 bits
+    int64_t mFirstClock;
+    int64_t mLastClock;
+    int mLastSampleMs;
+    //partial packet carried between feed() calls
+    uint8_t mCarry[TS_PACKET_SIZE];
+    int mCarryLen;
+    int64_t mCarryOffset;
+    bool mSynced;
+    std::atomic<bool> mAbort;
+};
+
+#endif //_CTSINDEXER_H_
@@ -80,6 +80,9 @@ CTv::CTv():mTvDmx(0), mTvDmx1(1), mTvDmx2(2)
     int len = property_get("tv.tvconfig.force_copy", buf, "true");*/
     mPanel = CTvPanel::getInstance();
     mTvMsgQueue = sp<CTvMsgQueue>::make(this);
+    CTvRecArbiter::getInstance()->setObserver(this);
+    PlayerManager::getInstance().setReaper(mTvMsgQueue.get());
+    RecorderManager::getInstance().setReaper(mTvMsgQueue.get());
     mDevicesPollStatusDetectThread = sp<CDevicesPollStatusDetect>::make();
 #ifdef SUPPORT_PANEL
     mPanel->AM_PANEL_Init();
@@ -101,6 +104,9 @@ CTv::CTv():mTvDmx(0), mTvDmx1(1), mTvDmx2(2)
     mEnableLockModule = false;
     mSupportChannelLock = false;
     mBlockState = BLOCK_STATE_NONE;
+    mChannelLocked = false;
+    mRatingBlocked = false;
+    mUnblockRequested = false;
     mIsLoadEdidWithPort = false;
     mTvMsgQueue->startMsgQueue();
     /*int kernelVersion = getKernelMajorVersion();
@@ -129,6 +135,15 @@ CTv::CTv():mTvDmx(0), mTvDmx1(1), mTvDmx2(2)
     if ( CTvDimension::isDimensionTblExist() == false ) {
         CTvDimension::builtinAtscDimensions();
     }
+    if (config_get_int(CFG_SECTION_TV, CFG_DTV_VCHIP_CHECK_ENABLE, 0) != 0) {
+        mpVchipCheck = sp<CTvVchipCheck>::make();
+        mpVchipCheck->setTime(&mTvTime);
+        mpVchipCheck->setObserver(this);
+        mpVchipCheck->startVChipCheck();
+    }
+    CTvBookingScheduler::getInstance()->setTime(&mTvTime);
+    CTvBookingScheduler::getInstance()->setObserver(this);
+    CTvBookingScheduler::getInstance()->startScheduler();
 
     mFactoryMode.init();
     mDtvScanRunningStatus = DTV_SCAN_RUNNING_NORMAL;
@@ -182,6 +197,14 @@ CTv::CTv():mTvDmx(0), mTvDmx1(1), mTvDmx2(2)
 CTv::~CTv()
 {
     mpObserver = NULL;
+    if (mpVchipCheck != NULL) {
+        mpVchipCheck->stopVChipCheck();
+        mpVchipCheck->join();
+    }
+    CTvBookingScheduler::getInstance()->stopScheduler();
+    CTvBookingScheduler::getInstance()->setObserver(NULL);
+    PlayerManager::getInstance().setReaper(NULL);
+    RecorderManager::getInstance().setReaper(NULL);
     CTvDatabase::deleteTvDb();
     tv_config_unload();
     tv_scan_config_unload();
@@ -199,6 +222,11 @@ void CTv::onEvent ( const CTvScanner::ScannerEvent &ev )
 {
     LOGD ( "%s, CTv::onEvent lockStatus = %d type = %d\n", __FUNCTION__,  ev.mLockedStatus, ev.mType );
 
+    //the services are stored, the planner stats follow the new rows
+    if ( ev.mType == CTvScanner::ScannerEvent::EVENT_STORE_END ) {
+        CTvDatabase::GetTvDb()->analyzeTables();
+    }
+
     if ( mDtvScanRunningStatus == DTV_SCAN_RUNNING_ANALYZE_CHANNEL ) {
         if ( ev.mType == CTvScanner::ScannerEvent::EVENT_SCAN_END ) {
             CMessage msg;
@@ -307,6 +335,14 @@ void CTv::onEvent ( const CTvEpg::EpgEvent &ev )
     case CTvEpg::EpgEvent::EVENT_TDT_END:
         LOGD ( "%s, CTv::onEvent epg time = %ld", __FUNCTION__, ev.time );
         mTvTime.setTime ( ev.time );
+        if (mpVchipCheck != NULL)
+            mpVchipCheck->requestCheck();
+        CTvBookingScheduler::getInstance()->onTimeChanged();
+        break;
+
+    case CTvEpg::EpgEvent::EVENT_PROGRAM_EVENTS_UPDATE:
+        if (mpVchipCheck != NULL)
+            mpVchipCheck->onEventsUpdated((int)ev.programID);
         break;
 
     case CTvEpg::EpgEvent::EVENT_CHANNEL_UPDATE: {
@@ -338,6 +374,28 @@ void CTv::onEvent(const CTvRecord::RecEvent &ev)
             sendTvEvent(RecorderEvent);
             }break;
         case CTvRecord::RecEvent::EVENT_REC_STOP: {
+            //a recording ended by an error goes away like a stopped one
+            if (ev.error != 0) {
+                LOGW("recorder(%s) stopped with error(%d)", ev.id.c_str(), ev.error);
+                doRecordingCommand(RECORDING_CMD_STOP, ev.id.c_str(), NULL);
+            }
+            TvEvent::RecorderEvent RecorderEvent;
+            RecorderEvent.mStatus = TvEvent::RecorderEvent::EVENT_RECORD_STOP;
+            RecorderEvent.mError = (int)ev.error;
+            RecorderEvent.mId = String8(ev.id.c_str());
+            sendTvEvent(RecorderEvent);
+            }break;
+        case CTvRecord::RecEvent::EVENT_REC_LOW_SPACE: {
+            TvEvent::RecorderEvent RecorderEvent;
+            RecorderEvent.mStatus = TvEvent::RecorderEvent::EVENT_RECORD_LOW_SPACE;
+            RecorderEvent.mError = (int)ev.error;
+            RecorderEvent.mId = String8(ev.id.c_str());
+            sendTvEvent(RecorderEvent);
+            }break;
+        case CTvRecord::RecEvent::EVENT_REC_NO_SPACE: {
+            //scheduled recordings stop hard when the quota or the disk is used up
+            LOGW("recorder(%s) out of space, stop it", ev.id.c_str());
+            doRecordingCommand(RECORDING_CMD_STOP, ev.id.c_str(), NULL);
             TvEvent::RecorderEvent RecorderEvent;
             RecorderEvent.mStatus = TvEvent::RecorderEvent::EVENT_RECORD_STOP;
             RecorderEvent.mError = (int)ev.error;
@@ -349,9 +407,137 @@ void CTv::onEvent(const CTvRecord::RecEvent &ev)
     }
 }
 
+void CTv::onRecPreempt(const char *id)
+{
+    //called with the arbiter unlocked, the recorder goes before the new one starts
+    LOGW("recorder(%s) preempted", id);
+    stopRecording(id, NULL);
+    TvEvent::RecorderEvent RecorderEvent;
+    RecorderEvent.mStatus = TvEvent::RecorderEvent::EVENT_RECORD_STOP;
+    RecorderEvent.mError = -EBUSY;
+    RecorderEvent.mId = String8(id);
+    sendTvEvent(RecorderEvent);
+}
+
+void CTv::onRecGranted(const char *id, const char *param)
+{
+    //called from whoever released the resources, start it on the message thread
+    CMessage msg;
+    msg.mDelayMs = 0;
+    msg.mType = CTvMsgQueue::TV_MSG_REC_GRANTED;
+    tv_rec_grant_t *grant = (tv_rec_grant_t *)msg.mpPara;
+    if (strlen(id) >= sizeof(grant->id) || strlen(param) >= sizeof(grant->param)) {
+        LOGE("queued recorder(%s) granted, param too long", id);
+        CTvRecArbiter::getInstance()->release(id);
+        return;
+    }
+    strcpy(grant->id, id);
+    strcpy(grant->param, param);
+    mTvMsgQueue->sendMsg(msg);
+}
+
+void CTv::onRecGrantedLocked(const char *id, const char *param)
+{
+    AutoMutex _l(mLock);
+    //stopped or started again while the message was queued
+    if (!CTvRecArbiter::getInstance()->isGranted(id) || RecorderManager::getInstance().getDev(id)) {
+        LOGD("granted recorder(%s) gone", id);
+        return;
+    }
+    LOGD("queued recorder(%s) granted", id);
+    CTvRecord::IObserver *observer = mTvMsgQueue.get();
+    {
+        AutoMutex _l(mQueuedRecLock);
+        ssize_t index = mQueuedRecObservers.indexOfKey(String8(id));
+        if (index >= 0) {
+            observer = mQueuedRecObservers.valueAt(index);
+            mQueuedRecObservers.removeItemsAt(index);
+        }
+    }
+    if (startRecording(id, param, observer) != 0) {
+        TvEvent::RecorderEvent RecorderEvent;
+        RecorderEvent.mStatus = TvEvent::RecorderEvent::EVENT_RECORD_STOP;
+        RecorderEvent.mError = -EIO;
+        RecorderEvent.mId = String8(id);
+        sendTvEvent(RecorderEvent);
+    }
+}
+
+void CTv::onVchipBlock(int progId, bool blocked)
+{
+    LOGD("vchip: program %d %s", progId, blocked ? "blocked" : "unblocked");
+    SetRatingBlocked(blocked);
+}
+
+int CTv::startBookedRecording(const CTvBookingScheduler::Booking &booking, const char *id)
+{
+    CTvProgram prog;
+    if (CTvProgram::selectByID(booking.programId, prog) != 0) {
+        LOGE("booking: program %d of event %d not found", booking.programId, booking.eventId);
+        return -1;
+    }
+    CTvChannel channel;
+    prog.getChannel(channel);
+
+    int vpid = 0x1fff, vfmt = -1, apid = 0x1fff, afmt = -1;
+    CTvProgram::Video *pV = prog.getVideo();
+    if (pV != NULL) {
+        vpid = pV->getPID();
+        vfmt = pV->getFormat();
+    }
+    int aindex = prog.getCurrentAudio(String8("eng"));
+    if (aindex >= 0) {
+        CTvProgram::Audio *pA = prog.getAudio(aindex);
+        if (pA != NULL) {
+            apid = pA->getPID();
+            afmt = pA->getFormat();
+        }
+    }
+
+    //nothing free: queue on the first tuner and dvr channel
+    int fend = 0, dvr = 0;
+    CTvRecArbiter::getInstance()->findFree(id, channel.getFrequency(), &fend, &dvr);
+
+    const char *path = config_get_str(CFG_SECTION_TV, CFG_DTV_BOOKING_REC_PATH, BOOKING_REC_DEFAULT_PATH);
+    String8 param = String8::format(
+        "{\"fe\":%d,\"dvr\":%d,\"freq\":%d,\"path\":\"%s\",\"prefix\":\"Booking%d\","
+        "\"v\":{\"pid\":%d,\"fmt\":%d},\"a\":{\"pid\":%d,\"fmt\":%d}}",
+        fend, dvr, channel.getFrequency(), path, booking.eventId, vpid, vfmt, apid, afmt);
+    return doRecordingCommand(RECORDING_CMD_START, id, param.string());
+}
+
+void CTv::onBookingEvent(const CTvBookingScheduler::Booking &booking, int action)
+{
+    LOGD("booking: event %d action %d", booking.eventId, action);
+    char id[32];
+    snprintf(id, sizeof(id), "booking%d", booking.eventId);
+    if (action == CTvBookingScheduler::ACTION_RECORD_START) {
+        int ret = startBookedRecording(booking, id);
+        if (ret != 0 && ret != RECORDING_QUEUED) {
+            LOGE("booking: recording %s of event %d failed(%d)", id, booking.eventId, ret);
+        }
+    } else if (action == CTvBookingScheduler::ACTION_RECORD_STOP) {
+        doRecordingCommand(RECORDING_CMD_STOP, id, NULL);
+    }
+    //the scheduler dropped the booking row with any action but a recording start
+    if (action != CTvBookingScheduler::ACTION_RECORD_START) {
+        CTvBooking::clearEventFlag(booking.eventId);
+    }
+
+    TvEvent::BookingEvent ev;
+    ev.mAction = action;
+    ev.mEventId = booking.eventId;
+    ev.mProgramId = booking.programId;
+    ev.mStart = booking.start;
+    ev.mDuration = booking.duration;
+    sendTvEvent(ev);
+}
+
 void CTv::onEvent (const CTvRrt::RrtEvent &ev)
 {
     LOGD("RRT event!\n");
+    if (mpVchipCheck != NULL)
+        mpVchipCheck->requestCheck();
     sendTvEvent ( ev );
 }
 
@@ -438,9 +624,9 @@ void CTv::onEvent(const CAv::AVEvent &ev)
         //fix me: get the player, [only one player can run concurrently]
         //the av event should be handled by player..
         //need refactoring here
-        CDTVTvPlayer *player = (CDTVTvPlayer *)PlayerManager::getInstance().getFirstDevWithIdContains("atsc");
+        PlayerManager::Handle player = PlayerManager::getInstance().getFirstDevWithIdContains("atsc");
         if (player)
-            player->onPlayUpdate(ev);
+            ((CDTVTvPlayer *)player.get())->onPlayUpdate(ev);
         else {
             LOGD("no atsc player found");
         }
@@ -576,6 +762,17 @@ void CTv::CTvMsgQueue::handleMessage ( CMessage &msg )
         break;
     }
 
+    case TV_MSG_REC_GRANTED: {
+        tv_rec_grant_t *grant = (tv_rec_grant_t *)msg.mpPara;
+        mpTv->onRecGrantedLocked(grant->id, grant->param);
+        break;
+    }
+
+    case TV_MSG_REAP_DEVS:
+        RecorderManager::getInstance().reap();
+        PlayerManager::getInstance().reap();
+        break;
+
     default:
         break;
     }
@@ -670,6 +867,14 @@ void CTv::CTvMsgQueue::onEvent(const CTvin::CheckSourceValidEvent &ev)
     this->sendMsg ( msg );
 }
 
+void CTv::CTvMsgQueue::onDevGarbage()
+{
+    CMessage msg;
+    msg.mDelayMs = 0;
+    msg.mType = CTvMsgQueue::TV_MSG_REAP_DEVS;
+    this->sendMsg ( msg );
+}
+
 int CTv::setTvObserver ( TvIObserver *ob )
 {
     mpObserver = ob;
@@ -767,6 +972,11 @@ int CTv::Scan(const char *feparas, const char *scanparas) {
     mDtvScanRunningStatus = DTV_SCAN_RUNNING_NORMAL;
     mTvScanner->SetCurrentLanguage(GetCurrentLanguage());
 
+    CTvScanScheduler *scheduler = CTvScanScheduler::getInstance();
+    if (scheduler->canSchedule(sp)) {
+        scheduler->setObserver(mTvMsgQueue.get());
+        return scheduler->Scan(fp, sp);
+    }
     return mTvScanner->Scan(fp, sp);
 }
 
@@ -992,6 +1202,7 @@ int CTv::stopScan()
     //CVpp::getInstance()->VPP_setVideoColor(false);
     mpTvin->Tvin_StopDecoder();
     //mTvEpg.leaveChannel();
+    CTvScanScheduler::getInstance()->stopScan();
     mTvScanner->stopScan();
     mFrontDev->Close();
     mpTvin->VDIN_ClosePort();
@@ -1007,6 +1218,9 @@ int CTv::pauseScan()
         LOGD("%s, tv not scanning ,return\n", __FUNCTION__);
         return 0;
     }
+    if (CTvScanScheduler::getInstance()->isScanning()) {
+        return CTvScanScheduler::getInstance()->pauseScan();
+    }
     return mTvScanner->pauseScan();
 }
 
@@ -1016,6 +1230,9 @@ int CTv::resumeScan()
         LOGD("%s, tv not scanning ,return\n", __FUNCTION__);
         return 0;
     }
+    if (CTvScanScheduler::getInstance()->isScanning()) {
+        return CTvScanScheduler::getInstance()->resumeScan();
+    }
     return mTvScanner->resumeScan();
 }
 
@@ -1244,6 +1461,15 @@ int CTv::playDtvProgramUnlocked (const char *feparas, int mode, int freq, int pa
     }
 
     CFrontEnd::FEParas fp(feparas);
+    //live viewing keeps its tuner and demux against recordings of a lower priority,
+    //when even that is not enough the current program stays on
+    int liveFreq = fp.getFrequency();
+    if (CTvRecArbiter::getInstance()->request(REC_ARBITER_LIVE_ID, NULL, CTvRecArbiter::PRIORITY_LIVE,
+            mFrontDev->getFrontDevId(), (liveFreq > 0) ? liveFreq : ((freq > 0) ? freq : 0), -1)
+            != CTvRecArbiter::ARBITER_GRANTED) {
+        LOGE("[%s] live resources not granted", __FUNCTION__);
+        return -EBUSY;
+    }
     SetSourceSwitchInputLocked(m_source_input_virtual, SOURCE_DTV);
 
     FeMode = fp.getFEMode().getBase();
@@ -1592,6 +1818,7 @@ int CTv::stopPlaying(bool isShowTestScreen __unused, bool resetFE)
             ClearAnalogFrontEnd();
     } else if (m_source_input ==  SOURCE_DTV) {
         mAv.StopTS ();
+        CTvRecArbiter::getInstance()->release(REC_ARBITER_LIVE_ID);
     }
 
     mTvAction &= ~TV_ACTION_PLAYING;
@@ -1727,6 +1954,8 @@ bool CTv::Tv_Stop_Analyze_Ts()
 int CTv::saveATVProgramID ( int dbID )
 {
     config_set_int ( CFG_SECTION_TV, "atv.get.program.id", dbID );
+    if (mpVchipCheck != NULL)
+        mpVchipCheck->setProgram(dbID);
     return 0;
 }
 
@@ -1738,6 +1967,8 @@ int CTv::getATVProgramID ( void )
 int CTv::saveDTVProgramID ( int dbID )
 {
     config_set_int ( CFG_SECTION_TV, "dtv.get.program.id", dbID );
+    if (mpVchipCheck != NULL)
+        mpVchipCheck->setProgram(dbID);
     return 0;
 }
 
@@ -2031,6 +2262,9 @@ int CTv::OpenTv ( void )
     mEnableLockModule = (SSMReadChannelLockEnValue() == 0);
     mSupportChannelLock = (config_get_int(CFG_SECTION_TV, CFG_TV_CHANNEL_BLOCK_INSERVER, 0) > 0);
     mBlockState = BLOCK_STATE_NONE;
+    mChannelLocked = false;
+    mRatingBlocked = false;
+    mUnblockRequested = false;
     mChannelBlockState = BLOCK_STATE_NONE;
     mChannelLastBlockState = BLOCK_STATE_NONE;
     mBlockStatusChanged = false;
@@ -2171,6 +2405,9 @@ int CTv::StopTvLock ( void )
         // }
 
         mBlockState = BLOCK_STATE_NONE;
+        mChannelLocked = false;
+        mRatingBlocked = false;
+        mUnblockRequested = false;
         mChannelBlockState = BLOCK_STATE_NONE;
         mChannelLastBlockState = BLOCK_STATE_NONE;
         mBlockStatusChanged = false;
@@ -4060,23 +4297,23 @@ void CTv::onVdin2SignalChange() {
 
 }
 
-CTvRecord *CTv::getRecorder(const char *id, const char *param) {
-    CTvRecord *recorder = RecorderManager::getInstance().getDev(id);
+RecorderManager::Handle CTv::getRecorder(const char *id, const char *param) {
+    RecorderManager::Handle recorder = RecorderManager::getInstance().getDev(id);
     if (recorder) {
         recorder->stop(NULL);
         recorder->setupDefault(param);
         return recorder;
     }
-    recorder = new CTvRecord();
-    recorder->setupDefault(param);
-    recorder->setId(id);
-    int err = RecorderManager::getInstance().addDev(*recorder);
+    CTvRecord *dev = new CTvRecord();
+    dev->setupDefault(param);
+    dev->setId(id);
+    int err = RecorderManager::getInstance().addDev(*dev);
     if (err) {
         LOGE("create Recorder(%s) fail(%d)", toReadable(id), err);
-        delete recorder;
-        recorder = NULL;
+        delete dev;
+        return recorder;
     }
-    return recorder;
+    return RecorderManager::getInstance().getDev(id);
 }
 
 int CTv::prepareRecording(const char *id, const char *param)
@@ -4089,23 +4326,47 @@ int CTv::prepareRecording(const char *id, const char *param)
 
 int CTv::startRecording(const char *id, const char *param, CTvRecord::IObserver *observer)
 {
-    CTvRecord *recorder = NULL;
+    RecorderManager::Handle recorder;
     int ret = -1;
+    int priority = paramGetInt(param, NULL, "priority",
+        (strcmp(id, "timeshifting") == 0) ? CTvRecArbiter::PRIORITY_TIMESHIFT : CTvRecArbiter::PRIORITY_SCHEDULED);
+    ret = CTvRecArbiter::getInstance()->request(id, param, priority, paramGetInt(param, NULL, "fe", 0),
+        paramGetInt(param, NULL, "freq", 0), paramGetInt(param, NULL, "dvr", 0));
+    if (ret == CTvRecArbiter::ARBITER_QUEUED) {
+        //started by onRecGranted when the resources are released
+        LOGD("recorder(%s) queued", toReadable(id));
+        AutoMutex _l(mQueuedRecLock);
+        mQueuedRecObservers.replaceValueFor(String8(id), observer);
+        return RECORDING_QUEUED;
+    } else if (ret != CTvRecArbiter::ARBITER_GRANTED) {
+        return -EBUSY;
+    }
+
     if (!(recorder = getRecorder(id, param))) {
         LOGD("recorder(%s) not found", toReadable(id));
+        CTvRecArbiter::getInstance()->release(id);
         return -1;
     }
     recorder->setObserver(observer);
     ret = recorder->start(param);
-    if (ret != 0)
+    if (ret != 0) {
+        //the arbiter is released with the recorder
         RecorderManager::getInstance().removeDev(id);
+    }
     return ret;
 }
 
 int CTv::stopRecording(const char *id, const char *param)
 {
-    CTvRecord *recorder = NULL;
+    RecorderManager::Handle recorder;
     if (!(recorder = RecorderManager::getInstance().getDev(id))) {
+        //queued, or granted with the start still on the message queue
+        if (CTvRecArbiter::getInstance()->isQueued(id) || CTvRecArbiter::getInstance()->isGranted(id)) {
+            CTvRecArbiter::getInstance()->release(id);
+            AutoMutex _l(mQueuedRecLock);
+            mQueuedRecObservers.removeItem(String8(id));
+            return 0;
+        }
         LOGD("recorder(%s) not found", toReadable(id));
         return -1;
     }
@@ -4135,8 +4396,8 @@ int CTv::doRecordingCommand(int cmd, const char *id, const char *param)
     return ret;
 }
 
-CTvPlayer *CTv::getPlayer(const char *id, const char *param) {
-    CTvPlayer *player = PlayerManager::getInstance().getDev(id);
+PlayerManager::Handle CTv::getPlayer(const char *id, const char *param) {
+    PlayerManager::Handle player = PlayerManager::getInstance().getDev(id);
     if (player) {
         player->setupDefault(param);
         player->stop(param);
@@ -4149,20 +4410,22 @@ CTvPlayer *CTv::getPlayer(const char *id, const char *param) {
 
     std::string type = paramGetString(param, NULL, "type", "dtv");
     LOGE("get Player fail(%s)", param);
+    CTvPlayer *dev = NULL;
     if (type.compare("dtv") == 0)
-        player = new CDTVTvPlayer(this);
+        dev = new CDTVTvPlayer(this);
     else if (type.compare("atv") == 0)
-        player = new CATVTvPlayer(this);
+        dev = new CATVTvPlayer(this);
 
-    if (player) {
-        player->setupDefault(param);
-        player->setId(id);
-        int err = PlayerManager::getInstance().addDev(*player);
+    if (dev) {
+        dev->setupDefault(param);
+        dev->setId(id);
+        int err = PlayerManager::getInstance().addDev(*dev);
         if (err) {
             LOGE("create Player(%s) fail(%d)", toReadable(id), err);
-            delete player;
-            player = NULL;
+            delete dev;
+            return player;
         }
+        player = PlayerManager::getInstance().getDev(id);
     }
     return player;
 }
@@ -4171,7 +4434,7 @@ int CTv::startPlay(const char *id, const char *param)
 {
     LOGD("%s\n", __FUNCTION__);
     int ret = -1;
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = getPlayer(id, param))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4185,7 +4448,7 @@ int CTv::startPlay(const char *id, const char *param)
 int CTv::stopPlay(const char *id, const char *param)
 {
     LOGD("%s\n", __FUNCTION__);
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = PlayerManager::getInstance().getDev(id))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4197,7 +4460,7 @@ int CTv::stopPlay(const char *id, const char *param)
 
 int CTv::pausePlay(const char *id, const char *param)
 {
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = PlayerManager::getInstance().getDev(id))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4207,7 +4470,7 @@ int CTv::pausePlay(const char *id, const char *param)
 
 int CTv::resumePlay(const char *id, const char *param)
 {
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = PlayerManager::getInstance().getDev(id))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4217,7 +4480,7 @@ int CTv::resumePlay(const char *id, const char *param)
 
 int CTv::seekPlay(const char *id, const char *param)
 {
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = PlayerManager::getInstance().getDev(id))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4227,7 +4490,7 @@ int CTv::seekPlay(const char *id, const char *param)
 
 int CTv::setPlayParam(const char *id, const char *param)
 {
-    CTvPlayer *player = NULL;
+    PlayerManager::Handle player;
     if (!(player = PlayerManager::getInstance().getDev(id))) {
         LOGD("player(%s) not found", toReadable(id));
         return -1;
@@ -4331,6 +4594,10 @@ void CTv::dump(String8 &result)
     result.appendFormat("libdvb Last Build:%s\n", dvb_get_build_time_info());
     result.appendFormat("libdvb Builder Name:%s\n\n", dvb_get_build_name_info());
 #endif
+
+    CTvRecArbiter::getInstance()->dump(result);
+    RecorderManager::getInstance().dump("recorders", result);
+    PlayerManager::getInstance().dump("players", result);
 }
 
 int CTv::SetAtvAudioOutmode(int mode)
@@ -4401,14 +4668,30 @@ int CTv::TV_SetSameSourceEnable(bool enable)
 }
 
 void CTv::SetBlocked(bool block, bool tunning)
+{
+    mChannelLocked = block;
+    mUnblockRequested = false;
+    updateBlockState(!tunning && (mTvAction & TV_ACTION_PLAYING));
+}
+
+void CTv::SetRatingBlocked(bool block)
+{
+    //the vchip check keeps a program unblocked by the PIN unblocked itself
+    mRatingBlocked = block;
+    updateBlockState(mTvAction & TV_ACTION_PLAYING);
+}
+
+void CTv::updateBlockState(bool notify)
 {
     if (mSupportChannelLock) {
-        if (block) {
+        if (mRatingBlocked || (mChannelLocked && !mUnblockRequested)) {
             mBlockState = BLOCK_STATE_BLOCKED;
+        } else if (mUnblockRequested) {
+            mBlockState = BLOCK_STATE_UNBLOCKED;
         } else {
             mBlockState = BLOCK_STATE_NONE;
         }
-        if (!tunning && (mTvAction & TV_ACTION_PLAYING)) {
+        if (notify) {
             onBlockStateChanged(mBlockState);
         }
     }
@@ -4419,9 +4702,12 @@ int CTv::RequestUnblock()
     if (mSupportChannelLock
         && mEnableLockModule
         && mBlockState == BLOCK_STATE_BLOCKED) {
-        mBlockState = BLOCK_STATE_UNBLOCKED;
-        onBlockStateChanged(mBlockState);
+        mUnblockRequested = true;
+        mRatingBlocked = false;
+        updateBlockState(true);
     }
+    if (mpVchipCheck != NULL)
+        mpVchipCheck->unlockProgram(config_get_int(CFG_SECTION_TV, CFG_DTV_VCHIP_UNLOCK_TIMEOUT, 0));
     return 0;
 }
 
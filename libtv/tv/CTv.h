@@ -13,6 +13,7 @@
 #include <string.h>
 #include <sys/time.h>
 #include <utils/threads.h>
+#include <utils/KeyedVector.h>
 #include "CTvProgram.h"
 #include "CTvEpg.h"
 #include "CTvRrt.h"
@@ -28,6 +29,8 @@
 #include <CMsgQueue.h>
 #include <serial_operate.h>
 #include "CTvRecord.h"
+#include "CTvRecArbiter.h"
+#include "CTvVchipCheck.h"
 #include "CTvSubtitle.h"
 #include "CAv.h"
 #include "CTvDmx.h"
@@ -41,12 +44,14 @@
 #include <am_mem.h>
 #endif
 #include "CTvScanner.h"
+#include "CTvScanScheduler.h"
 #include "CFrontEnd.h"
 
 
 #include <CTvFactory.h>
 
 #include "CTvPlayer.h"
+#include "CTvManager.h"
 
 using namespace android;
 
@@ -176,6 +181,12 @@ typedef struct tv_config_s {
     bool memory512m;
 } tv_config_t;
 
+//a queued recording granted by the arbiter, carried in CMessage::mpPara
+typedef struct tv_rec_grant_s {
+    char id[64];
+    char param[4096];
+} tv_rec_grant_t;
+
 typedef enum TvRunStatus_s {
     TV_INIT_ED = -1,
     TV_OPEN_ED = 0,
@@ -228,6 +239,9 @@ class CTv : public CDevicesPollStatusDetect::ISourceConnectObserver,
             public CBootvideoStatusDetect::IBootvideoStatusObserver,
             public CTv2d4GHeadSetDetect::IHeadSetObserver,
             public CTvRecord::IObserver,
+            public CTvRecArbiter::IObserver,
+            public CTvVchipCheck::IObserver,
+            public CTvBookingScheduler::IObserver,
             public SysClientcallback::IScreenColorChangeObserver {
 
 public:
@@ -250,6 +264,8 @@ public:
     static const int RECORDING_CMD_STOP = 0;
     static const int RECORDING_CMD_PREPARE = 1;
     static const int RECORDING_CMD_START = 2;
+    //RECORDING_CMD_START: waits for the resources, started when they are released
+    static const int RECORDING_QUEUED = 1;
 
     static const int PLAY_CMD_STOP = 0;
     static const int PLAY_CMD_START = 1;
@@ -449,6 +465,8 @@ public:
     int SetSnowShowEnable(bool enable);
     int TV_SetSameSourceEnable(bool enable);
     void SetBlocked(bool block, bool tunning);
+    void SetRatingBlocked(bool block);
+    void updateBlockState(bool notify);
     void SendBlockEvt(bool blocked);
     int RequestUnblock();
     int getVdecStatusInfo(int vdecId, int *decode_time_cost, int *frame_width, int *frame_height, int *frame_rate,
@@ -472,7 +490,7 @@ private:
     static int startRecording(const char *id, const char *param, CTvRecord::IObserver *observer);
     static int stopRecording(const char *id, const char *param);
 
-    static CTvRecord *getRecorder(const char *id, const char *param);
+    static RecorderManager::Handle getRecorder(const char *id, const char *param);
 
     int startPlay(const char *id, const char *param);
     int stopPlay(const char *id, const char *param);
@@ -481,7 +499,7 @@ private:
     int seekPlay(const char *id, const char *param);
     int setPlayParam(const char *id, const char *param);
 
-    CTvPlayer *getPlayer(const char *id, const char *param);
+    PlayerManager::Handle getPlayer(const char *id, const char *param);
 
     int tryReleasePlayer(bool isEnter, tv_source_input_t si);
 
@@ -502,6 +520,11 @@ private:
     volatile bool mEnableLockModule;
     bool mSupportChannelLock;
     tv_block_state_e mBlockState;
+    //mBlockState is made of the channel lock set by the client and the rating
+    //block of the vchip check, a PIN unblocks both until the client locks again
+    bool mChannelLocked;
+    bool mRatingBlocked;
+    bool mUnblockRequested;
     tv_block_state_e mChannelBlockState;
     tv_block_state_e mChannelLastBlockState;
     bool mBlockStatusChanged;
@@ -512,6 +535,7 @@ protected:
     class CTvMsgQueue: public CMsgQueueThread, public CAv::IObserver, public CTvin::IObserver
         , public CTvScanner::IObserver , public CTvEpg::IObserver, public CFrontEnd::IObserver
         , public CTvRecord::IObserver, public CTvRrt::IObserver, public CTvEas::IObserver
+        , public IDevReaper
         {
     public:
         static const int TV_MSG_COMMON = 0;
@@ -531,6 +555,8 @@ protected:
         static const int TV_MSG_EAS_EVENT = 14;
         static const int TV_MSG_TVIN_RES  = 15;
         static const int TV_MSG_CHECK_SOURCE_VALID = 16;
+        static const int TV_MSG_REC_GRANTED = 17;
+        static const int TV_MSG_REAP_DEVS = 18;
 
         CTvMsgQueue(CTv *tv);
         ~CTvMsgQueue();
@@ -551,6 +577,8 @@ protected:
         //TVin(resmanager currently)
         void onEvent(const CTvin::ResourceManEvent &ev);
         void onEvent(const CTvin::CheckSourceValidEvent &ev);
+        //player and recorder managers
+        void onDevGarbage();
     private:
         virtual void handleMessage ( CMessage &msg );
         CTv *mpTv;
@@ -575,6 +603,14 @@ protected:
 
     //Record
     void onEvent(const CTvRecord::RecEvent &ev);
+    //recording resource arbiter
+    void onRecPreempt(const char *id);
+    void onRecGranted(const char *id, const char *param);
+    void onRecGrantedLocked(const char *id, const char *param);
+    //rating block decided by the vchip checker
+    void onVchipBlock(int progId, bool blocked);
+    void onBookingEvent(const CTvBookingScheduler::Booking &booking, int action);
+    int startBookedRecording(const CTvBookingScheduler::Booking &booking, const char *id);
     //rrt observer
     void onEvent (const CTvRrt::RrtEvent &ev);
     //eas observer
@@ -620,7 +656,12 @@ protected:
     mutable Mutex mLock;
     CTvTime mTvTime;
 
+    //observers of the recordings queued by the arbiter
+    KeyedVector<String8, CTvRecord::IObserver *> mQueuedRecObservers;
+    Mutex mQueuedRecLock;
+
     CTvDimension mTvVchip;
+    sp<CTvVchipCheck> mpVchipCheck;
     CTvSubtitle mTvSub;
     CAv mAv;
     CTvDmx mTvDmx;
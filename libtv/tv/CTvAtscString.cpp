@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvAtscString"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include <utils/Mutex.h>
+#include <tvconfig.h>
+#include "CTvAtscString.h"
+#include "CTvLog.h"
+
+#define ATSC_HUFFMAN_TITLE_PATH     "/vendor/etc/tvconfig/atsc_huffman_title.bin"
+#define ATSC_HUFFMAN_DESC_PATH      "/vendor/etc/tvconfig/atsc_huffman_desc.bin"
+#define HUFFMAN_ROOTS               128
+#define HUFFMAN_MAX_TABLE           (64 * 1024)
+#define HUFFMAN_END                 0x00
+#define HUFFMAN_ESCAPE              0x1B
+
+static Mutex sPoolLock;
+static std::vector<std::string> sPool;
+static std::unordered_map<std::string, int> sPoolIndex;
+
+static Mutex sHuffmanLock;
+static std::vector<uint8_t> sHuffman[3];
+static bool sHuffmanLoaded[3] = {false, false, false};
+
+CTvAtscString::CTvAtscString()
+{
+}
+
+CTvAtscString::~CTvAtscString()
+{
+}
+
+void CTvAtscString::clear()
+{
+    mStrings.clear();
+}
+
+uint32_t CTvAtscString::packLang(const char *lang)
+{
+    if (lang == NULL)
+        return 0;
+    uint32_t code = 0;
+    for (int i = 0; i < 3 && lang[i]; i++) {
+        char c = lang[i];
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        code |= (uint32_t)(uint8_t)c << (16 - 8 * i);
+    }
+    return code;
+}
+
+void CTvAtscString::getLang(int index, char lang[4]) const
+{
+    memset(lang, 0, 4);
+    if (index < 0 || index >= (int)mStrings.size())
+        return;
+    uint32_t code = mStrings[index].lang;
+    lang[0] = (code >> 16) & 0xFF;
+    lang[1] = (code >> 8) & 0xFF;
+    lang[2] = code & 0xFF;
+}
+
+int CTvAtscString::intern(const std::string &text)
+{
+    AutoMutex _l(sPoolLock);
+    std::unordered_map<std::string, int>::iterator it = sPoolIndex.find(text);
+    if (it != sPoolIndex.end())
+        return it->second;
+    //the pool never grows past its reserve, so the texts handed out stay put
+    if (sPool.capacity() < MAX_POOL)
+        sPool.reserve(MAX_POOL);
+    if (sPool.size() >= MAX_POOL || text.size() > 256)
+        return -1;
+    sPool.push_back(text);
+    sPoolIndex[text] = sPool.size() - 1;
+    return sPool.size() - 1;
+}
+
+const char *CTvAtscString::pooledText(int index)
+{
+    AutoMutex _l(sPoolLock);
+    return sPool[index].c_str();
+}
+
+const char *CTvAtscString::getText(int index) const
+{
+    if (index < 0 || index >= (int)mStrings.size())
+        return NULL;
+    const Entry &e = mStrings[index];
+    return (e.pooled >= 0) ? pooledText(e.pooled) : e.own.c_str();
+}
+
+CTvAtscString::Entry *CTvAtscString::findOrAdd(uint32_t lang)
+{
+    for (size_t i = 0; i < mStrings.size(); i++) {
+        if (mStrings[i].lang == lang)
+            return &mStrings.editItemAt(i);
+    }
+    if (mStrings.size() >= MAX_STRINGS)
+        return NULL;
+    Entry e;
+    e.lang = lang;
+    e.pooled = -1;
+    mStrings.add(e);
+    return &mStrings.editItemAt(mStrings.size() - 1);
+}
+
+static void appendUtf8(uint32_t cp, std::string &out)
+{
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+void CTvAtscString::appendMode(int mode, const uint8_t *bytes, int len, std::string &out)
+{
+    if (mode == MODE_UTF16) {
+        for (int i = 0; i + 1 < len; i += 2) {
+            uint32_t cp = (bytes[i] << 8) | bytes[i + 1];
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 3 < len) {
+                uint32_t lo = (bytes[i + 2] << 8) | bytes[i + 3];
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 2;
+                }
+            }
+            //unpaired surrogates are dropped
+            if (cp != 0 && (cp < 0xD800 || cp >= 0xE000))
+                appendUtf8(cp, out);
+        }
+    } else if (mode >= 0 && mode <= 0x33) {
+        //the mode selects the unicode page of the bytes
+        for (int i = 0; i < len; i++) {
+            if (bytes[i] != 0)
+                appendUtf8((mode << 8) | bytes[i], out);
+        }
+    } else {
+        LOGW("text mode 0x%x not supported, %d bytes dropped", mode, len);
+    }
+}
+
+int CTvAtscString::loadHuffmanTable(int compression, const char *path)
+{
+    if (compression != COMPRESSION_HUFFMAN_TITLE && compression != COMPRESSION_HUFFMAN_DESC)
+        return -1;
+
+    AutoMutex _l(sHuffmanLock);
+    sHuffmanLoaded[compression] = true;
+    sHuffman[compression].clear();
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        LOGW("no huffman table %s", path);
+        return -1;
+    }
+    uint8_t buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0
+            && sHuffman[compression].size() + n <= HUFFMAN_MAX_TABLE) {
+        sHuffman[compression].insert(sHuffman[compression].end(), buf, buf + n);
+    }
+    fclose(fp);
+
+    if (sHuffman[compression].size() < HUFFMAN_ROOTS * 2) {
+        LOGE("huffman table %s too short", path);
+        sHuffman[compression].clear();
+        return -1;
+    }
+    LOGD("huffman table %d: %s, %d bytes", compression, path, (int)sHuffman[compression].size());
+    return 0;
+}
+
+//Annex C decode trees: 128 big endian byte offsets of the tree used after each
+//prior character, then the trees as byte pairs for a 0 and a 1 bit. A byte with
+//the top bit set is a leaf holding the character, otherwise it is the index of
+//the next pair in the tree. ESC is followed by one uncompressed 8 bit character.
+int CTvAtscString::huffmanDecode(int compression, const uint8_t *bytes, int len, std::string &out)
+{
+    bool loaded;
+    {
+        AutoMutex _l(sHuffmanLock);
+        loaded = sHuffmanLoaded[compression];
+    }
+    if (!loaded) {
+        if (compression == COMPRESSION_HUFFMAN_TITLE) {
+            loadHuffmanTable(compression, config_get_str(CFG_SECTION_TV, CFG_DTV_ATSC_HUFFMAN_TITLE,
+                             ATSC_HUFFMAN_TITLE_PATH));
+        } else {
+            loadHuffmanTable(compression, config_get_str(CFG_SECTION_TV, CFG_DTV_ATSC_HUFFMAN_DESC,
+                             ATSC_HUFFMAN_DESC_PATH));
+        }
+    }
+
+    AutoMutex _l(sHuffmanLock);
+    const std::vector<uint8_t> &tab = sHuffman[compression];
+    if (tab.empty())
+        return -1;
+
+    int bits = len * 8;
+    int bit = 0;
+    int prior = 0;
+    while (bit < bits) {
+        int root = (tab[prior * 2] << 8) | tab[prior * 2 + 1];
+        int node = 0;
+        int c = -1;
+        while (bit < bits) {
+            int b = (bytes[bit >> 3] >> (7 - (bit & 7))) & 1;
+            bit++;
+            size_t pos = root + node * 2 + b;
+            if (pos >= tab.size())
+                return -1;
+            if (tab[pos] & 0x80) {
+                c = tab[pos] & 0x7F;
+                break;
+            }
+            node = tab[pos];
+        }
+        if (c < 0 || c == HUFFMAN_END)
+            break;
+        if (c == HUFFMAN_ESCAPE) {
+            if (bit + 8 > bits)
+                return -1;
+            c = 0;
+            for (int i = 0; i < 8; i++, bit++)
+                c = (c << 1) | ((bytes[bit >> 3] >> (7 - (bit & 7))) & 1);
+        }
+        out += (char)c;
+        prior = c & 0x7F;
+    }
+    return 0;
+}
+
+int CTvAtscString::addSegment(const char *lang, int compression, int mode, const uint8_t *bytes, int len)
+{
+    if (len < 0 || (len > 0 && bytes == NULL))
+        return -1;
+
+    std::string text;
+    if (compression == COMPRESSION_NONE) {
+        appendMode(mode, bytes, len, text);
+    } else if (compression == COMPRESSION_HUFFMAN_TITLE || compression == COMPRESSION_HUFFMAN_DESC) {
+        std::string decoded;
+        if (huffmanDecode(compression, bytes, len, decoded) != 0) {
+            LOGW("%d bytes of huffman %d text not decoded", len, compression);
+            return -1;
+        }
+        //compressed segments carry mode 0xff, the decoded characters are of page 0
+        appendMode(0, (const uint8_t *)decoded.data(), decoded.size(), text);
+    } else {
+        LOGW("compression type 0x%x not supported", compression);
+        return -1;
+    }
+
+    return appendText(lang, text);
+}
+
+int CTvAtscString::addString(const char *lang, const char *text)
+{
+    if (text == NULL)
+        return -1;
+    return appendText(lang, text);
+}
+
+int CTvAtscString::appendText(const char *lang, const std::string &text)
+{
+    Entry *e = findOrAdd(packLang(lang));
+    if (e == NULL)
+        return -1;
+    if (e->pooled >= 0) {
+        e->own = pooledText(e->pooled);
+        e->pooled = -1;
+    }
+    e->own += text;
+    e->pooled = intern(e->own);
+    if (e->pooled >= 0)
+        e->own.clear();
+    return 0;
+}
+
+int CTvAtscString::parse(const uint8_t *data, int len)
+{
+    clear();
+    if (data == NULL || len < 1)
+        return -1;
+
+    int pos = 0;
+    int strings = data[pos++];
+    for (int i = 0; i < strings; i++) {
+        if (pos + 4 > len)
+            return -1;
+        char lang[4] = {(char)data[pos], (char)data[pos + 1], (char)data[pos + 2], 0};
+        int segments = data[pos + 3];
+        pos += 4;
+        for (int j = 0; j < segments; j++) {
+            if (pos + 3 > len)
+                return -1;
+            int compression = data[pos];
+            int mode = data[pos + 1];
+            int bytes = data[pos + 2];
+            pos += 3;
+            if (pos + bytes > len)
+                return -1;
+            addSegment(lang, compression, mode, data + pos, bytes);
+            pos += bytes;
+        }
+    }
+    return 0;
+}
+
+const char *CTvAtscString::getTextLangs()
+{
+    return config_get_str(CFG_SECTION_TV, CFG_DTV_TEXT_LANGS, "eng");
+}
+
+const char *CTvAtscString::find(const char *langs) const
+{
+    if (mStrings.isEmpty())
+        return NULL;
+
+    const char *p = langs;
+    while (p != NULL && *p) {
+        while (*p == ',' || *p == ' ')
+            p++;
+        if (strlen(p) < 3)
+            break;
+        uint32_t code = packLang(p);
+        for (size_t i = 0; i < mStrings.size(); i++) {
+            if (mStrings[i].lang == code)
+                return getText(i);
+        }
+        p += 3;
+    }
+    return getText(0);
+}
+
+int CTvAtscString::copyTo(const char *langs, char *buf, int size) const
+{
+    if (buf == NULL || size <= 0)
+        return -1;
+    const char *text = find(langs);
+    if (text == NULL) {
+        buf[0] = 0;
+        return 0;
+    }
+    int n = strlen(text);
+    if (n > size - 1) {
+        //do not cut an utf-8 sequence
+        n = size - 1;
+        while (n > 0 && (text[n] & 0xC0) == 0x80)
+            n--;
+    }
+    memcpy(buf, text, n);
+    buf[n] = 0;
+    return n;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVATSCSTRING_H_)
+#define _CTVATSCSTRING_H_
+
+#include <stdint.h>
+#include <string>
+#include <utils/Vector.h>
+
+using namespace android;
+
+//decoded ATSC multiple_string_structure (A/65 6.10): one UTF-8 string per
+//language, the segments of a language are joined. Texts are interned, so the
+//same rating or alert names received again and again share one copy.
+class CTvAtscString {
+public:
+    enum {
+        COMPRESSION_NONE = 0,
+        //A/65 Annex C tables C.4/C.5
+        COMPRESSION_HUFFMAN_TITLE = 1,
+        //A/65 Annex C tables C.6/C.7
+        COMPRESSION_HUFFMAN_DESC = 2,
+    };
+
+    static const int MODE_UTF16 = 0x3F;
+    static const int MAX_STRINGS = 16;
+    static const int MAX_POOL = 1024;
+
+    CTvAtscString();
+    ~CTvAtscString();
+
+    void clear();
+    //raw multiple_string_structure(), -1 if a length runs past the end
+    int parse(const uint8_t *data, int len);
+    //one segment, appended to the string of its language
+    int addSegment(const char *lang, int compression, int mode, const uint8_t *bytes, int len);
+    //an already decoded string
+    int addString(const char *lang, const char *text);
+
+    int getCount() const
+    {
+        return mStrings.size();
+    }
+    //3 letters ISO 639 code, terminated
+    void getLang(int index, char lang[4]) const;
+    const char *getText(int index) const;
+    //text of the first language found in langs ("eng,fre"), else the first one
+    const char *find(const char *langs) const;
+    //find() copied to a fixed buffer, always terminated, return the length
+    int copyTo(const char *langs, char *buf, int size) const;
+
+    //decode tree of a compression type, in the Annex C layout
+    static int loadHuffmanTable(int compression, const char *path);
+    //text languages wanted by the user, from dtv.text.langs
+    static const char *getTextLangs();
+
+private:
+    struct Entry {
+        uint32_t lang;
+        //-1 when the text is too large for the pool or it is full
+        int pooled;
+        std::string own;
+    };
+
+    static uint32_t packLang(const char *lang);
+    static int intern(const std::string &text);
+    static const char *pooledText(int index);
+    static int huffmanDecode(int compression, const uint8_t *bytes, int len, std::string &out);
+    static void appendMode(int mode, const uint8_t *bytes, int len, std::string &out);
+    Entry *findOrAdd(uint32_t lang);
+    int appendText(const char *lang, const std::string &text);
+
+    Vector<Entry> mStrings;
+};
+
+#endif //_CTVATSCSTRING_H_
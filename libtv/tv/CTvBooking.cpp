@@ -10,6 +10,7 @@
 #define LOG_TAG "tvserver"
 #define LOG_TV_TAG "CTvBooking"
 
+#include <string.h>
 #include "CTvBooking.h"
 #include "CTvDatabase.h"
 
@@ -70,89 +71,73 @@ int CTvBooking::selectByID(int id, CTvBooking &CtvBook)
 
 int CTvBooking::getBookedEventList(Vector<sp<CTvBooking> > &vBv)
 {
-    String8 cmd;
-
-    cmd = String8("select * from booking_table  order by start");
-
-    CTvDatabase::Cursor c;
-    CTvDatabase::GetTvDb()->select(cmd, c);
-
-    if (c.moveToFirst()) {
-        do {
-            vBv.add(new CTvBooking(c));
-        } while (c.moveToNext());
-
-
-    } else {
-        c.close();
+    //served by the scheduler, booking_table is only read when it loads
+    Vector<CTvBookingScheduler::Booking> bookings;
+    CTvBookingScheduler::getInstance()->getBookings(bookings);
+    if (bookings.size() == 0) {
         return -1;
     }
 
-    c.close();
-    return 0;
-
-}
-
-int CTvBooking::bookProgram(CTvProgram &prog, CTvEvent &evt)
-{
-    String8 cmd;
-    String8 progName = String8(prog.getName());
-    String8 evtName = String8(evt.getName());
-
-    if (!prog.getAudio(0)) {
-        return -1;
+    for (size_t i = 0; i < bookings.size(); i++) {
+        vBv.add(new CTvBooking(bookings[i]));
     }
-    /*book this program*/
-    cmd = String8("insert into booking_table(db_srv_id, db_evt_id, srv_name, evt_name,")
-          + String8("start,duration,flag,status,file_name,vid_pid,vid_fmt,aud_pids,aud_fmts,aud_languages,")
-          + String8("sub_pids,sub_types,sub_composition_page_ids,sub_ancillary_page_ids,sub_languages,")
-          + String8("ttx_pids,ttx_types,ttx_magazine_numbers,ttx_page_numbers,ttx_languages, other_pids,from_storage,repeat)")
-          + String8("values(") + String8::format("%d,", prog.getID()) + String8::format("%d,", evt.getEventId()) + progName.string() + String8(",") + evtName.string()
-          + String8::format("%ld,", evt.getStartTime()) + String8::format("%ld,", evt.getEndTime() - evt.getStartTime()) + String8::format("%d,", flag)
-          + String8::format("%d,", status) + String8(",") + String8::format("%d,", prog.getVideo()->getPID()) + String8::format("%d,", prog.getVideo()->getFormat())
-          + String8::format("%d,", prog.getAudio(0)->getPID()) + String8::format("%d,", prog.getAudio(0)->getFormat()) + prog.getAudio(0)->getLang().string()
-          + String8(" , , , , , , , , , , , , ,)");
-
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
-
-    return 0;
-}
-
-int CTvBooking::deleteBook(int evtIdFlag)
-{
-    String8 cmd;
-
-    cmd = String8("delete from booking_table where db_evt_id=")
-          + String8::format("%d", evtIdFlag);
-
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
-
     return 0;
 }
 
-int CTvBooking::bookEvent(int evtId, bool bBookFlag)
+int CTvBooking::bookEvent(int evtId, bool bBookFlag, int bookFlag)
 {
     String8 cmd;
-
-    cmd = String8("update evt_table set sub_flag=") + String8::format("%d", bBookFlag)
-          + String8(" where db_id=") + String8::format("%d", evtId);
-
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    int ret;
 
     if (true == bBookFlag) {
         CTvEvent evt;
-        CTvEvent::selectByID(evtId, evt);
+        if (CTvEvent::selectByID(evtId, evt) != 0) {
+            return -1;
+        }
 
         CTvProgram prog;
         CTvProgram::selectByID(evt.getProgramId(), prog);
 
-        bookProgram(prog, evt);
+        CTvBookingScheduler::Booking booking;
+        memset(&booking, 0, sizeof(booking));
+        booking.programId = evt.getProgramId();
+        booking.eventId = evtId;
+        booking.flag = bookFlag;
+        booking.start = evt.getStartTime();
+        booking.duration = evt.getEndTime() - evt.getStartTime();
+        snprintf(booking.progName, sizeof(booking.progName), "%s", prog.getName().string());
+        snprintf(booking.evtName, sizeof(booking.evtName), "%s", evt.getName().string());
+        ret = CTvBookingScheduler::getInstance()->addBooking(booking, NULL);
     } else {
-        deleteBook(evtId);
+        ret = CTvBookingScheduler::getInstance()->removeBooking(evtId);
     }
 
-    return 0;
+    if (ret == CTvBookingScheduler::BOOKING_OK) {
+        cmd = String8("update evt_table set sub_flag=") + String8::format("%d", bBookFlag)
+              + String8(" where db_id=") + String8::format("%d", evtId);
+        CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    }
+    return ret;
+}
 
+int CTvBooking::clearEventFlag(int evtId)
+{
+    String8 cmd = String8("update evt_table set sub_flag=0 where db_id=") + String8::format("%d", evtId);
+    return CTvDatabase::GetTvDb()->exeSql(cmd.string()) ? 0 : -1;
+}
+
+CTvBooking::CTvBooking(const CTvBookingScheduler::Booking &b)
+{
+    id = b.id;
+    programId = b.programId;
+    eventId = b.eventId;
+    flag = b.flag;
+    status = b.status;
+    repeat = b.repeat;
+    start = b.start;
+    duration = b.duration;
+    progName = String8(b.progName);
+    evtName = String8(b.evtName);
 }
 
 CTvBooking::CTvBooking(CTvDatabase::Cursor &c)
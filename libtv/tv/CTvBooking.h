@@ -13,6 +13,7 @@
 #include "CTvDatabase.h"
 #include "CTvProgram.h"
 #include "CTvEvent.h"
+#include "CTvBookingScheduler.h"
 #include <utils/String8.h>
 #include <utils/RefBase.h>
 #include <stdlib.h>
@@ -21,13 +22,17 @@
 class CTvBooking : public LightRefBase<CTvBooking> {
 public:
     CTvBooking(CTvDatabase::Cursor &c);
+    CTvBooking(const CTvBookingScheduler::Booking &b);
     CTvBooking();
     ~CTvBooking();
 
     static int selectByID(int id, CTvBooking &CtvBook);
 
-    int bookEvent(int evtId, bool bBookFlag);
+    //bookFlag: CTvBookingScheduler::FLAG_*, returns CTvBookingScheduler::BOOKING_*
+    int bookEvent(int evtId, bool bBookFlag, int bookFlag = CTvBookingScheduler::FLAG_REMIND);
     int getBookedEventList(Vector<sp<CTvBooking> > &vBv);
+    //the booking of the event is gone, it fired or was removed
+    static int clearEventFlag(int evtId);
 
     int getBookId()
     {
@@ -59,8 +64,6 @@ public:
     };
 
 private:
-    int deleteBook(int evtIdFlag) ;
-    int bookProgram(CTvProgram &prog, CTvEvent &evt);
     int InitFromCursor(CTvDatabase::Cursor &c);
 private:
     int id;
@@ -0,0 +1,542 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvBookingScheduler"
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "CTvBookingScheduler.h"
+#include "CTvRecArbiter.h"
+#include "CTvDatabase.h"
+#include <tvconfig.h>
+#include "CTvLog.h"
+
+#define BOOKING_JOURNAL_MAGIC       0x424b4a31
+
+sp<CTvBookingScheduler> CTvBookingScheduler::mInstance;
+
+static String8 sqlQuote(const char *str)
+{
+    String8 out("'");
+    for (const char *p = str; *p; p++) {
+        if (*p == '\'') {
+            out.append("'");
+        }
+        out.append(p, (size_t)1);
+    }
+    out.append("'");
+    return out;
+}
+
+CTvBookingScheduler *CTvBookingScheduler::getInstance()
+{
+    if (mInstance == NULL) {
+        mInstance = new CTvBookingScheduler();
+    }
+    return mInstance.get();
+}
+
+void CTvBookingScheduler::invalidate()
+{
+    if (mInstance != NULL) {
+        {
+            AutoMutex _l(mInstance->mLock);
+            mInstance->mLoaded = false;
+        }
+        mInstance->wake();
+    }
+}
+
+CTvBookingScheduler::CTvBookingScheduler()
+{
+    mpObserver = NULL;
+    mpTime = NULL;
+    mLoaded = false;
+    mGen = 0;
+    mTimerFd = timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC);
+    mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    mJournalFd = -1;
+    mPreroll = config_get_int(CFG_SECTION_TV, CFG_DTV_BOOKING_PREROLL, 30);
+    mPostroll = config_get_int(CFG_SECTION_TV, CFG_DTV_BOOKING_POSTROLL, 60);
+    //the same counts the recording arbiter hands out
+    mRecordCount = std::min(config_get_int(CFG_SECTION_TV, CFG_DTV_RES_TUNER_COUNT, 1),
+                            config_get_int(CFG_SECTION_TV, CFG_DTV_RES_DVR_COUNT, 2));
+    if (mTimerFd < 0 || mWakeFd < 0) {
+        LOGE("%s, timer fds failed(%s)", __FUNCTION__, strerror(errno));
+    }
+}
+
+CTvBookingScheduler::~CTvBookingScheduler()
+{
+    if (mTimerFd >= 0) {
+        close(mTimerFd);
+    }
+    if (mWakeFd >= 0) {
+        close(mWakeFd);
+    }
+    if (mJournalFd >= 0) {
+        close(mJournalFd);
+    }
+}
+
+int CTvBookingScheduler::startScheduler()
+{
+    {
+        AutoMutex _l(mLock);
+        loadLocked();
+    }
+    return run("CTvBookingScheduler");
+}
+
+void CTvBookingScheduler::stopScheduler()
+{
+    requestExit();
+    wake();
+    join();
+}
+
+void CTvBookingScheduler::wake()
+{
+    uint64_t one = 1;
+    if (mWakeFd >= 0) {
+        write(mWakeFd, &one, sizeof(one));
+    }
+}
+
+long CTvBookingScheduler::nowLocked()
+{
+    return (mpTime != NULL) ? mpTime->getTime() : (long)time(NULL);
+}
+
+uint32_t CTvBookingScheduler::recordSum(const JournalRecord &rec)
+{
+    const unsigned char *p = (const unsigned char *)&rec;
+    uint32_t sum = 2166136261u;
+    for (size_t i = 0; i < offsetof(JournalRecord, sum); i++) {
+        sum = (sum ^ p[i]) * 16777619u;
+    }
+    return sum;
+}
+
+int CTvBookingScheduler::loadLocked()
+{
+    if (mLoaded) {
+        return 0;
+    }
+
+    mBookings.clear();
+    mHeap.clear();
+    CTvDatabase::Cursor c;
+    CTvDatabase::GetTvDb()->select("select * from booking_table order by start", c);
+    if (c.moveToFirst()) {
+        int colId = c.getColumnIndex("db_id");
+        int colProg = c.getColumnIndex("db_srv_id");
+        int colEvt = c.getColumnIndex("db_evt_id");
+        int colFlag = c.getColumnIndex("flag");
+        int colStatus = c.getColumnIndex("status");
+        int colRepeat = c.getColumnIndex("repeat");
+        int colStart = c.getColumnIndex("start");
+        int colDuration = c.getColumnIndex("duration");
+        int colProgName = c.getColumnIndex("srv_name");
+        int colEvtName = c.getColumnIndex("evt_name");
+        do {
+            Booking b;
+            memset(&b, 0, sizeof(b));
+            b.id = c.getInt(colId);
+            b.programId = c.getInt(colProg);
+            b.eventId = c.getInt(colEvt);
+            b.flag = c.getInt(colFlag);
+            b.status = c.getInt(colStatus);
+            b.repeat = c.getInt(colRepeat);
+            b.start = (long)c.getInt(colStart);
+            b.duration = (long)c.getInt(colDuration);
+            snprintf(b.progName, sizeof(b.progName), "%s", c.getString(colProgName).string());
+            snprintf(b.evtName, sizeof(b.evtName), "%s", c.getString(colEvtName).string());
+            mBookings.add(b);
+        } while (c.moveToNext());
+    }
+    c.close();
+
+    //redo the changes which may not have reached booking_table
+    if (mJournalFd < 0) {
+        const char *path = config_get_str(CFG_SECTION_TV, CFG_DTV_BOOKING_JOURNAL, BOOKING_JOURNAL_DEFAULT_PATH);
+        mJournalFd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (mJournalFd < 0) {
+            LOGE("%s, open %s failed(%s)", __FUNCTION__, path, strerror(errno));
+        }
+    }
+    if (mJournalFd >= 0) {
+        JournalRecord rec;
+        int replayed = 0;
+        off_t pos = 0;
+        while (pread(mJournalFd, &rec, sizeof(rec), pos) == (ssize_t)sizeof(rec)) {
+            if (rec.magic != BOOKING_JOURNAL_MAGIC || rec.sum != recordSum(rec)) {
+                //torn tail, the change never returned to the caller
+                break;
+            }
+            applyLocked(rec.op, rec.booking);
+            pos += sizeof(rec);
+            replayed++;
+        }
+        if (replayed > 0 || pos > 0) {
+            LOGD("%s, replayed %d journal records", __FUNCTION__, replayed);
+        }
+        checkpointLocked();
+    }
+
+    for (size_t i = 0; i < mBookings.size(); i++) {
+        Booking &b = mBookings.editItemAt(i);
+        //the recorder did not survive the restart, start it again if not too late
+        if (b.status == STATUS_STARTED) {
+            b.status = STATUS_WAITING;
+        }
+        scheduleLocked(b);
+    }
+    mLoaded = true;
+    LOGD("%s, %d bookings", __FUNCTION__, (int)mBookings.size());
+    return 0;
+}
+
+int CTvBookingScheduler::findLocked(int eventId)
+{
+    for (size_t i = 0; i < mBookings.size(); i++) {
+        if (mBookings[i].eventId == eventId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int CTvBookingScheduler::peakRecordings(const Vector<Booking> &bookings, const Booking &booking,
+                                        int preroll, int postroll, Vector<int> *overlaps)
+{
+    long begin = booking.start - preroll;
+    long end = booking.start + booking.duration + postroll;
+    Vector<const Booking *> found;
+    for (size_t i = 0; i < bookings.size(); i++) {
+        const Booking &b = bookings[i];
+        if (b.eventId == booking.eventId || !(b.flag & FLAG_RECORD)) {
+            continue;
+        }
+        if (b.start - preroll < end && b.start + b.duration + postroll > begin) {
+            found.add(&b);
+            if (overlaps != NULL) {
+                overlaps->add(b.eventId);
+            }
+        }
+    }
+
+    //the most recordings at once is reached at the start of one of them
+    int busy = 0;
+    for (size_t i = 0; i <= found.size(); i++) {
+        long at = (i < found.size()) ? std::max(begin, found[i]->start - preroll) : begin;
+        int count = 0;
+        for (size_t j = 0; j < found.size(); j++) {
+            if (found[j]->start - preroll <= at && found[j]->start + found[j]->duration + postroll > at) {
+                count++;
+            }
+        }
+        busy = std::max(busy, count);
+    }
+    return busy;
+}
+
+int CTvBookingScheduler::conflictsLocked(const Booking &booking, Vector<int> *conflicts)
+{
+    if (!(booking.flag & FLAG_RECORD)) {
+        return BOOKING_OK;
+    }
+
+    Vector<int> overlaps;
+    int busy = peakRecordings(mBookings, booking, mPreroll, mPostroll, &overlaps);
+    if (busy + 1 <= mRecordCount) {
+        return BOOKING_OK;
+    }
+    if (conflicts != NULL) {
+        conflicts->appendVector(overlaps);
+    }
+    return BOOKING_CONFLICT;
+}
+
+int CTvBookingScheduler::journalLocked(int op, const Booking &booking)
+{
+    if (mJournalFd < 0) {
+        return -1;
+    }
+
+    JournalRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = BOOKING_JOURNAL_MAGIC;
+    rec.op = op;
+    rec.booking = booking;
+    rec.booking.gen = 0;
+    rec.sum = recordSum(rec);
+    if (write(mJournalFd, &rec, sizeof(rec)) != (ssize_t)sizeof(rec) || fsync(mJournalFd) != 0) {
+        LOGE("%s, write journal failed(%s)", __FUNCTION__, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void CTvBookingScheduler::checkpointLocked()
+{
+    if (mJournalFd >= 0) {
+        ftruncate(mJournalFd, 0);
+        fsync(mJournalFd);
+    }
+}
+
+//memory and booking_table, both safe to repeat
+void CTvBookingScheduler::applyLocked(int op, const Booking &booking)
+{
+    int index = findLocked(booking.eventId);
+    String8 cmd;
+    switch (op) {
+    case OP_ADD: {
+        Booking b = booking;
+        if (index >= 0) {
+            b.gen = mBookings[index].gen;
+            mBookings.editItemAt(index) = b;
+        } else {
+            mBookings.add(b);
+        }
+        CTvDatabase::GetTvDb()->beginTransaction();
+        CTvDatabase::GetTvDb()->exeSql(String8::format("delete from booking_table where db_evt_id=%d",
+                                                       booking.eventId).string());
+        cmd = String8("insert into booking_table(db_srv_id,db_evt_id,srv_name,evt_name,start,duration,flag,status,repeat) values(");
+        cmd += String8::format("%d,%d,", booking.programId, booking.eventId);
+        cmd += sqlQuote(booking.progName);
+        cmd += ",";
+        cmd += sqlQuote(booking.evtName);
+        cmd += String8::format(",%ld,%ld,%d,%d,%d)", booking.start, booking.duration, booking.flag,
+                               booking.status, booking.repeat);
+        CTvDatabase::GetTvDb()->exeSql(cmd.string());
+        CTvDatabase::GetTvDb()->commitTransaction();
+        break;
+    }
+    case OP_REMOVE:
+        if (index >= 0) {
+            mBookings.removeAt(index);
+        }
+        CTvDatabase::GetTvDb()->exeSql(String8::format("delete from booking_table where db_evt_id=%d",
+                                                       booking.eventId).string());
+        break;
+    case OP_STATUS:
+        if (index >= 0) {
+            mBookings.editItemAt(index).status = booking.status;
+        }
+        CTvDatabase::GetTvDb()->exeSql(String8::format("update booking_table set status=%d where db_evt_id=%d",
+                                                       booking.status, booking.eventId).string());
+        break;
+    default:
+        break;
+    }
+}
+
+int CTvBookingScheduler::changeLocked(int op, const Booking &booking)
+{
+    if (journalLocked(op, booking) != 0) {
+        return BOOKING_ERROR;
+    }
+    applyLocked(op, booking);
+    checkpointLocked();
+    return BOOKING_OK;
+}
+
+void CTvBookingScheduler::scheduleLocked(Booking &booking)
+{
+    Deadline d;
+    booking.gen = ++mGen;
+    d.eventId = booking.eventId;
+    d.gen = booking.gen;
+    if (booking.status == STATUS_STARTED) {
+        d.when = booking.start + booking.duration + mPostroll;
+        d.action = ACTION_RECORD_STOP;
+    } else {
+        d.when = booking.start - mPreroll;
+        d.action = (booking.flag & FLAG_RECORD) ? ACTION_RECORD_START : ACTION_REMIND;
+    }
+    mHeap.push_back(d);
+    std::push_heap(mHeap.begin(), mHeap.end(), deadlineLater);
+}
+
+void CTvBookingScheduler::fireDueLocked(long now, Vector<Fired> &fired)
+{
+    while (!mHeap.empty() && mHeap.front().when <= now) {
+        Deadline d = mHeap.front();
+        std::pop_heap(mHeap.begin(), mHeap.end(), deadlineLater);
+        mHeap.pop_back();
+
+        int index = findLocked(d.eventId);
+        if (index < 0 || mBookings[index].gen != d.gen) {
+            continue;
+        }
+
+        Fired f;
+        f.booking = mBookings[index];
+        f.action = d.action;
+        long end = f.booking.start + f.booking.duration;
+        if (d.action == ACTION_RECORD_START && now < end + mPostroll) {
+            Booking &b = mBookings.editItemAt(index);
+            b.status = STATUS_STARTED;
+            changeLocked(OP_STATUS, b);
+            scheduleLocked(b);
+            f.booking = b;
+        } else {
+            //late after a clock jump or a restart: a started recording still
+            //gets its stop, what never started is missed
+            if ((d.action == ACTION_REMIND && now >= end)
+                    || (d.action == ACTION_RECORD_START && now >= end + mPostroll)) {
+                f.action = ACTION_MISSED;
+            }
+            changeLocked(OP_REMOVE, f.booking);
+        }
+        fired.add(f);
+    }
+}
+
+void CTvBookingScheduler::armLocked(long now)
+{
+    //drop stale deadlines so the timer is not armed for nothing
+    while (!mHeap.empty()) {
+        int index = findLocked(mHeap.front().eventId);
+        if (index >= 0 && mBookings[index].gen == mHeap.front().gen) {
+            break;
+        }
+        std::pop_heap(mHeap.begin(), mHeap.end(), deadlineLater);
+        mHeap.pop_back();
+    }
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (!mHeap.empty()) {
+        long delay = mHeap.front().when - now;
+        if (delay > 0) {
+            its.it_value.tv_sec = delay;
+        } else {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+    if (mTimerFd >= 0) {
+        timerfd_settime(mTimerFd, 0, &its, NULL);
+    }
+}
+
+bool CTvBookingScheduler::threadLoop()
+{
+    Vector<Fired> fired;
+    {
+        AutoMutex _l(mLock);
+        loadLocked();
+        long now = nowLocked();
+        fireDueLocked(now, fired);
+        armLocked(now);
+    }
+
+    for (size_t i = 0; i < fired.size(); i++) {
+        LOGD("%s, event %d action %d", __FUNCTION__, fired[i].booking.eventId, fired[i].action);
+        if (mpObserver != NULL) {
+            mpObserver->onBookingEvent(fired[i].booking, fired[i].action);
+        }
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = mTimerFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = mWakeFd;
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, -1) > 0) {
+        uint64_t count;
+        if (fds[0].revents & POLLIN) {
+            read(mTimerFd, &count, sizeof(count));
+        }
+        if (fds[1].revents & POLLIN) {
+            read(mWakeFd, &count, sizeof(count));
+        }
+    }
+    return !exitPending();
+}
+
+int CTvBookingScheduler::addBooking(const Booking &booking, Vector<int> *conflicts)
+{
+    int ret;
+    {
+        AutoMutex _l(mLock);
+        loadLocked();
+        ret = conflictsLocked(booking, conflicts);
+        if (ret != BOOKING_OK) {
+            LOGD("%s, event %d conflicts with %d recordings", __FUNCTION__, booking.eventId,
+                 conflicts ? (int)conflicts->size() : 0);
+            return ret;
+        }
+
+        Booking b = booking;
+        b.status = STATUS_WAITING;
+        ret = changeLocked(OP_ADD, b);
+        if (ret != BOOKING_OK) {
+            return ret;
+        }
+
+        int index = findLocked(b.eventId);
+        CTvDatabase::Cursor c;
+        CTvDatabase::GetTvDb()->select(String8::format("select db_id from booking_table where db_evt_id=%d",
+                                                       b.eventId).string(), c);
+        if (c.moveToFirst()) {
+            mBookings.editItemAt(index).id = c.getInt(0);
+        }
+        c.close();
+        scheduleLocked(mBookings.editItemAt(index));
+    }
+    wake();
+    return BOOKING_OK;
+}
+
+int CTvBookingScheduler::removeBooking(int eventId)
+{
+    int ret;
+    {
+        AutoMutex _l(mLock);
+        loadLocked();
+        int index = findLocked(eventId);
+        if (index < 0) {
+            return BOOKING_ERROR;
+        }
+        Booking b = mBookings[index];
+        ret = changeLocked(OP_REMOVE, b);
+    }
+    wake();
+    return ret;
+}
+
+int CTvBookingScheduler::getBookings(Vector<Booking> &bookings)
+{
+    AutoMutex _l(mLock);
+    loadLocked();
+    for (size_t i = 0; i < mBookings.size(); i++) {
+        size_t pos = bookings.size();
+        while (pos > 0 && bookings[pos - 1].start > mBookings[i].start) {
+            pos--;
+        }
+        bookings.insertAt(mBookings[i], pos);
+    }
+    return bookings.size();
+}
+
+void CTvBookingScheduler::onTimeChanged()
+{
+    wake();
+}
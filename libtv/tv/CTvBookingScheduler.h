@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVBOOKINGSCHEDULER_H)
+#define _CTVBOOKINGSCHEDULER_H
+
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+#include <vector>
+#include "CTvTime.h"
+
+using namespace android;
+
+#define CFG_DTV_BOOKING_PREROLL                 "dtv.booking.preroll"
+#define CFG_DTV_BOOKING_POSTROLL                "dtv.booking.postroll"
+#define CFG_DTV_BOOKING_JOURNAL                 "dtv.booking.journal"
+#define BOOKING_JOURNAL_DEFAULT_PATH            "/data/vendor/tvserver/booking.journal"
+#define CFG_DTV_BOOKING_REC_PATH                "dtv.booking.rec.path"
+#define BOOKING_REC_DEFAULT_PATH                "/storage"
+
+//bookings of booking_table kept in memory, with their next deadlines in a
+//min-heap and one timerfd armed for the earliest. Every change is written
+//to a journal before booking_table, the journal is replayed on load and
+//emptied once the table has the change.
+class CTvBookingScheduler: public Thread {
+public:
+    static const int NAME_LEN = 64;
+
+    enum {
+        FLAG_REMIND = 0x1,
+        FLAG_RECORD = 0x2,
+    };
+
+    enum {
+        STATUS_WAITING = 0,
+        STATUS_STARTED = 1,
+    };
+
+    enum {
+        ACTION_REMIND,
+        ACTION_RECORD_START,
+        ACTION_RECORD_STOP,
+        //the time passed before the booking could start, e.g. tv was off
+        ACTION_MISSED,
+    };
+
+    enum {
+        BOOKING_OK = 0,
+        BOOKING_ERROR = -1,
+        //overlaps more recordings than there are tuners or dvr channels
+        BOOKING_CONFLICT = -2,
+    };
+
+    struct Booking {
+        int id;
+        int programId;
+        int eventId;
+        int flag;
+        int status;
+        int repeat;
+        long start;
+        long duration;
+        char progName[NAME_LEN];
+        char evtName[NAME_LEN];
+        //runtime only, deadlines of older generations are stale
+        int gen;
+    };
+
+    class IObserver {
+    public:
+        IObserver() {};
+        virtual ~IObserver() {};
+        //called from the scheduler thread, unlocked
+        virtual void onBookingEvent(const Booking &booking, int action) = 0;
+    };
+
+    CTvBookingScheduler();
+    ~CTvBookingScheduler();
+    static CTvBookingScheduler *getInstance();
+    //booking_table changed behind the scheduler
+    static void invalidate();
+
+    void setObserver(IObserver *ob)
+    {
+        mpObserver = ob;
+    }
+    void setTime(CTvTime *time)
+    {
+        mpTime = time;
+    }
+    int startScheduler();
+    void stopScheduler();
+
+    //keyed by eventId, an existing booking of the event is replaced.
+    //conflicts: the recordings it overlaps when BOOKING_CONFLICT
+    int addBooking(const Booking &booking, Vector<int> *conflicts);
+    int removeBooking(int eventId);
+    //sorted by start
+    int getBookings(Vector<Booking> &bookings);
+    //most recordings of bookings running at once while booking records, rolls
+    //included. overlaps: event ids of those which record at the same time
+    static int peakRecordings(const Vector<Booking> &bookings, const Booking &booking,
+                              int preroll, int postroll, Vector<int> *overlaps);
+    //stream time stepped
+    void onTimeChanged();
+
+private:
+    enum {
+        OP_ADD = 1,
+        OP_REMOVE = 2,
+        OP_STATUS = 3,
+    };
+
+    struct Deadline {
+        long when;
+        int eventId;
+        int action;
+        int gen;
+    };
+
+    struct JournalRecord {
+        uint32_t magic;
+        int op;
+        Booking booking;
+        uint32_t sum;
+    };
+
+    struct Fired {
+        Booking booking;
+        int action;
+    };
+
+    bool threadLoop();
+    void wake();
+    long nowLocked();
+    int loadLocked();
+    int findLocked(int eventId);
+    int conflictsLocked(const Booking &booking, Vector<int> *conflicts);
+    int changeLocked(int op, const Booking &booking);
+    void applyLocked(int op, const Booking &booking);
+    int journalLocked(int op, const Booking &booking);
+    void checkpointLocked();
+    void scheduleLocked(Booking &booking);
+    void fireDueLocked(long now, Vector<Fired> &fired);
+    void armLocked(long now);
+    static uint32_t recordSum(const JournalRecord &rec);
+    //earliest deadline on top
+    static bool deadlineLater(const Deadline &a, const Deadline &b)
+    {
+        return a.when > b.when;
+    }
+
+    static sp<CTvBookingScheduler> mInstance;
+
+    IObserver *mpObserver;
+    CTvTime *mpTime;
+    Vector<Booking> mBookings;
+    std::vector<Deadline> mHeap;
+    bool mLoaded;
+    int mGen;
+    int mTimerFd;
+    int mWakeFd;
+    int mJournalFd;
+    int mPreroll;
+    int mPostroll;
+    //a recording takes a tuner and a dvr channel
+    int mRecordCount;
+    mutable Mutex mLock;
+};
+#endif //_CTVBOOKINGSCHEDULER_H
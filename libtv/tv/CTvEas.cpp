@@ -203,7 +203,9 @@ void CTvEas::EasEvtCallback(long dev_no, int event_type, void *param, void *user
         int MultistrCount = 0;
         int DescriptorCount = 0;
         int i , j;
-        SectionCount = mInstance->GetSectionCount(tmp);
+        for (; tmp != NULL; tmp = tmp->p_next) {
+            SectionCount++;
+        }
         pEas->mCurEasEv.eas_section_count = SectionCount;
         dvbpsi_atsc_cea_t *tmp2 = (dvbpsi_atsc_cea_t *)param;
         if (tmp2 != NULL) {
@@ -246,44 +248,51 @@ void CTvEas::EasEvtCallback(long dev_no, int event_type, void *param, void *user
                 pEas->mCurEasEv.exception[i].exception_OOB_source_ID = tmp2->exception[i].exception_OOB_source_ID;
             }
 
-            dvbpsi_atsc_cea_multi_str_t *TempMulti1 = tmp2->p_first_multi_text;
-            dvbpsi_atsc_cea_multi_str_t *TempMulti2 = tmp2->p_first_multi_text;
-            if (TempMulti2 != NULL) {
-                MultistrCount = mInstance->GetMultiCount(TempMulti1);
+            //one pass over the lists, the event keeps the first entries raw for the
+            //clients and the texts are decoded by the shared multiple string decoder
+            int maxMulti = sizeof(pEas->mCurEasEv.multi_text) / sizeof(pEas->mCurEasEv.multi_text[0]);
+            pEas->mNatureText.clear();
+            pEas->mAlertText.clear();
+            for (dvbpsi_atsc_cea_multi_str_t *multi = tmp2->p_first_multi_text; multi != NULL; multi = multi->p_next) {
+                char lang[4] = {(char)multi->lang[0], (char)multi->lang[1], (char)multi->lang[2], 0};
+                CTvAtscString &text = (multi->i_type == EAS_TEXT_ALERT) ? pEas->mAlertText : pEas->mNatureText;
+                text.addSegment(lang, multi->i_compression_type, multi->i_mode, multi->compressed_str,
+                                multi->i_number_bytes);
+                if (MultistrCount >= maxMulti) {
+                    continue;
+                }
+                cea_multi_str_t *dst = &pEas->mCurEasEv.multi_text[MultistrCount++];
+                for (j=0;j<3;j++) {
+                    dst->lang[j] = multi->lang[j];
+                }
+                dst->i_type = multi->i_type;
+                dst->i_compression_type = multi->i_compression_type;
+                dst->i_mode = multi->i_mode;
+                dst->i_number_bytes = multi->i_number_bytes;
+                if (dst->i_number_bytes > (int)(sizeof(dst->compressed_str) / sizeof(dst->compressed_str[0]))) {
+                    dst->i_number_bytes = sizeof(dst->compressed_str) / sizeof(dst->compressed_str[0]);
+                }
+                for (j=0;j<dst->i_number_bytes;j++) {
+                    dst->compressed_str[j] = multi->compressed_str[j];
+                }
             }
             pEas->mCurEasEv.multi_text_count = MultistrCount;
-            for (i=0;i<MultistrCount;i++) {
-                while (TempMulti2 != NULL) {
-                    for (j=0;j<3;j++) {
-                        pEas->mCurEasEv.multi_text[i].lang[j] = TempMulti2->lang[j];
-                    }
-                    pEas->mCurEasEv.multi_text[i].i_type = TempMulti2->i_type;
-                    pEas->mCurEasEv.multi_text[i].i_compression_type = TempMulti2->i_compression_type;
-                    pEas->mCurEasEv.multi_text[i].i_mode = TempMulti2->i_mode;
-                    pEas->mCurEasEv.multi_text[i].i_number_bytes = TempMulti2->i_number_bytes;
-                    for (j=0;j<TempMulti2->i_number_bytes;j++) {
-                        pEas->mCurEasEv.multi_text[i].compressed_str[j] = TempMulti2->compressed_str[j];
-                    }
-                    TempMulti2 = TempMulti2->p_next;
+            LOGD("%s: alert text \"%s\"\n", __FUNCTION__, pEas->mAlertText.find(CTvAtscString::getTextLangs()));
+
+            int maxDesc = sizeof(pEas->mCurEasEv.descriptor) / sizeof(pEas->mCurEasEv.descriptor[0]);
+            for (dvbpsi_descriptor_t *desc = tmp2->p_first_descriptor; desc != NULL && DescriptorCount < maxDesc;
+                    desc = desc->p_next) {
+                descriptor_t *dst = &pEas->mCurEasEv.descriptor[DescriptorCount++];
+                dst->i_tag = desc->i_tag;
+                dst->i_length = desc->i_length;
+                if (dst->i_length > (int)(sizeof(dst->p_data) / sizeof(dst->p_data[0]))) {
+                    dst->i_length = sizeof(dst->p_data) / sizeof(dst->p_data[0]);
                 }
-            }
-
-            dvbpsi_descriptor_t *TempDesc1 = tmp2->p_first_descriptor;
-            dvbpsi_descriptor_t *TempDesc2 = tmp2->p_first_descriptor;
-
-            if (TempMulti1 != NULL) {
-                DescriptorCount = mInstance->GetDescCount(TempDesc1);
-            }
-            pEas->mCurEasEv.descriptor_text_count = DescriptorCount;
-
-            for (i=0;i<DescriptorCount;i++) {
-                while (TempDesc2 != NULL) {
-                    pEas->mCurEasEv.descriptor[i].i_tag = TempDesc2->i_tag;
-                    pEas->mCurEasEv.descriptor[i].i_length = TempDesc2->i_length;
-                    memcpy(pEas->mCurEasEv.descriptor[i].p_data, TempDesc2->p_data, TempDesc2->i_length);
-                    TempDesc2 = TempDesc2->p_next;
+                for (j=0;j<dst->i_length;j++) {
+                    dst->p_data[j] = desc->p_data[j];
                 }
             }
+            pEas->mCurEasEv.descriptor_text_count = DescriptorCount;
             pEas->mpObserver->onEvent(pEas->mCurEasEv);
         }
         break;
@@ -295,56 +304,15 @@ void CTvEas::EasEvtCallback(long dev_no, int event_type, void *param, void *user
 #endif
 }
 
-#ifdef SUPPORT_ADTV
-/**
- * @Function: GetSectionCount
- * @Description: Get EAS Section Count
- * @Param:pData:Address of atsc eas string which need to check count
- * @Return:count result
- */
-int CTvEas::GetSectionCount(dvbpsi_atsc_cea_t *pData)
-{
-    int count  = 0;
-    while (pData != NULL) {
-        count ++;
-        pData = pData->p_next;
-    }
-    LOGD("section: count = %d\n", count);
-    return count;
-}
-
-/**
- * @Function: GetDescCount
- * @Description: Get EAS descriptor string Count
- * @Param:pData:Address of atsc eas descriptor string which need to check count
- * @Return:count result
- */
-int CTvEas::GetDescCount(dvbpsi_descriptor_t *pData)
-{
-    int count  = 0;
-    while (pData != NULL) {
-        count ++;
-        pData = pData->p_next;
-    }
-    LOGD("descriptor: count = %d\n", count);
-    return count;
-}
-
 /**
- * @Function: GetMultiCount
- * @Description: Get EAS multi string Count
- * @Param:pData:Address of atsc eas multi string which need to check count
- * @Return:count result
+ * @Function: GetAlertText
+ * @Description: Get the decoded text of the last EAS message
+ * @Param:type: EAS_TEXT_NATURE or EAS_TEXT_ALERT
+          buf, size: buffer the text is copied to, in the user text language
+ * @Return:text length, -1 fail
  */
-int CTvEas::GetMultiCount(dvbpsi_atsc_cea_multi_str_t *pData)
+int CTvEas::GetAlertText(int type, char *buf, int size)
 {
-    int count  = 0;
-    while (pData != NULL) {
-        count ++;
-        pData = pData->p_next;
-    }
-    LOGD("multi: count = %d\n", count);
-    return count;
+    const CTvAtscString &text = (type == EAS_TEXT_ALERT) ? mAlertText : mNatureText;
+    return text.copyTo(CTvAtscString::getTextLangs(), buf, size);
 }
-#endif
-
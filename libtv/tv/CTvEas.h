@@ -13,6 +13,7 @@
 #endif
 #include "CTvLog.h"
 #include "CTvEv.h"
+#include "CTvAtscString.h"
 #include <tvutils.h>
 #if !defined(_CDTVEAS_H)
 #define _CDTVEAS_H
@@ -57,6 +58,9 @@ public :
     static const int MODE_SET    = 2;
 
     static const int SCAN_PSIP_CEA = 0x10000;
+    //i_type of the multiple strings of a message
+    static const int EAS_TEXT_NATURE = 0;
+    static const int EAS_TEXT_ALERT = 1;
 
     static const int INVALID_ID = -1;
 
@@ -144,6 +148,7 @@ public :
     ~CTvEas();
     int StartEasUpdate();
     int StopEasUpdate();
+    int GetAlertText(int type, char *buf, int size);
 
     static CTvEas *mInstance;
     void * mEasScanHandle = nullptr;
@@ -153,14 +158,11 @@ private:
     int EasCreate(int fend_id, int dmx_id, int src, char *textLangs);
     int EasDestroy();
     static  void EasEvtCallback(long dev_no, int event_type, void *param, void *user_data);
-#ifdef SUPPORT_ADTV
-    int GetSectionCount(dvbpsi_atsc_cea_t *pData);
-    int GetDescCount(dvbpsi_descriptor_t *pData);
-    int GetMultiCount(dvbpsi_atsc_cea_multi_str_t *pData);
-#endif
 
     IObserver *mpObserver;
     int mDmxId ;
     EasEvent mCurEasEv;
+    CTvAtscString mNatureText;
+    CTvAtscString mAlertText;
 };
 #endif //_CDTVEAS_H
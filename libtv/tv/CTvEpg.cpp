@@ -10,8 +10,13 @@
 #define LOG_TAG "tvserver"
 #define LOG_TV_TAG "CTvEpg"
 
+#include <tvconfig.h>
 #include "CTvEpg.h"
 #include "CTvChannel.h"
+#include "CTvDatabase.h"
+
+//forget the digests when this many programs are known
+#define EPG_MAX_DIGEST_PROGRAMS     512
 
 void CTvEpg::epg_evt_callback(long dev_no, int event_type, void *param, void *user_data __unused)
 {
@@ -25,6 +30,24 @@ void CTvEpg::epg_evt_callback(long dev_no, int event_type, void *param, void *us
     if (pEpg->mpObserver == NULL) {
         return;
     }
+    if (pEpg->mUpdater != NULL) {
+        switch (event_type) {
+        case AM_EPG_EVT_UPDATE_EVENTS:
+            pEpg->mUpdater->post(EpgEvent::EVENT_PROGRAM_EVENTS_UPDATE, (long)param);
+            return;
+        case AM_EPG_EVT_UPDATE_PROGRAM_AV:
+            pEpg->mUpdater->post(EpgEvent::EVENT_PROGRAM_AV_UPDATE, (long)param);
+            return;
+        case AM_EPG_EVT_UPDATE_PROGRAM_NAME:
+            pEpg->mUpdater->post(EpgEvent::EVENT_PROGRAM_NAME_UPDATE, (long)param);
+            return;
+        case AM_EPG_EVT_UPDATE_TS:
+            pEpg->mUpdater->post(EpgEvent::EVENT_CHANNEL_UPDATE, (long)param);
+            return;
+        default:
+            break;
+        }
+    }
     switch (event_type) {
     case AM_EPG_EVT_NEW_TDT:
     case AM_EPG_EVT_NEW_STT: {
@@ -68,6 +91,12 @@ void CTvEpg::Init(int fend, int dmx, int fend_mod, char *textLanguages, char *dv
     mFend_mod   = fend_mod;
     epg_create(fend, dmx, fend_mod, textLanguages);
     epg_set_dvb_text_coding(dvb_text_coding);
+
+    int batchMs = config_get_int(CFG_SECTION_TV, CFG_DTV_EPG_BATCH_MS, 500);
+    if (batchMs > 0 && mUpdater == NULL) {
+        mUpdater = sp<EpgUpdater>::make(this, batchMs);
+        mUpdater->run("CTvEpgUpdater");
+    }
 }
 
 void CTvEpg::epg_create(int fend_id, int dmx_id, int src, char *textLangs)
@@ -118,6 +147,12 @@ void CTvEpg::epg_destroy()
         AM_EVT_Unsubscribe((long)mEpgScanHandle, AM_EPG_EVT_UPDATE_TS, epg_evt_callback, NULL);
         AM_EPG_Destroy(mEpgScanHandle);
     }
+#endif
+    if (mUpdater != NULL) {
+        mUpdater->stop();
+        mUpdater = NULL;
+    }
+#ifdef SUPPORT_ADTV
 
     if (mDmx_dev_id != INVALID_ID)
         AM_DMX_Close(mDmx_dev_id);
@@ -219,3 +254,153 @@ void CTvEpg::leaveProgram()
     epg_monitor_service(-1);
     mCurScanProgramId = INVALID_ID;
 }
+
+CTvEpg::EpgUpdater::EpgUpdater(CTvEpg *epg, int batchMs)
+{
+    mpEpg = epg;
+    mBatchMs = batchMs;
+    mPosted = 0;
+    mDelivered = 0;
+    mUnchanged = 0;
+}
+
+CTvEpg::EpgUpdater::~EpgUpdater()
+{
+}
+
+void CTvEpg::EpgUpdater::post(int type, long id)
+{
+    AutoMutex _l(mLock);
+    mPosted++;
+    for (size_t i = 0; i < mPending.size(); i++) {
+        if (mPending[i].type == type && mPending[i].id == id) {
+            return;
+        }
+    }
+    PendingUpdate update;
+    update.type = type;
+    update.id = id;
+    mPending.add(update);
+    if (mPending.size() == 1) {
+        mCond.signal();
+    }
+}
+
+void CTvEpg::EpgUpdater::stop()
+{
+    {
+        AutoMutex _l(mLock);
+        requestExit();
+        mCond.signal();
+    }
+    join();
+}
+
+bool CTvEpg::EpgUpdater::eventsChanged(int programId)
+{
+    String8 cmd = String8::format("select event_id,start,end,name,descr,ext_descr,nibble_level,parental_rating,rrt_ratings"
+                                  " from evt_table where db_srv_id = %d order by event_id, start", programId);
+    CTvDatabase::Cursor c;
+    std::vector<EventDigest> digests;
+    CTvDatabase::GetTvDb()->select(cmd.string(), c);
+    if (c.moveToFirst()) {
+        do {
+            EventDigest d;
+            d.eventId = c.getInt(0);
+            d.start = c.getInt(1);
+            //fnv-1a over the columns, the separator keeps "ab","c" apart from "a","bc"
+            d.hash = 2166136261u;
+            for (int col = 2; col < 9; col++) {
+                String8 v = c.getString(col);
+                const char *p = v.string();
+                while (*p) {
+                    d.hash = (d.hash ^ (uint8_t)*p++) * 16777619u;
+                }
+                d.hash = (d.hash ^ 0x1f) * 16777619u;
+            }
+            digests.push_back(d);
+        } while (c.moveToNext());
+    }
+    c.close();
+
+    std::map<int, std::vector<EventDigest> >::iterator it = mDigests.find(programId);
+    if (it != mDigests.end()) {
+        const std::vector<EventDigest> &old = it->second;
+        int added = 0, removed = 0, changed = 0;
+        size_t i = 0, j = 0;
+        while (i < old.size() || j < digests.size()) {
+            if (j >= digests.size() || (i < old.size()
+                    && (old[i].eventId < digests[j].eventId
+                        || (old[i].eventId == digests[j].eventId && old[i].start < digests[j].start)))) {
+                removed++;
+                i++;
+            } else if (i >= old.size() || old[i].eventId != digests[j].eventId || old[i].start != digests[j].start) {
+                added++;
+                j++;
+            } else {
+                if (old[i].hash != digests[j].hash)
+                    changed++;
+                i++;
+                j++;
+            }
+        }
+        if (added == 0 && removed == 0 && changed == 0) {
+            return false;
+        }
+        LOGD("program %d events: %d added, %d removed, %d changed", programId, added, removed, changed);
+        it->second.swap(digests);
+        return true;
+    }
+
+    if (mDigests.size() >= EPG_MAX_DIGEST_PROGRAMS) {
+        mDigests.clear();
+    }
+    mDigests[programId].swap(digests);
+    return true;
+}
+
+void CTvEpg::EpgUpdater::deliver(const PendingUpdate &update)
+{
+    if (update.type == EpgEvent::EVENT_PROGRAM_EVENTS_UPDATE && !eventsChanged((int)update.id)) {
+        mUnchanged++;
+        return;
+    }
+    EpgEvent ev;
+    ev.type = update.type;
+    if (update.type == EpgEvent::EVENT_CHANNEL_UPDATE) {
+        ev.channelID = (int)update.id;
+    } else {
+        ev.programID = update.id;
+    }
+    mDelivered++;
+    if (mpEpg->mpObserver != NULL) {
+        mpEpg->mpObserver->onEvent(ev);
+    }
+}
+
+bool CTvEpg::EpgUpdater::threadLoop()
+{
+    while (!exitPending()) {
+        Vector<PendingUpdate> batch;
+        {
+            AutoMutex _l(mLock);
+            if (mPending.isEmpty()) {
+                mCond.wait(mLock);
+                continue;
+            }
+            //let the rest of the sections of this round come in
+            mCond.waitRelative(mLock, (nsecs_t)mBatchMs * 1000000LL);
+            if (exitPending()) {
+                break;
+            }
+            batch = mPending;
+            mPending.clear();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            deliver(batch[i]);
+        }
+        LOGD("epg updates: %d posted, %d delivered, %d unchanged", mPosted, mDelivered, mUnchanged);
+    }
+    return false;
+}
@@ -15,6 +15,11 @@
 #endif
 
 #include <log/log.h>
+#include <map>
+#include <vector>
+#include <utils/Thread.h>
+#include <utils/Condition.h>
+#include <utils/Vector.h>
 #include "CTvEv.h"
 #include <tvutils.h>
 #if !defined(_CDTVEPG_H)
@@ -105,6 +110,43 @@ public :
         virtual ~IObserver() {};
         virtual void onEvent(const EpgEvent &ev) = 0;
     };
+    //coalesces the update events of the epg within dtv.epg.batch.ms and drops
+    //EVENT_PROGRAM_EVENTS_UPDATE when the events of the program in evt_table
+    //are the same as at the last one delivered
+    class EpgUpdater : public Thread {
+    public:
+        EpgUpdater(CTvEpg *epg, int batchMs);
+        ~EpgUpdater();
+        void post(int type, long id);
+        void stop();
+
+    private:
+        struct PendingUpdate {
+            int type;
+            long id;
+        };
+        struct EventDigest {
+            int eventId;
+            int start;
+            uint32_t hash;
+        };
+
+        bool threadLoop();
+        void deliver(const PendingUpdate &update);
+        bool eventsChanged(int programId);
+
+        CTvEpg *mpEpg;
+        int mBatchMs;
+        Vector<PendingUpdate> mPending;
+        //rows of evt_table per db_srv_id, sorted by event id
+        std::map<int, std::vector<EventDigest> > mDigests;
+        int mPosted;
+        int mDelivered;
+        int mUnchanged;
+        mutable Mutex mLock;
+        Condition mCond;
+    };
+
     //1 VS n
     //int addObserver(IObserver* ob);
     //int removeObserver(IObserver* ob);
@@ -175,5 +217,6 @@ private:
 
     //
     EpgEvent mCurEpgEv;
+    sp<EpgUpdater> mUpdater;
 };
 #endif //_CDTVEPG_H
@@ -47,6 +47,7 @@ public:
     static const int TV_EVENT_CHECK_SOURCE_VALID = 27;
     static const int TV_EVENT_PLAY_INSTANCE = 28;
     static const int TV_EVENT_QMS = 29;
+    static const int TV_EVENT_BOOKING = 30;
 
     CTvEv(int type);
     virtual ~CTvEv() {};
@@ -311,6 +312,7 @@ namespace  TvEvent {
         ~RecorderEvent() {}
         static const int EVENT_RECORD_START = 0x01;
         static const int EVENT_RECORD_STOP = 0x02;
+        static const int EVENT_RECORD_LOW_SPACE = 0x03;
 
         String8 mId;
         int mStatus;
@@ -353,6 +355,25 @@ namespace  TvEvent {
         int qms_fps;
         int qms_base_fps;
     };
+
+    class BookingEvent: public CTvEv {
+    public:
+        BookingEvent() : CTvEv ( CTvEv::TV_EVENT_BOOKING)
+        {
+            mAction = 0;
+            mEventId = 0;
+            mProgramId = 0;
+            mStart = 0;
+            mDuration = 0;
+        }
+        ~BookingEvent() {}
+        //CTvBookingScheduler::ACTION_*
+        int mAction;
+        int mEventId;
+        int mProgramId;
+        long mStart;
+        long mDuration;
+    };
 };
 #endif
 
@@ -10,56 +10,253 @@
 #if !defined(_CTVMANAGER_H_)
 #define _CTVMANAGER_H_
 
+#include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #include <utils/Mutex.h>
 #include <utils/Singleton.h>
+#include <utils/String8.h>
+#include <utils/Vector.h>
 
 #include "CTvPlayer.h"
 #include "CTvRecord.h"
+#include "CTvRecArbiter.h"
 
 
 using namespace android;
 
+//told that a device was released on a foreign thread, the owner calls
+//reap() from its own loop
+class IDevReaper {
+public:
+    IDevReaper() {};
+    virtual ~IDevReaper() {};
+    virtual void onDevGarbage() = 0;
+};
+
+//devices by id, owned by the manager once added. Lookups hand out handles
+//that keep the device alive, a removed device is deleted when its last
+//handle goes. Only the removing thread deletes it there, a last handle of
+//another thread (a player or dvr callback) queues it for the reaper, the
+//device is never torn down from inside its own callback. A manager with an
+//onDevRemoved releases its devices in its own destructor.
 template<typename T, int MAX>
 class DevManager {
+    public:
+        static const int ID_MAX_LEN = 64;
+
+        enum {
+            DEV_NONE,
+            DEV_ACTIVE,
+            //removed, deleted when its last handle goes
+            DEV_RELEASING,
+        };
+
+        struct DevInfo {
+            char id[ID_MAX_LEN];
+            int state;
+            //handles held outside the manager
+            int refs;
+        };
+
     private:
-        T *mDevs[MAX];
+        struct Entry {
+            T *dev;
+            int refs;
+            int state;
+            unsigned int hash;
+            //the thread of removeDev/releaseAll
+            pthread_t remover;
+            char id[ID_MAX_LEN];
+        };
+
+    public:
+        //like sp<>, the device stays valid while a handle points to it
+        class Handle {
+            public:
+                Handle() : mOwner(NULL), mEntry(NULL) {}
+                Handle(const Handle &h) : mOwner(h.mOwner), mEntry(h.mEntry) {
+                    if (mEntry)
+                        mOwner->acquire(mEntry);
+                }
+                ~Handle() {
+                    clear();
+                }
+                Handle &operator=(const Handle &h) {
+                    if (h.mEntry)
+                        h.mOwner->acquire(h.mEntry);
+                    clear();
+                    mOwner = h.mOwner;
+                    mEntry = h.mEntry;
+                    return *this;
+                }
+                T *get() const {
+                    return mEntry ? mEntry->dev : NULL;
+                }
+                T *operator->() const {
+                    return get();
+                }
+                explicit operator bool() const {
+                    return mEntry != NULL;
+                }
+                void clear() {
+                    if (mEntry)
+                        mOwner->drop(mEntry);
+                    mOwner = NULL;
+                    mEntry = NULL;
+                }
+
+            private:
+                friend class DevManager;
+                //takes over a reference already counted
+                Handle(DevManager *owner, Entry *entry) : mOwner(owner), mEntry(entry) {}
+
+                DevManager *mOwner;
+                Entry *mEntry;
+        };
+
+    private:
+        Entry *mDevs[MAX];
+        Vector<Entry *> mReleasing;
+        //released on a foreign thread, deleted by reap
+        Vector<T *> mGarbage;
+        IDevReaper *mpReaper;
         mutable Mutex mLock;
 
-        static DevManager *mInstance;
+        static unsigned int hashId(const char *id) {
+            unsigned int h = 2166136261u;
+            while (id && *id)
+                h = (h ^ (unsigned char)*id++) * 16777619u;
+            return h;
+        }
+
+        int findLocked(const char *id) const {
+            if (!id)
+                return -1;
+            unsigned int h = hashId(id);
+            for (int i = 0; i < MAX; i++)
+                if (mDevs[i] && mDevs[i]->hash == h && strcmp(mDevs[i]->id, id) == 0)
+                    return i;
+            return -1;
+        }
+
+        void acquire(Entry *e) {
+            AutoMutex _l( mLock );
+            e->refs++;
+        }
+
+        void drop(Entry *e) {
+            T *dev = NULL;
+            IDevReaper *reaper = NULL;
+            {
+                AutoMutex _l( mLock );
+                if (--e->refs > 0)
+                    return;
+                for (size_t i = 0; i < mReleasing.size(); i++) {
+                    if (mReleasing[i] == e) {
+                        mReleasing.removeAt(i);
+                        break;
+                    }
+                }
+                dev = e->dev;
+                bool remover = pthread_equal(e->remover, pthread_self());
+                delete e;
+                if (!remover) {
+                    mGarbage.push_back(dev);
+                    dev = NULL;
+                    reaper = mpReaper;
+                }
+            }
+            if (reaper != NULL)
+                reaper->onDevGarbage();
+            //unlocked, the device may look up the managers while going away
+            delete dev;
+        }
+
+        //the manager reference moves to the caller, who drops it
+        Entry *detachLocked(int i) {
+            Entry *e = mDevs[i];
+            mDevs[i] = NULL;
+            e->state = DEV_RELEASING;
+            e->remover = pthread_self();
+            mReleasing.push_back(e);
+            return e;
+        }
+
+        void releaseAll(bool stop) {
+            Entry *entries[MAX];
+            int count = 0;
+            {
+                AutoMutex _l( mLock );
+                for (int i = 0; i < MAX; i++)
+                    if (mDevs[i])
+                        entries[count++] = detachLocked(i);
+            }
+            for (int i = 0; i < count; i++) {
+                if (stop)
+                    entries[i]->dev->stop(NULL);
+                onDevRemoved(entries[i]->id);
+                drop(entries[i]);
+            }
+            reap();
+        }
+
+    protected:
+        //called unlocked once the device has left the manager
+        virtual void onDevRemoved(const char *id __unused) {}
 
     public:
         DevManager(){
-            memset(mDevs, 0, MAX * sizeof(T*));
+            memset(mDevs, 0, MAX * sizeof(Entry*));
+            mpReaper = NULL;
         }
-        ~DevManager(){
-            for (int i = 0; i < MAX; i++) {
-                if (!mDevs[i]) {
-                    mDevs[i]->stop(NULL);
-                    delete mDevs[i];
-                }
+        //onDevRemoved of a derived manager is gone here
+        virtual ~DevManager(){
+            releaseAll(true);
+        }
+
+        void setReaper(IDevReaper *reaper) {
+            AutoMutex _l( mLock );
+            mpReaper = reaper;
+        }
+
+        //delete the devices released on foreign threads, on the owner's thread
+        void reap() {
+            Vector<T *> garbage;
+            {
+                AutoMutex _l( mLock );
+                garbage = mGarbage;
+                mGarbage.clear();
             }
+            for (size_t i = 0; i < garbage.size(); i++)
+                delete garbage[i];
         }
-        T *getDev(const char *id) {
+        Handle getDev(const char *id) {
             AutoMutex _l( mLock );
-            T *dev = NULL;
-            for (int i = 0; i < MAX; i++)
-                if (mDevs[i]
-                    && mDevs[i]->getId()
-                    && (strcmp(mDevs[i]->getId(), id) == 0))
-                    return mDevs[i];
-            return dev;
+            int i = findLocked(id);
+            if (i < 0)
+                return Handle();
+            mDevs[i]->refs++;
+            return Handle(this, mDevs[i]);
         }
 
+        //the manager owns dev on success
         int addDev(T &dev) {
+            reap();
             AutoMutex _l( mLock );
             for (int i = 0; i < MAX; i++) {
-                if (mDevs[i] && mDevs[i]->equals(dev))
+                if (mDevs[i] && mDevs[i]->dev->equals(dev))
                     return 1;
             }
             for (int i = 0; i < MAX; i++) {
                 if (!mDevs[i]) {
-                    mDevs[i] = &dev;
+                    Entry *e = new Entry();
+                    e->dev = &dev;
+                    e->refs = 1;
+                    e->state = DEV_ACTIVE;
+                    snprintf(e->id, sizeof(e->id), "%s", dev.getId() ? dev.getId() : "");
+                    e->hash = hashId(e->id);
+                    mDevs[i] = e;
                     return 0;
                 }
             }
@@ -67,39 +264,76 @@ class DevManager {
         }
 
         void removeDev(const char *id) {
+            Entry *e = NULL;
+            {
+                AutoMutex _l( mLock );
+                int i = findLocked(id);
+                if (i < 0)
+                    return;
+                e = detachLocked(i);
+            }
+            onDevRemoved(e->id);
+            drop(e);
+            reap();
+        }
+
+        void releaseAll() {
+            releaseAll(true);
+        }
+
+        Handle getFirstDevWithIdContains(const char *pattern) {
             AutoMutex _l( mLock );
             for (int i = 0; i < MAX; i++) {
-                if (mDevs[i]
-                    && mDevs[i]->getId()
-                    && (strcmp(mDevs[i]->getId(), id) == 0)) {
-                    delete mDevs[i];
-                    mDevs[i] = NULL;
+                if (mDevs[i] && strstr(mDevs[i]->id, pattern) != 0) {
+                    mDevs[i]->refs++;
+                    return Handle(this, mDevs[i]);
                 }
             }
+            return Handle();
         }
 
-        void releaseAll() {
+        int getDevState(const char *id) const {
+            AutoMutex _l( mLock );
+            if (findLocked(id) >= 0)
+                return DEV_ACTIVE;
+            for (size_t i = 0; id && i < mReleasing.size(); i++) {
+                if (strcmp(mReleasing[i]->id, id) == 0)
+                    return DEV_RELEASING;
+            }
+            return DEV_NONE;
+        }
+
+        //copy of the active and the releasing devices, for dump
+        int getSnapshot(Vector<DevInfo> &infos) const {
             AutoMutex _l( mLock );
+            infos.clear();
+            DevInfo info;
             for (int i = 0; i < MAX; i++) {
                 if (mDevs[i]) {
-                    mDevs[i]->stop(NULL);
-                    delete mDevs[i];
-                    mDevs[i] = NULL;
+                    memcpy(info.id, mDevs[i]->id, sizeof(info.id));
+                    info.state = DEV_ACTIVE;
+                    info.refs = mDevs[i]->refs - 1;
+                    infos.push_back(info);
                 }
             }
+            for (size_t i = 0; i < mReleasing.size(); i++) {
+                memcpy(info.id, mReleasing[i]->id, sizeof(info.id));
+                info.state = DEV_RELEASING;
+                info.refs = mReleasing[i]->refs;
+                infos.push_back(info);
+            }
+            return infos.size();
         }
 
-        T *getFirstDevWithIdContains(const char *pattern) {
-            AutoMutex _l( mLock );
-            T *dev = NULL;
-            for (int i = 0; i < MAX; i++)
-                if (mDevs[i]
-                    && mDevs[i]->getId()
-                    && (strstr(mDevs[i]->getId(), pattern) != 0))
-                    return mDevs[i];
-            return dev;
+        void dump(const char *name, String8 &result) const {
+            Vector<DevInfo> infos;
+            getSnapshot(infos);
+            result.appendFormat("\n%s: %zu/%d\n", name, infos.size(), MAX);
+            for (size_t i = 0; i < infos.size(); i++) {
+                result.appendFormat("  %s: %s, %d handle(s)\n", infos[i].id,
+                                    (infos[i].state == DEV_ACTIVE) ? "active" : "releasing", infos[i].refs);
+            }
         }
-
 };
 
 class CTvRecord;
@@ -110,7 +344,16 @@ class RecorderManager : public DevManager<CTvRecord, 2>, public Singleton<Record
 
     public:
         RecorderManager(){}
-    ~RecorderManager(){}
+    //here, the base destructor would not reach onDevRemoved any more
+    ~RecorderManager(){
+        releaseAll();
+    }
+
+    protected:
+        //the recording resources go with the recorder, whatever ended it
+        void onDevRemoved(const char *id) {
+            CTvRecArbiter::getInstance()->release(id);
+        }
 };
 
 class CTvPlayer;
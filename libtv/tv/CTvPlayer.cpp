@@ -47,8 +47,12 @@ CDTVTvPlayer::CDTVTvPlayer(CTv *tv) : CTvPlayer(tv) {
     mOffset = -1;
     mDisableTimeShifting = propertyGetBool("vendor.tv.dtv.tvserver.tf.disable", true);
     mIsTsplayer = propertyGetBool("vendor.tv.dtv.tsplayer.enable", false);
+    mTrickPlay = sp<CTvTrickPlay>::make(&pTv->mAv);
+    mTrickPlay->setObserver(this);
 }
 CDTVTvPlayer::~CDTVTvPlayer() {
+    mTrickPlay->stopTrick();
+    stopRecIndex();
     if (mFEParam)
         free((void*)mFEParam);
     if (mVparam)
@@ -59,7 +63,7 @@ CDTVTvPlayer::~CDTVTvPlayer() {
         free((void*)mPparam);
     if (mParam)
         free((void*)mParam);
-    CTvRecord *recorder = RecorderManager::getInstance().getDev("timeshifting");
+    RecorderManager::Handle recorder = RecorderManager::getInstance().getDev("timeshifting");
     if (recorder)
         recorder->stop(NULL);
     tryCloseTFile();
@@ -223,7 +227,10 @@ int CDTVTvPlayer::start(const char *param) {
                 strncpy(para.file_path, paramGetString(mParam, NULL, "file", "").c_str(), sizeof(para.file_path)-1);
                 para.file_path[sizeof(para.file_path)-1] = '\0';
                 readMediaInfoFromFile(para.file_path, &para.media_info);
-                LOGD("recplay start");
+                mTrickPlay->stopTrick();
+                stopRecIndex();
+                mRecIndexThread = sp<RecIndexThread>::make(para.file_path);
+                mRecIndexThread->run("RecIndexThread");
     /*            AM_AV_TimeshiftMediaInfo_t *pminfo = &para.media_info;
                 pminfo->vid_pid = mVpid;
                 pminfo->vid_fmt = mVfmt;
@@ -253,6 +260,8 @@ int CDTVTvPlayer::stop(const char *param) {
         }
     }
 
+    mTrickPlay->stopTrick();
+    stopRecIndex();
     ret = pTv->stopPlaying(true, false);
     ret = pTv->mAv.stopTimeShift();
 
@@ -276,7 +285,7 @@ int CDTVTvPlayer::pause(const char *param) {
         case PLAY_MODE_LIVE: {
             if (mDisableTimeShifting)
                 break;
-            CTvRecord *recorder = RecorderManager::getInstance().getDev("timeshifting");
+            RecorderManager::Handle recorder = RecorderManager::getInstance().getDev("timeshifting");
             if (!recorder) {
                 LOGD("recorder(timeshifting not found)");
                 TvEvent::AVPlaybackEvent AvPlayBackEvt;
@@ -346,6 +355,7 @@ int CDTVTvPlayer::pause(const char *param) {
 
         case PLAY_MODE_REC:
         case PLAY_MODE_TIMESHIFT: {
+        mTrickPlay->stopTrick();
         ret = pTv->mAv.pauseTimeShift();
         }break;
     }
@@ -362,6 +372,7 @@ int CDTVTvPlayer::resume(const char *param) {
             }break;
         case PLAY_MODE_REC:
         case PLAY_MODE_TIMESHIFT:{
+            mTrickPlay->stopTrick();
             pTv->mAv.resumeTimeShift();
         }break;
     }
@@ -377,7 +388,15 @@ int CDTVTvPlayer::seek(const char *param)
             }break;
         case PLAY_MODE_REC:
         case PLAY_MODE_TIMESHIFT:{
+            mTrickPlay->stopTrick();
             int pos = paramGetInt(param, "", "offset", 0);
+            //start decoding from the key frame before pos instead of the next one found
+            CTsIndexer::IndexEntry entry;
+            const CTsIndexer *index = getRecIndex();
+            if (index != NULL && index->findKeyFrame(pos, &entry) == 0) {
+                LOGD("seek %d snapped to key frame %d at %lld", pos, entry.timeMs, (long long)entry.offset);
+                pos = entry.timeMs;
+            }
             pTv->mAv.seekTimeShift(pos, true);
         }break;
     }
@@ -395,12 +414,47 @@ int CDTVTvPlayer::set(const char *param)
             int speed = paramGetInt(param, NULL, "speed", 0);
             if (speed == 1 || speed == -1)
                 speed = 0;
+            if (mTrickPlay->isTrickSpeed(speed)) {
+                mTrickPlay->setIndex(getRecIndex());
+                ret = mTrickPlay->startTrick(speed);
+                if (ret == 0)
+                    break;
+            }
+            mTrickPlay->stopTrick();
             pTv->mAv.setTimeShiftSpeed(speed);
         }break;
     }
     return ret;
 }
 
+bool CDTVTvPlayer::RecIndexThread::threadLoop()
+{
+    //a cached <file>.idx is loaded at once, otherwise the whole file is scanned
+    if (mIndex.open(mPath.string()) == 0) {
+        mReady = true;
+    }
+    LOGD("recplay index of %s %s", mPath.string(), mReady ? "ready" : "unavailable");
+    return false;
+}
+
+//seek and trick play fall back to the player's own search until the index is ready
+const CTsIndexer *CDTVTvPlayer::getRecIndex()
+{
+    if (mMode != PLAY_MODE_REC || mRecIndexThread == NULL)
+        return NULL;
+    return mRecIndexThread->getIndex();
+}
+
+//trick play must be stopped first, it may still hold the index
+void CDTVTvPlayer::stopRecIndex()
+{
+    if (mRecIndexThread != NULL) {
+        mRecIndexThread->abort();
+        mRecIndexThread->requestExitAndWait();
+        mRecIndexThread.clear();
+    }
+}
+
 int CDTVTvPlayer::setupDefault(const char *param)
 {
     std::string type = paramGetString(param, NULL, "type", "dtv");
@@ -445,6 +499,8 @@ int CDTVTvPlayer::startRecording(const char *name, const char *param)
     root["dvr"] = 1;
     root["path"] = paramGetString(param, NULL, "path", "/storage").c_str();
     root["prefix"] = "TimeShifting";
+    //lets the arbiter share the tuner with recordings of the same frequency
+    root["freq"] = paramGetInt(mFEParam, NULL, "freq", 0);
 
     Json::Value v;
     v["pid"] = mVpid;
@@ -500,7 +556,7 @@ int CDTVTvPlayer::startLiveTryRecording(const char *param)
         }
     }
 
-    CTvRecord *recorder = RecorderManager::getInstance().getDev("timeshifting");
+    RecorderManager::Handle recorder = RecorderManager::getInstance().getDev("timeshifting");
     if (recorder) {
         mTfile = recorder->detachFileHandler();
         if (mTfile) {
@@ -553,7 +609,7 @@ int CDTVTvPlayer::startLiveTryTimeShift(const char *param)
         }
     }
 
-    CTvRecord *recorder = RecorderManager::getInstance().getDev("timeshifting");
+    RecorderManager::Handle recorder = RecorderManager::getInstance().getDev("timeshifting");
     if (!recorder) {
         LOGD("recorder(timeshifting not found)");
         TvEvent::AVPlaybackEvent AvPlayBackEvt;
@@ -668,7 +724,7 @@ void CDTVTvPlayer::tfile_evt_callback ( long dev_no __unused, int event_type, vo
             TvEvent::AVPlaybackEvent AvPlayBackEvt;
             AvPlayBackEvt.mMsgType = TvEvent::AVPlaybackEvent::EVENT_AV_TIMESHIFT_START_TIME_CHANGED;
             AvPlayBackEvt.mProgramId = (int)(long)param;
-            CTvPlayer *player = PlayerManager::getInstance().getDev((char *)user_data);
+            PlayerManager::Handle player = PlayerManager::getInstance().getDev((char *)user_data);
             if (player)
                 player->sendTvEvent(AvPlayBackEvt);
             }
@@ -678,7 +734,7 @@ void CDTVTvPlayer::tfile_evt_callback ( long dev_no __unused, int event_type, vo
             /*TvEvent::AVPlaybackEvent AvPlayBackEvt;
             AvPlayBackEvt.mMsgType = TvEvent::AVPlaybackEvent::EVENT_AV_TIMESHIFT_END_TIME_CHANGED;
             AvPlayBackEvt.mProgramId = (int)(long)param;
-            CTvPlayer *player = PlayerManager::getInstance().getDev((char *)user_data);
+            PlayerManager::Handle player = PlayerManager::getInstance().getDev((char *)user_data);
             if (player)
                 player->sendTvEvent(AvPlayBackEvt);*/
             break;
@@ -688,6 +744,15 @@ void CDTVTvPlayer::tfile_evt_callback ( long dev_no __unused, int event_type, vo
 #endif
 }
 
+void CDTVTvPlayer::onTrickPosition(int timeMs)
+{
+    //the paused playback does not report the frames shown by the trick play
+    TvEvent::AVPlaybackEvent AvPlayBackEvt;
+    AvPlayBackEvt.mMsgType = TvEvent::AVPlaybackEvent::EVENT_AV_TIMESHIFT_CURRENT_TIME_CHANGED;
+    AvPlayBackEvt.mProgramId = timeMs;
+    sendTvEvent(AvPlayBackEvt);
+}
+
 void CDTVTvPlayer::onPlayUpdate(const CAv::AVEvent &ev)
 {
     if (ev.type == CAv::AVEvent::EVENT_PLAY_UPDATE)
@@ -794,7 +859,7 @@ void CDTVTvPlayer::player_info_callback(long dev_no __unused, int event_type, vo
             TvEvent::AVPlaybackEvent AvPlayBackEvt;
             AvPlayBackEvt.mMsgType = TvEvent::AVPlaybackEvent::EVENT_AV_TIMESHIFT_CURRENT_TIME_CHANGED;
             AvPlayBackEvt.mProgramId = info->current_time;
-            CTvPlayer *player = PlayerManager::getInstance().getDev((char *)data);
+            PlayerManager::Handle player = PlayerManager::getInstance().getDev((char *)data);
             if (player)
                 player->sendTvEvent(AvPlayBackEvt);
             }
@@ -820,6 +885,13 @@ void CDTVTvPlayer::onEvent(const CTvRecord::RecEvent &ev) {
                     sendTvEvent(AvPlayBackEvt);
             }
             }break;
+        case CTvRecord::RecEvent::EVENT_REC_NO_SPACE: {
+            LOGD("player(%s) : timeshift out of space", getId());
+            TvEvent::AVPlaybackEvent AvPlayBackEvt;
+            AvPlayBackEvt.mMsgType = TvEvent::AVPlaybackEvent::EVENT_AV_TIMESHIFT_REC_FAIL;
+            AvPlayBackEvt.mProgramId = ev.error;
+            sendTvEvent(AvPlayBackEvt);
+            }break;
         default:
             break;
     }
@@ -848,23 +920,21 @@ int CDTVTvPlayer::readMediaInfoFromFile(const char *file_path, AM_AV_TimeshiftMe
         LOGE("Cannot open file '%s'", file_path);
         return -1;
     }
-    if ((sizeof(buffer[1])<= 0) || (sizeof(buffer[1])>4))
-    {
-        close(fd);
-        return -1;
-    }
     info_len = read(fd, pkt_buf, sizeof(buffer[1]));
 
+    /*the info is stored in ts packets, copy their payloads*/
     data_len = 0;
-    /*skip the packet headers*/
-    for (i=0; i<info_len; i++) {
-        if ((i%188) > 3) {
-            if ((data_len++) < sizeof(buffer[0]))
-            {
-                buf[data_len++] = pkt_buf[i];
-            }
-            //buf[data_len++] = pkt_buf[i];
+    for (i = 0; i + 4 < info_len; i += TS_PACKET_SIZE) {
+        if (pkt_buf[i] != TS_SYNC_BYTE) {
+            LOGE("media info of '%s' lost sync at %d", file_path, i);
+            break;
         }
+        /*the last packet may be cut by the read size*/
+        int copy = (info_len - i < TS_PACKET_SIZE) ? (info_len - i - 4) : (TS_PACKET_SIZE - 4);
+        if (data_len + copy > (int)sizeof(buffer[0]))
+            copy = sizeof(buffer[0]) - data_len;
+        memcpy(buf + data_len, pkt_buf + i + 4, copy);
+        data_len += copy;
     }
 
     info_len = data_len;
@@ -11,12 +11,15 @@
 #define _CTVPLAYER_H_
 
 #include <string.h>
+#include <atomic>
 
 #ifdef SUPPORT_ADTV
 #include "am_misc.h"
 #endif
 #include "CTv.h"
 #include "CTvRecord.h"
+#include "CTsIndexer.h"
+#include "CTvTrickPlay.h"
 #include "CTvManager.h"
 #include "tvutils.h"
 
@@ -50,7 +53,7 @@ class CTvPlayer {
         const char *mId;
 };
 
-class CDTVTvPlayer : public CTvPlayer, public CTvRecord::IObserver {
+class CDTVTvPlayer : public CTvPlayer, public CTvRecord::IObserver, public CTvTrickPlay::IObserver {
 
     static const bool bStartInTimeShift = true;
 
@@ -74,6 +77,7 @@ class CDTVTvPlayer : public CTvPlayer, public CTvRecord::IObserver {
 
         void onEvent(const CTvRecord::RecEvent &ev) ;
         void onPlayUpdate(const CAv::AVEvent &ev);
+        void onTrickPosition(int timeMs);
         //add for libvr and tsplayer
         DVR_AudioFormat_t toDvrAudioFormat(int codec);
         DVR_VideoFormat_t toDvrVideoFormat(int codec);
@@ -105,6 +109,34 @@ class CDTVTvPlayer : public CTvPlayer, public CTvRecord::IObserver {
 
         bool mSourceChanged;
 
+        //indexes the recording of PLAY_MODE_REC without delaying the start of playback
+        class RecIndexThread : public Thread {
+        public:
+            RecIndexThread(const char *path) : mPath(path), mReady(false) {}
+            //NULL until the index is loaded or built
+            const CTsIndexer *getIndex() const
+            {
+                return mReady ? &mIndex : NULL;
+            }
+            void abort()
+            {
+                mIndex.abort();
+            }
+        private:
+            bool threadLoop();
+
+            String8 mPath;
+            CTsIndexer mIndex;
+            std::atomic<bool> mReady;
+        };
+
+        const CTsIndexer *getRecIndex();
+        void stopRecIndex();
+
+        sp<RecIndexThread> mRecIndexThread;
+        //key frame fast forward/rewind in PLAY_MODE_REC and PLAY_MODE_TIMESHIFT
+        sp<CTvTrickPlay> mTrickPlay;
+
 
 #ifdef SUPPORT_ADTV
         static int readMediaInfoFromFile(const char *file_path, AM_AV_TimeshiftMediaInfo_t *info);
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvRecArbiter"
+
+#include <string.h>
+#include "CTvRecArbiter.h"
+#include <tvconfig.h>
+#include "CTvLog.h"
+
+static const char *priorityName(int priority)
+{
+    switch (priority) {
+    case CTvRecArbiter::PRIORITY_BACKGROUND:
+        return "background";
+    case CTvRecArbiter::PRIORITY_SCHEDULED:
+        return "scheduled";
+    case CTvRecArbiter::PRIORITY_TIMESHIFT:
+        return "timeshift";
+    case CTvRecArbiter::PRIORITY_LIVE:
+        return "live";
+    default:
+        return "unknown";
+    }
+}
+
+CTvRecArbiter *CTvRecArbiter::mInstance = NULL;
+
+CTvRecArbiter *CTvRecArbiter::getInstance()
+{
+    if (NULL == mInstance) {
+        mInstance = new CTvRecArbiter();
+    }
+    return mInstance;
+}
+
+CTvRecArbiter::CTvRecArbiter()
+{
+    mpObserver = NULL;
+    mSeq = 0;
+    mTunerCount = config_get_int(CFG_SECTION_TV, CFG_DTV_RES_TUNER_COUNT, 1);
+    mDemuxCount = config_get_int(CFG_SECTION_TV, CFG_DTV_RES_DEMUX_COUNT, 3);
+    mDvrCount = config_get_int(CFG_SECTION_TV, CFG_DTV_RES_DVR_COUNT, 2);
+    LOGD("resources: tuner %d, demux %d, dvr %d", mTunerCount, mDemuxCount, mDvrCount);
+}
+
+CTvRecArbiter::~CTvRecArbiter()
+{
+    for (size_t i = 0; i < mHolders.size(); i++) {
+        delete mHolders[i];
+    }
+    mHolders.clear();
+}
+
+int CTvRecArbiter::findLocked(const char *id)
+{
+    for (size_t i = 0; i < mHolders.size(); i++) {
+        if (mHolders[i]->id.compare(id) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CTvRecArbiter::fitsLocked(const ResHolder &req, const Vector<ResHolder *> &excluded)
+{
+    if (req.dvr >= mDvrCount) {
+        return false;
+    }
+
+    int fends[8];
+    int fendCount = 0;
+    int demuxUsed = 1;
+    bool fendUsed = false;
+    for (size_t i = 0; i < mHolders.size(); i++) {
+        ResHolder *h = mHolders[i];
+        if (!h->granted || h->id == req.id) {
+            continue;
+        }
+        bool skip = false;
+        for (size_t j = 0; j < excluded.size(); j++) {
+            if (excluded[j] == h) {
+                skip = true;
+                break;
+            }
+        }
+        if (skip) {
+            continue;
+        }
+
+        if (req.dvr >= 0 && h->dvr == req.dvr) {
+            return false;
+        }
+        demuxUsed++;
+        if (h->fend == req.fend) {
+            //one tuner, one frequency
+            if (h->freq != 0 && req.freq != 0 && h->freq != req.freq) {
+                return false;
+            }
+            fendUsed = true;
+        }
+        bool counted = false;
+        for (int j = 0; j < fendCount; j++) {
+            if (fends[j] == h->fend) {
+                counted = true;
+                break;
+            }
+        }
+        if (!counted && fendCount < (int)(sizeof(fends) / sizeof(fends[0]))) {
+            fends[fendCount++] = h->fend;
+        }
+    }
+
+    if (demuxUsed > mDemuxCount) {
+        return false;
+    }
+    if (!fendUsed && fendCount + 1 > mTunerCount) {
+        return false;
+    }
+    return true;
+}
+
+bool CTvRecArbiter::findVictimsLocked(const ResHolder &req, Vector<ResHolder *> &victims)
+{
+    //cheapest first: lowest priority, then the most recently started
+    Vector<ResHolder *> candidates;
+    for (size_t i = 0; i < mHolders.size(); i++) {
+        ResHolder *h = mHolders[i];
+        if (!h->granted || h->priority >= req.priority || h->id == req.id) {
+            continue;
+        }
+        size_t pos = 0;
+        while (pos < candidates.size()
+               && (candidates[pos]->priority < h->priority
+                   || (candidates[pos]->priority == h->priority && candidates[pos]->seq > h->seq))) {
+            pos++;
+        }
+        candidates.insertAt(h, pos);
+    }
+
+    victims.clear();
+    for (size_t i = 0; i < candidates.size(); i++) {
+        victims.add(candidates[i]);
+        if (fitsLocked(req, victims)) {
+            return true;
+        }
+    }
+    victims.clear();
+    return false;
+}
+
+void CTvRecArbiter::grantQueuedLocked(Vector<ResHolder> &granted)
+{
+    Vector<ResHolder *> none;
+    while (true) {
+        //highest priority first, then first come
+        ResHolder *next = NULL;
+        for (size_t i = 0; i < mHolders.size(); i++) {
+            ResHolder *h = mHolders[i];
+            if (h->granted || !fitsLocked(*h, none)) {
+                continue;
+            }
+            if (next == NULL || h->priority > next->priority
+                    || (h->priority == next->priority && h->seq < next->seq)) {
+                next = h;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        next->granted = true;
+        granted.add(*next);
+        LOGD("%s, queued %s granted", __FUNCTION__, next->id.c_str());
+    }
+}
+
+int CTvRecArbiter::request(const char *id, const char *param, int priority, int fend, int freq, int dvr)
+{
+    Vector<std::string> preempted;
+    Vector<ResHolder> granted;
+    ResHolder *prev = NULL;
+    int ret;
+    {
+        AutoMutex _l(mLock);
+
+        int index = findLocked(id);
+        if (index >= 0) {
+            prev = mHolders[index];
+            if (prev->granted && prev->priority == priority && prev->fend == fend
+                    && prev->freq == freq && prev->dvr == dvr) {
+                prev->param = param ? param : "";
+                return ARBITER_GRANTED;
+            }
+            mHolders.removeAt(index);
+        }
+
+        ResHolder *req = new ResHolder();
+        req->id = id;
+        req->param = param ? param : "";
+        req->priority = priority;
+        req->fend = fend;
+        req->freq = freq;
+        req->dvr = dvr;
+        req->granted = false;
+        req->seq = mSeq++;
+
+        Vector<ResHolder *> victims;
+        if (fitsLocked(*req, victims)) {
+            ret = ARBITER_GRANTED;
+        } else if (findVictimsLocked(*req, victims)) {
+            //drop the victims now so their release cannot hand the resources to the queue
+            for (size_t i = 0; i < victims.size(); i++) {
+                LOGD("%s, %s(%s) preempts %s(%s)", __FUNCTION__, id, priorityName(priority),
+                     victims[i]->id.c_str(), priorityName(victims[i]->priority));
+                preempted.add(victims[i]->id);
+                index = findLocked(victims[i]->id.c_str());
+                delete mHolders[index];
+                mHolders.removeAt(index);
+            }
+            ret = ARBITER_GRANTED;
+        } else if (priority <= PRIORITY_SCHEDULED) {
+            ret = ARBITER_QUEUED;
+        } else {
+            ret = ARBITER_DENIED;
+        }
+
+        if (ret == ARBITER_DENIED) {
+            LOGE("%s, %s(%s) denied: fend %d, freq %d, dvr %d", __FUNCTION__, id, priorityName(priority),
+                 fend, freq, dvr);
+            delete req;
+            //the holder goes on with what it had
+            if (prev != NULL) {
+                mHolders.add(prev);
+                prev = NULL;
+            }
+        } else {
+            req->granted = (ret == ARBITER_GRANTED);
+            mHolders.add(req);
+            LOGD("%s, %s(%s) %s", __FUNCTION__, id, priorityName(priority), req->granted ? "granted" : "queued");
+        }
+        //the resources of the previous grant are free now
+        if (prev != NULL) {
+            if (prev->granted && ret != ARBITER_GRANTED) {
+                grantQueuedLocked(granted);
+            }
+            delete prev;
+        }
+    }
+
+    for (size_t i = 0; i < preempted.size(); i++) {
+        if (mpObserver != NULL) {
+            mpObserver->onRecPreempt(preempted[i].c_str());
+        }
+    }
+    for (size_t i = 0; i < granted.size(); i++) {
+        if (mpObserver != NULL) {
+            mpObserver->onRecGranted(granted[i].id.c_str(), granted[i].param.c_str());
+        }
+    }
+    return ret;
+}
+
+int CTvRecArbiter::findFree(const char *id, int freq, int *fend, int *dvr)
+{
+    AutoMutex _l(mLock);
+    Vector<ResHolder *> none;
+    ResHolder req;
+    req.id = id;
+    req.priority = PRIORITY_BACKGROUND;
+    req.freq = freq;
+    req.granted = false;
+    req.seq = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int fe = 0; fe < mTunerCount; fe++) {
+            bool shared = false;
+            for (size_t i = 0; i < mHolders.size(); i++) {
+                if (mHolders[i]->granted && mHolders[i]->fend == fe && mHolders[i]->freq == freq) {
+                    shared = true;
+                    break;
+                }
+            }
+            if ((pass == 0) != shared) {
+                continue;
+            }
+            req.fend = fe;
+            for (int d = 0; d < mDvrCount; d++) {
+                req.dvr = d;
+                if (fitsLocked(req, none)) {
+                    *fend = fe;
+                    *dvr = d;
+                    return 0;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+void CTvRecArbiter::release(const char *id)
+{
+    Vector<ResHolder> granted;
+    {
+        AutoMutex _l(mLock);
+        int index = findLocked(id);
+        if (index < 0) {
+            return;
+        }
+        bool wasGranted = mHolders[index]->granted;
+        delete mHolders[index];
+        mHolders.removeAt(index);
+        if (wasGranted) {
+            grantQueuedLocked(granted);
+        }
+    }
+
+    for (size_t i = 0; i < granted.size(); i++) {
+        if (mpObserver != NULL) {
+            mpObserver->onRecGranted(granted[i].id.c_str(), granted[i].param.c_str());
+        }
+    }
+}
+
+bool CTvRecArbiter::isQueued(const char *id)
+{
+    AutoMutex _l(mLock);
+    int index = findLocked(id);
+    return index >= 0 && !mHolders[index]->granted;
+}
+
+bool CTvRecArbiter::isGranted(const char *id)
+{
+    AutoMutex _l(mLock);
+    int index = findLocked(id);
+    return index >= 0 && mHolders[index]->granted;
+}
+
+void CTvRecArbiter::dump(String8 &result)
+{
+    AutoMutex _l(mLock);
+    result.appendFormat("\nrecording resources: tuner %d, demux %d, dvr %d\n", mTunerCount, mDemuxCount, mDvrCount);
+    for (size_t i = 0; i < mHolders.size(); i++) {
+        ResHolder *h = mHolders[i];
+        result.appendFormat("  %s: %s, %s, fend %d, freq %d, dvr %d\n", h->id.c_str(),
+                            h->granted ? "granted" : "queued", priorityName(h->priority),
+                            h->fend, h->freq, h->dvr);
+    }
+}
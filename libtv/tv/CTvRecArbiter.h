@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVRECARBITER_H_)
+#define _CTVRECARBITER_H_
+
+#include <string>
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+#include <utils/String8.h>
+
+using namespace android;
+
+#define CFG_DTV_RES_TUNER_COUNT                 "dtv.res.tuner.count"
+#define CFG_DTV_RES_DEMUX_COUNT                 "dtv.res.demux.count"
+#define CFG_DTV_RES_DVR_COUNT                   "dtv.res.dvr.count"
+
+//holder id of the program being watched, it takes a tuner and a demux but no dvr
+#define REC_ARBITER_LIVE_ID                     "live"
+
+//hands out tuners, demuxes and dvr channels to recordings: a tuner is shared by
+//users of the same frequency, a demux is taken from a pool, a dvr channel is
+//exclusive. A request which does not fit preempts lower priority holders, or
+//is queued until resources are released when it is not interactive.
+class CTvRecArbiter {
+public:
+    enum {
+        PRIORITY_BACKGROUND = 0,
+        PRIORITY_SCHEDULED = 1,
+        PRIORITY_TIMESHIFT = 2,
+        PRIORITY_LIVE = 3,
+    };
+
+    enum {
+        ARBITER_DENIED = -1,
+        ARBITER_GRANTED = 0,
+        ARBITER_QUEUED = 1,
+    };
+
+    class IObserver {
+    public:
+        IObserver() {};
+        virtual ~IObserver() {};
+        //the holder must be stopped and released before returning
+        virtual void onRecPreempt(const char *id) = 0;
+        //a queued request got its resources
+        virtual void onRecGranted(const char *id, const char *param) = 0;
+    };
+
+    CTvRecArbiter();
+    ~CTvRecArbiter();
+    static CTvRecArbiter *getInstance();
+
+    void setObserver(IObserver *ob)
+    {
+        mpObserver = ob;
+    }
+    //fend: tuner id, freq: 0 if unknown, dvr: dvr channel id, -1 for none.
+    //a holder asking for other resources is arbitrated again, and keeps its
+    //previous grant when denied
+    int request(const char *id, const char *param, int priority, int fend, int freq, int dvr);
+    //a tuner and a dvr channel a new recording of freq fits on beside the
+    //granted holders, a tuner already on freq first. -1 when there is none
+    int findFree(const char *id, int freq, int *fend, int *dvr);
+    //release granted resources or cancel a queued request
+    void release(const char *id);
+    bool isQueued(const char *id);
+    bool isGranted(const char *id);
+    void dump(String8 &result);
+
+private:
+    struct ResHolder {
+        std::string id;
+        std::string param;
+        int priority;
+        int fend;
+        int freq;
+        int dvr;
+        bool granted;
+        int seq;
+    };
+
+    bool fitsLocked(const ResHolder &req, const Vector<ResHolder *> &excluded);
+    bool findVictimsLocked(const ResHolder &req, Vector<ResHolder *> &victims);
+    int findLocked(const char *id);
+    void grantQueuedLocked(Vector<ResHolder> &granted);
+
+    static CTvRecArbiter *mInstance;
+
+    IObserver *mpObserver;
+    Vector<ResHolder *> mHolders;
+    int mTunerCount;
+    int mDemuxCount;
+    int mDvrCount;
+    int mSeq;
+    mutable Mutex mLock;
+};
+
+#endif //_CTVRECARBITER_H_
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvRecStorage"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <cutils/properties.h>
+#include "CTvRecStorage.h"
+#include "CTvLog.h"
+
+CTvRecStorage *CTvRecStorage::mInstance = NULL;
+
+CTvRecStorage *CTvRecStorage::getInstance()
+{
+    if (NULL == mInstance) {
+        mInstance = new CTvRecStorage();
+    }
+    return mInstance;
+}
+
+CTvRecStorage::CTvRecStorage()
+{
+    //0: no quota, the volume is the limit
+    mQuota = (int64_t)property_get_int32("vendor.tv.dtv.pvr.quota_mb", 0) * 1024 * 1024;
+    mLowSpace = (int64_t)property_get_int32("vendor.tv.dtv.pvr.low_space_mb", 200) * 1024 * 1024;
+    mReserveEnable = property_get_int32("vendor.tv.dtv.pvr.reserve", 1) != 0;
+}
+
+CTvRecStorage::~CTvRecStorage()
+{
+    for (size_t i = 0; i < mRecs.size(); i++) {
+        release(*mRecs[i]);
+        delete mRecs[i];
+    }
+    mRecs.clear();
+}
+
+int64_t CTvRecStorage::getAvailBytes(const char *dir)
+{
+    struct statvfs st;
+    if (statvfs(dir, &st) != 0) {
+        LOGE("statvfs %s failed, %s", dir, strerror(errno));
+        return -1;
+    }
+    return (int64_t)st.f_bavail * st.f_frsize;
+}
+
+int64_t CTvRecStorage::getAvailLocked(RecUsage &rec)
+{
+    nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (rec.statAvail < 0 || ns2ms(now - rec.statTime) >= REC_STORAGE_STAT_INTERVAL_MS) {
+        rec.statAvail = getAvailBytes(rec.dir.c_str());
+        rec.statUsed = rec.used;
+        rec.statTime = now;
+        return rec.statAvail;
+    }
+    //what this recording wrote since is gone from the volume too
+    return rec.statAvail - (rec.used - rec.statUsed);
+}
+
+int CTvRecStorage::reserve(RecUsage &rec)
+{
+    if (!mReserveEnable || rec.segmentSize <= 0) {
+        return 0;
+    }
+    int fd = open(rec.reservePath.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        LOGW("create %s failed, %s", rec.reservePath.c_str(), strerror(errno));
+        return -1;
+    }
+    int ret = fallocate(fd, 0, 0, rec.segmentSize);
+    if (ret != 0) {
+        //vfat and friends: reserving by writing would cost more than it saves
+        LOGW("fallocate %s failed, %s", rec.reservePath.c_str(), strerror(errno));
+        close(fd);
+        unlink(rec.reservePath.c_str());
+        return -1;
+    }
+    close(fd);
+    return 0;
+}
+
+void CTvRecStorage::release(RecUsage &rec)
+{
+    if (!rec.reservePath.empty()) {
+        unlink(rec.reservePath.c_str());
+    }
+}
+
+int CTvRecStorage::findLocked(const char *id)
+{
+    for (size_t i = 0; i < mRecs.size(); i++) {
+        if (mRecs[i]->id.compare(id) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int64_t CTvRecStorage::attach(const char *id, const char *dir, bool timeshift, int64_t maxSize, int64_t segmentSize)
+{
+    AutoMutex _l(mLock);
+
+    int index = findLocked(id);
+    if (index >= 0) {
+        release(*mRecs[index]);
+        delete mRecs[index];
+        mRecs.removeAt(index);
+    }
+
+    struct stat st;
+    int64_t avail = getAvailBytes(dir);
+    if (avail < 0 || stat(dir, &st) != 0) {
+        return -1;
+    }
+    //what the other recordings were granted is theirs already: a reserve file is
+    //gone from the volume, the rest of a limit on the same volume is still free
+    int64_t granted = 0, pending = 0;
+    for (size_t i = 0; i < mRecs.size(); i++) {
+        RecUsage *other = mRecs[i];
+        int64_t limit = (other->bounded && other->limit > other->used) ? other->limit : other->used;
+        granted += limit;
+        if (other->dev == st.st_dev) {
+            int64_t rest = limit - other->used - (other->reservePath.empty() ? 0 : other->segmentSize);
+            pending += rest > 0 ? rest : 0;
+        }
+    }
+    int64_t budget = avail - mLowSpace - pending;
+    if (mQuota > 0 && mQuota - granted < budget) {
+        budget = mQuota - granted;
+    }
+    if (budget < 2 * segmentSize) {
+        LOGE("%s, no room for %s in %s: avail %lld, pending %lld, granted %lld, quota %lld", __FUNCTION__,
+             id, dir, (long long)avail, (long long)pending, (long long)granted, (long long)mQuota);
+        return -1;
+    }
+
+    RecUsage *rec = new RecUsage();
+    rec->id = id;
+    rec->dir = dir;
+    rec->reservePath = std::string(dir) + "/." + id + ".reserve";
+    rec->dev = st.st_dev;
+    rec->timeshift = timeshift;
+    rec->bounded = timeshift || maxSize > 0;
+    rec->limit = (maxSize > 0 && maxSize < budget) ? maxSize : budget;
+    rec->used = 0;
+    rec->segmentSize = segmentSize;
+    rec->state = STORAGE_OK;
+    rec->statAvail = avail;
+    rec->statUsed = 0;
+    rec->statTime = systemTime(SYSTEM_TIME_MONOTONIC);
+    if (reserve(*rec) != 0) {
+        rec->reservePath.clear();
+    }
+    mRecs.add(rec);
+
+    LOGD("%s, %s %s limit %lld bytes, avail %lld", __FUNCTION__, id, timeshift ? "timeshift" : "record",
+         (long long)rec->limit, (long long)avail);
+    return rec->limit;
+}
+
+void CTvRecStorage::detach(const char *id)
+{
+    AutoMutex _l(mLock);
+    int index = findLocked(id);
+    if (index < 0) {
+        return;
+    }
+    release(*mRecs[index]);
+    delete mRecs[index];
+    mRecs.removeAt(index);
+}
+
+int CTvRecStorage::update(const char *id, int64_t size)
+{
+    AutoMutex _l(mLock);
+    int index = findLocked(id);
+    if (index < 0) {
+        return STORAGE_OK;
+    }
+    RecUsage *rec = mRecs[index];
+    rec->used = size;
+
+    //status events come several times a second, statvfs is not that cheap
+    int64_t avail = getAvailLocked(*rec);
+    int64_t used = 0;
+    for (size_t i = 0; i < mRecs.size(); i++) {
+        used += mRecs[i]->used;
+    }
+
+    int state = STORAGE_OK;
+    if (avail >= 0 && avail < rec->segmentSize) {
+        //no room for the next segment whatever the recording is
+        state = STORAGE_FULL;
+    } else if (!rec->timeshift && (size >= rec->limit || (mQuota > 0 && used >= mQuota))) {
+        state = STORAGE_FULL;
+    } else if (avail >= 0 && avail < mLowSpace) {
+        //a timeshift past its limit drops its oldest segments itself
+        state = STORAGE_LOW_SPACE;
+    }
+
+    if (state == STORAGE_FULL && rec->state != STORAGE_FULL) {
+        LOGW("%s, %s full: size %lld, limit %lld, avail %lld", __FUNCTION__, id,
+             (long long)size, (long long)rec->limit, (long long)avail);
+        release(*rec);
+        rec->reservePath.clear();
+    }
+    //report each state once
+    if (state <= rec->state && state != STORAGE_OK) {
+        return STORAGE_OK;
+    }
+    rec->state = state;
+    return state;
+}
+
+int64_t CTvRecStorage::getTotalUsed()
+{
+    AutoMutex _l(mLock);
+    int64_t used = 0;
+    for (size_t i = 0; i < mRecs.size(); i++) {
+        used += mRecs[i]->used;
+    }
+    return used;
+}
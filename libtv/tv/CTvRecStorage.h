@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVRECSTORAGE_H_)
+#define _CTVRECSTORAGE_H_
+
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+#include <utils/Vector.h>
+
+using namespace android;
+
+//volume free space is read at most this often per recording, estimated in between
+#define REC_STORAGE_STAT_INTERVAL_MS    1000
+
+//disk budget of the running recordings: a global quota and a low space threshold
+//checked against the volume, plus one pre-allocated segment per recording which
+//is given back when the disk is full so the segment being written can be closed
+class CTvRecStorage {
+public:
+    enum {
+        STORAGE_OK = 0,
+        STORAGE_LOW_SPACE = 1,
+        STORAGE_FULL = 2,
+    };
+
+    CTvRecStorage();
+    ~CTvRecStorage();
+    static CTvRecStorage *getInstance();
+
+    //return the size the recording may grow to (maxSize clamped to the budget),
+    //-1 if there is not room for two segments
+    int64_t attach(const char *id, const char *dir, bool timeshift, int64_t maxSize, int64_t segmentSize);
+    void detach(const char *id);
+    //size: bytes written by the recording so far, return STORAGE_*
+    int update(const char *id, int64_t size);
+    int64_t getTotalUsed();
+
+private:
+    struct RecUsage {
+        std::string id;
+        std::string dir;
+        std::string reservePath;
+        dev_t dev;
+        bool timeshift;
+        //the limit is a grant only when asked for, not a share of the volume
+        bool bounded;
+        int64_t limit;
+        int64_t used;
+        int64_t segmentSize;
+        int state;
+        int64_t statAvail;
+        int64_t statUsed;
+        nsecs_t statTime;
+    };
+
+    int findLocked(const char *id);
+    int64_t getAvailBytes(const char *dir);
+    int64_t getAvailLocked(RecUsage &rec);
+    int reserve(RecUsage &rec);
+    void release(RecUsage &rec);
+
+    static CTvRecStorage *mInstance;
+
+    Vector<RecUsage *> mRecs;
+    int64_t mQuota;
+    int64_t mLowSpace;
+    bool mReserveEnable;
+    mutable Mutex mLock;
+};
+
+#endif //_CTVRECSTORAGE_H_
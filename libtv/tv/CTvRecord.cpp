@@ -10,8 +10,10 @@
 #define LOG_TAG "tvserver"
 #define LOG_TV_TAG "CTvRecord"
 
+#include <errno.h>
 #include <tvutils.h>
 #include "CTvRecord.h"
+#include "CTvRecStorage.h"
 #include "CTvLog.h"
 #include <cutils/properties.h>
 #include "json/json.h"
@@ -329,6 +331,19 @@ void CTvRecord::rec_evt_cb(long dev_no, int event_type, void *param, void *data)
         dev_no, event_type, (long)param);
 }
 
+void CTvRecord::checkStorage(int64_t size)
+{
+    int state = CTvRecStorage::getInstance()->update(getId(), size);
+    if (state == CTvRecStorage::STORAGE_OK || mpObserver == NULL)
+        return;
+
+    mEvent.type = (state == CTvRecStorage::STORAGE_FULL) ? RecEvent::EVENT_REC_NO_SPACE : RecEvent::EVENT_REC_LOW_SPACE;
+    mEvent.id = std::string((const char*)getId());
+    mEvent.error = (state == CTvRecStorage::STORAGE_FULL) ? -ENOSPC : 0;
+    mEvent.size = size;
+    mpObserver->onEvent(mEvent);
+}
+
 DVR_Result_t CTvRecord::RecEventHandler(DVR_RecordEvent_t event, void *params, void *userdata)
 {
     CTvRecord *rec;
@@ -351,6 +366,7 @@ DVR_Result_t CTvRecord::RecEventHandler(DVR_RecordEvent_t event, void *params, v
                     rec->mEvent.id = std::string((const char*)rec->getId());
                     rec->mpObserver->onEvent(rec->mEvent);
                   }
+                  rec->checkStorage(status->info.size);
                break;
                case DVR_RECORD_STATE_STOPPED:
                     rec->rec_state = CTvRecord::REC_STOPPED;
@@ -368,6 +384,7 @@ DVR_Result_t CTvRecord::RecEventHandler(DVR_RecordEvent_t event, void *params, v
          }
          case DVR_RECORD_EVENT_WRITE_ERROR:
          {
+            rec->checkStorage(status->info.size);
 
             break;
          }
@@ -397,6 +414,17 @@ int CTvRecord::start(const char *param)
         snprintf(rec_open_params.location, DVR_MAX_LOCATION_SIZE,
               "%s/%s", location, DEFAULT_TIMESHIFT_BASENAME);
 
+        int64_t limit = CTvRecStorage::getInstance()->attach(getId(), location, mIsTimeshift,
+                            rec_open_params.max_size, rec_open_params.segment_size);
+        if (limit < 0) {
+            LOGE("start(%s) no space in %s", toReadable(mId), location);
+            strcpy(rec_open_params.location, location);
+            return -1;
+        }
+        //libdvr drops the oldest timeshift segments once max_size is reached
+        if (mIsTimeshift)
+            rec_open_params.max_size = limit;
+
         /*flush size for radio*/
         if (has_video == false && has_audio == true)
             rec_open_params.flush_size = 1024;
@@ -406,8 +434,23 @@ int CTvRecord::start(const char *param)
         LOGD("start(rec_open_params.location:%s) rec_open_params.flush_size(%d) time(%ld)ms max size(%lld)byte seg size(%lld)byte",
         rec_open_params.location, rec_open_params.flush_size, rec_open_params.max_time, rec_open_params.max_size, rec_open_params.segment_size);
 
-        dvr_wrapper_open_record(&wrap_recorder, &rec_open_params);
-        dvr_wrapper_start_record(wrap_recorder, &rec_start_params);
+        ret = dvr_wrapper_open_record(&wrap_recorder, &rec_open_params);
+        if (ret != DVR_SUCCESS) {
+            LOGE("start(%s) open record fail(%d)", toReadable(mId), ret);
+            memset(&wrap_recorder, 0, sizeof(wrap_recorder));
+            CTvRecStorage::getInstance()->detach(getId());
+            strcpy(rec_open_params.location, location);
+            return -1;
+        }
+        ret = dvr_wrapper_start_record(wrap_recorder, &rec_start_params);
+        if (ret != DVR_SUCCESS) {
+            LOGE("start(%s) start record fail(%d)", toReadable(mId), ret);
+            dvr_wrapper_close_record(wrap_recorder);
+            memset(&wrap_recorder, 0, sizeof(wrap_recorder));
+            CTvRecStorage::getInstance()->detach(getId());
+            strcpy(rec_open_params.location, location);
+            return -1;
+        }
         return ret;
     }
 
@@ -446,6 +489,7 @@ int CTvRecord::stop(const char *param)
         dvr_wrapper_stop_record(wrap_recorder);
         dvr_wrapper_close_record(wrap_recorder);
         rec_state = CTvRecord::REC_STOPPED;
+        CTvRecStorage::getInstance()->detach(getId());
         return 0;
     }
     if (!mRec)
@@ -79,6 +79,9 @@ public:
         static const int EVENT_REC_START=1;
         static const int EVENT_REC_STOP=2;
         static const int EVENT_REC_STARTPOSITION_CHANGED=3;
+        static const int EVENT_REC_LOW_SPACE=4;
+        //the recording can not go on, it should be stopped
+        static const int EVENT_REC_NO_SPACE=5;
         std::string id;
         int type;
         int error;
@@ -132,6 +135,7 @@ private :
     IObserver *mpObserver;
     RecEvent mEvent;
 
+    void checkStorage(int64_t size);
     static void rec_evt_cb(long dev_no, int event_type, void *param, void *data);
     static DVR_Result_t RecEventHandler(DVR_RecordEvent_t event, void *params, void *userdata);
 };
@@ -220,14 +220,16 @@ void CTvRrt::RrtTableCallback(AM_EPG_Handle_t handle, int event_type, void *para
             rrt_info.rating_region = NewRrt->rating_region;
             rrt_info.version_number = NewRrt->version_number;
             //parser rating_region_name
-            mInstance->MultipleStringParser(NewRrt->rating_region_name, rrt_info.rating_region_name);
+            mInstance->MultipleStringParser(&NewRrt->rating_region_name, rrt_info.rating_region_name,
+                                            sizeof(rrt_info.rating_region_name));
             rrt_info.dimension_defined = NewRrt->dimensions_defined;
             //parser dimensions_info
             rrt_dimensions_info  *dimensions_info = NewRrt->dimensions_info;
             while (dimensions_info != NULL) {
                 //parser dimensions_name
                 memset(&(rrt_info.dimension_name), 0, sizeof(rrt_info.dimension_name));
-                mInstance->MultipleStringParser(dimensions_info->dimensions_name,rrt_info.dimension_name);
+                mInstance->MultipleStringParser(&dimensions_info->dimensions_name, rrt_info.dimension_name,
+                                                sizeof(rrt_info.dimension_name));
                 rrt_info.graduated_scale = dimensions_info->graduated_scale;
                 rrt_info.values_defined = dimensions_info->values_defined - 1;
                 LOGD("graduated_scale:%d, values_defined:%d .\n", rrt_info.graduated_scale, rrt_info.values_defined);
@@ -235,8 +237,10 @@ void CTvRrt::RrtTableCallback(AM_EPG_Handle_t handle, int event_type, void *para
                 for (j=1;j<dimensions_info->values_defined;j++) {
                     memset(&(rrt_info.abbrev_rating_value_text), 0, sizeof(rrt_info.abbrev_rating_value_text));
                     memset(&(rrt_info.rating_value_text), 0, sizeof(rrt_info.rating_value_text));
-                    mInstance->MultipleStringParser(dimensions_info->rating_value[j].abbrev_rating_value_text, rrt_info.abbrev_rating_value_text);
-                    mInstance->MultipleStringParser(dimensions_info->rating_value[j].rating_value_text, rrt_info.rating_value_text);
+                    mInstance->MultipleStringParser(&dimensions_info->rating_value[j].abbrev_rating_value_text,
+                                                    rrt_info.abbrev_rating_value_text, sizeof(rrt_info.abbrev_rating_value_text));
+                    mInstance->MultipleStringParser(&dimensions_info->rating_value[j].rating_value_text,
+                                                    rrt_info.rating_value_text, sizeof(rrt_info.rating_value_text));
                     RrtEv.mRrtInfo = &rrt_info;
                     mInstance->mpObserver->onEvent(RrtEv);
                     RrtEv.mRrtInfo = NULL;
@@ -276,19 +280,21 @@ int CTvRrt::GetRrtSectionCount(rrt_section_info_t *pData)
  * @Function: MultipleStringParser
  * @Description: Multiple string data parser
  * @Param:atsc_multiple_string: Multiple string data
-          ret: data after parser
+          ret: data after parser, in the user text language if present
+          size: size of ret
  * @Return:
  */
-void CTvRrt::MultipleStringParser(atsc_multiple_string_t atsc_multiple_string, char *ret)
+void CTvRrt::MultipleStringParser(const atsc_multiple_string_t *atsc_multiple_string, char *ret, int size)
 {
-    int i;
-    for (i=0;i<atsc_multiple_string.i_string_count;i++) {
-        int size = strlen((char *)atsc_multiple_string.string[0].string);
-        if (ret != NULL) {
-            memcpy(ret, atsc_multiple_string.string[0].string, size+1);
-        }
+#ifdef SUPPORT_ADTV
+    CTvAtscString text;
+    for (int i = 0; i < atsc_multiple_string->i_string_count; i++) {
+        char lang[4] = {(char)atsc_multiple_string->string[i].lang[0], (char)atsc_multiple_string->string[i].lang[1],
+                        (char)atsc_multiple_string->string[i].lang[2], 0};
+        text.addString(lang, (const char *)atsc_multiple_string->string[i].string);
     }
-
+    text.copyTo(CTvAtscString::getTextLangs(), ret, size);
+#endif
     return;
 }
 
@@ -13,6 +13,7 @@
 #include <am_epg.h>
 #endif
 #include "CTvEv.h"
+#include "CTvAtscString.h"
 #include "CTvLog.h"
 
 #if !defined(_CDTVRRT_H)
@@ -91,7 +92,7 @@ private:
     int RrtDestroy(void);
     static void RrtTableCallback(AM_EPG_Handle_t dev_no, int event_type, void *param, void *user_data);
     int GetRrtSectionCount(rrt_section_info_t *pData);
-    void MultipleStringParser(atsc_multiple_string_t atsc_multiple_string, char *ret);
+    void MultipleStringParser(const atsc_multiple_string_t *atsc_multiple_string, char *ret, int size);
     static CTvRrt *mInstance;
     IObserver *mpObserver;
 public:
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvScanHistory"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "CTvScanHistory.h"
+#include <tvconfig.h>
+#include "CTvLog.h"
+
+#define SCAN_HISTORY_MAGIC      0x53484953 //"SHIS"
+#define SCAN_HISTORY_VERSION    1
+
+struct scan_history_header_s {
+    int magic;
+    int version;
+    int count;
+};
+
+CTvScanHistory *CTvScanHistory::mInstance = NULL;
+
+CTvScanHistory *CTvScanHistory::getInstance()
+{
+    if (NULL == mInstance) {
+        mInstance = new CTvScanHistory();
+    }
+    return mInstance;
+}
+
+CTvScanHistory::CTvScanHistory()
+{
+    mLoaded = false;
+    mActiveScans = 0;
+    mAborted = false;
+    mScanStartMs = 0;
+}
+
+CTvScanHistory::~CTvScanHistory()
+{
+}
+
+nsecs_t CTvScanHistory::getNowMs()
+{
+    return systemTime(SYSTEM_TIME_MONOTONIC) / 1000000;
+}
+
+bool CTvScanHistory::isEnabled()
+{
+    return config_get_int(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_ENABLE, 1) != 0;
+}
+
+int CTvScanHistory::load()
+{
+    const char *path = config_get_str(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_PATH, SCAN_HISTORY_DEFAULT_PATH);
+    mLoaded = true;
+    mRecords.clear();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOGD("no scan history at %s", path);
+        return -1;
+    }
+
+    scan_history_header_s header;
+    if (read(fd, &header, sizeof(header)) != sizeof(header)
+        || header.magic != SCAN_HISTORY_MAGIC || header.version != SCAN_HISTORY_VERSION
+        || header.count < 0 || header.count > MAX_RECORD) {
+        LOGW("scan history %s is invalid, ignore it", path);
+        close(fd);
+        return -1;
+    }
+
+    ScanRecord record;
+    for (int i = 0; i < header.count; i++) {
+        if (read(fd, &record, sizeof(record)) != sizeof(record)) {
+            LOGW("scan history %s is truncated at %d", path, i);
+            break;
+        }
+        record.probeStartMs = 0;
+        record.probed = false;
+        record.newServices = 0;
+        mRecords.add(record);
+    }
+    close(fd);
+    LOGD("load %zu scan history records", mRecords.size());
+    return 0;
+}
+
+int CTvScanHistory::save()
+{
+    const char *path = config_get_str(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_PATH, SCAN_HISTORY_DEFAULT_PATH);
+    char tmpPath[256];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    int fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOGE("open %s failed", tmpPath);
+        return -1;
+    }
+
+    scan_history_header_s header;
+    header.magic = SCAN_HISTORY_MAGIC;
+    header.version = SCAN_HISTORY_VERSION;
+    header.count = mRecords.size();
+    int ret = 0;
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        ret = -1;
+    }
+    for (size_t i = 0; ret == 0 && i < mRecords.size(); i++) {
+        if (write(fd, &mRecords[i], sizeof(ScanRecord)) != sizeof(ScanRecord)) {
+            ret = -1;
+        }
+    }
+    fsync(fd);
+    close(fd);
+
+    //replace the old history only once the new one is complete
+    if (ret != 0 || rename(tmpPath, path) != 0) {
+        LOGE("save scan history to %s failed", path);
+        unlink(tmpPath);
+        return -1;
+    }
+    return 0;
+}
+
+CTvScanHistory::ScanRecord *CTvScanHistory::findLocked(int mode, int frequency, bool create)
+{
+    for (size_t i = 0; i < mRecords.size(); i++) {
+        if (mRecords[i].mode == mode && mRecords[i].frequency == frequency) {
+            return &mRecords.editItemAt(i);
+        }
+    }
+    if (!create || (int)mRecords.size() >= MAX_RECORD) {
+        return NULL;
+    }
+
+    ScanRecord record;
+    memset(&record, 0, sizeof(record));
+    record.mode = mode;
+    record.frequency = frequency;
+    mRecords.add(record);
+    return &mRecords.editItemAt(mRecords.size() - 1);
+}
+
+void CTvScanHistory::beginScan()
+{
+    AutoMutex _l(mLock);
+    if (!mLoaded) {
+        load();
+    }
+    if (mActiveScans++ > 0) {
+        return;
+    }
+
+    mAborted = false;
+    mScanStartMs = getNowMs();
+    for (size_t i = 0; i < mRecords.size(); i++) {
+        ScanRecord &record = mRecords.editItemAt(i);
+        record.probed = false;
+        record.newServices = 0;
+    }
+}
+
+void CTvScanHistory::endScan(bool completed)
+{
+    AutoMutex _l(mLock);
+    if (mActiveScans <= 0) {
+        return;
+    }
+    if (!completed) {
+        mAborted = true;
+    }
+    if (--mActiveScans > 0) {
+        return;
+    }
+
+    if (mAborted) {
+        LOGD("scan aborted, history not updated");
+        load();
+        return;
+    }
+
+    int skipMiss = config_get_int(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_SKIP_MISS, 0);
+    int services = 0;
+    for (size_t i = 0; i < mRecords.size(); i++) {
+        ScanRecord &record = mRecords.editItemAt(i);
+        if (record.probed) {
+            record.services = record.newServices;
+            record.skipped = 0;
+            services += record.newServices;
+        } else if (skipMiss > 0 && record.missRun >= skipMiss) {
+            record.skipped++;
+        }
+    }
+    LOGD("scan took %lld ms, %d services", (long long)(getNowMs() - mScanStartMs), services);
+    save();
+}
+
+void CTvScanHistory::onProbeBegin(int mode, int frequency)
+{
+    AutoMutex _l(mLock);
+    if (mActiveScans <= 0) {
+        return;
+    }
+    ScanRecord *record = findLocked(mode, frequency, true);
+    if (record == NULL) {
+        return;
+    }
+    if (!record->probed) {
+        record->probes++;
+        record->probed = true;
+    }
+    record->probeStartMs = getNowMs();
+}
+
+void CTvScanHistory::onProbeResult(int mode, int frequency, bool locked, int snr, int strength)
+{
+    AutoMutex _l(mLock);
+    if (mActiveScans <= 0) {
+        return;
+    }
+    ScanRecord *record = findLocked(mode, frequency, false);
+    if (record == NULL || record->probeStartMs == 0) {
+        return;
+    }
+
+    if (locked) {
+        int lockTimeMs = (int)(getNowMs() - record->probeStartMs);
+        //keep 3/4 of the old value so one slow lock does not dominate
+        record->lockTimeMs = (record->locks == 0) ? lockTimeMs
+                             : (record->lockTimeMs * 3 + lockTimeMs) / 4;
+        record->locks++;
+        record->missRun = 0;
+        record->snr = snr;
+        record->strength = strength;
+    } else {
+        record->missRun++;
+    }
+    //only the first signal report of a probe counts
+    record->probeStartMs = 0;
+}
+
+void CTvScanHistory::onService(int mode, int frequency)
+{
+    AutoMutex _l(mLock);
+    if (mActiveScans <= 0) {
+        return;
+    }
+    ScanRecord *record = findLocked(mode, frequency, true);
+    if (record != NULL) {
+        record->probed = true;
+        record->newServices++;
+    }
+}
+
+//0: populated, 1: unknown or locked without services, 2: empty
+int CTvScanHistory::rankLocked(int mode, int frequency)
+{
+    ScanRecord *record = findLocked(mode, frequency, false);
+    if (record == NULL || record->probes == 0) {
+        return 1;
+    }
+    if (record->services > 0) {
+        return 0;
+    }
+    return (record->missRun > 0) ? 2 : 1;
+}
+
+void CTvScanHistory::orderChannels(int mode, Vector<sp<CTvChannel>> &channels)
+{
+    AutoMutex _l(mLock);
+    if (!mLoaded) {
+        load();
+    }
+    if (mRecords.size() == 0 || channels.size() < 2) {
+        return;
+    }
+
+    int skipMiss = config_get_int(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_SKIP_MISS, 0);
+    Vector<sp<CTvChannel>> ranked[3];
+    Vector<int> services;
+    int skip = 0;
+    for (size_t i = 0; i < channels.size(); i++) {
+        int frequency = channels[i]->getFrequency();
+        int rank = rankLocked(mode, frequency);
+        ScanRecord *record = findLocked(mode, frequency, false);
+
+        if (rank == 2 && skipMiss > 0 && record->missRun >= skipMiss && record->skipped < skipMiss) {
+            skip++;
+            continue;
+        }
+        if (rank != 0) {
+            ranked[rank].add(channels[i]);
+            continue;
+        }
+
+        //most services first, stable for equal counts
+        size_t pos = services.size();
+        while (pos > 0 && services[pos - 1] < record->services) {
+            pos--;
+        }
+        ranked[0].insertAt(channels[i], pos);
+        services.insertAt(record->services, pos);
+    }
+
+    channels.clear();
+    for (int r = 0; r < 3; r++) {
+        channels.appendVector(ranked[r]);
+    }
+    LOGD("ordered by history: %zu populated, %zu unknown, %zu empty, %d skipped",
+         ranked[0].size(), ranked[1].size(), ranked[2].size(), skip);
+}
+
+void CTvScanHistory::clear()
+{
+    AutoMutex _l(mLock);
+    mRecords.clear();
+    mLoaded = true;
+    const char *path = config_get_str(CFG_SECTION_TV, CFG_DTV_SCAN_HISTORY_PATH, SCAN_HISTORY_DEFAULT_PATH);
+    unlink(path);
+}
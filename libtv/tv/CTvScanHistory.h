@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVSCANHISTORY_H)
+#define _CTVSCANHISTORY_H
+
+#include <utils/Mutex.h>
+#include <utils/Vector.h>
+#include <utils/RefBase.h>
+#include <utils/Timers.h>
+#include "CTvChannel.h"
+
+using namespace android;
+
+#define SCAN_HISTORY_DEFAULT_PATH       "/data/vendor/tvserver/scan_history.bin"
+
+//per frequency outcome of previous dtv scans, used to probe the frequencies
+//which carried services first and to skip those which stayed empty
+class CTvScanHistory {
+public:
+    static const int MAX_RECORD = 512;
+
+    struct ScanRecord {
+        int mode;
+        int frequency;
+        int probes;         //scans which tuned this frequency
+        int locks;          //scans which locked
+        int missRun;        //consecutive scans without lock
+        int lockTimeMs;     //smoothed time from tune to lock
+        int snr;            //last locked signal quality
+        int strength;
+        int services;       //services found by the last scan
+        int skipped;        //scans which left it out since the last probe
+        //runtime only
+        nsecs_t probeStartMs;
+        bool probed;
+        int newServices;
+    };
+
+    CTvScanHistory();
+    ~CTvScanHistory();
+    static CTvScanHistory *getInstance();
+
+    bool isEnabled();
+    //one session per scanner, the history is saved when the last one ends;
+    //an aborted scan has no service counts yet so the whole session is dropped
+    void beginScan();
+    void endScan(bool completed);
+    void onProbeBegin(int mode, int frequency);
+    void onProbeResult(int mode, int frequency, bool locked, int snr, int strength);
+    void onService(int mode, int frequency);
+    //populated frequencies first (most services first), then unknown, then empty
+    //ones; frequencies missed on "dtv.scan.history.skip.miss" scans in a row are
+    //left out, but still probed once every that many scans
+    void orderChannels(int mode, Vector<sp<CTvChannel>> &channels);
+    void clear();
+
+private:
+    int load();
+    int save();
+    ScanRecord *findLocked(int mode, int frequency, bool create);
+    int rankLocked(int mode, int frequency);
+    nsecs_t getNowMs();
+
+    static CTvScanHistory *mInstance;
+
+    Vector<ScanRecord> mRecords;
+    bool mLoaded;
+    int mActiveScans;
+    bool mAborted;
+    nsecs_t mScanStartMs;
+    mutable Mutex mLock;
+};
+#endif //_CTVSCANHISTORY_H
@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvScanScheduler"
+
+#include <string.h>
+#include "CTvScanScheduler.h"
+#include <tvconfig.h>
+#include "CTvLog.h"
+
+#ifdef SUPPORT_ADTV
+#include "am_fend.h"
+#endif
+
+CTvScanScheduler *CTvScanScheduler::mInstance = NULL;
+
+CTvScanScheduler *CTvScanScheduler::getInstance()
+{
+    if (NULL == mInstance) {
+        mInstance = new CTvScanScheduler();
+    }
+    return mInstance;
+}
+
+CTvScanScheduler::CTvScanScheduler()
+{
+    mpObserver = NULL;
+    mWorkerCount = 0;
+    mScanning = false;
+    mBeginSent = false;
+    mStoreBeginSent = false;
+    mStoreEndSent = false;
+    mStartTimeMs = 0;
+    for (int i = 0; i < MAX_SCAN_TUNER; i++) {
+        mWorkers[i].pScanner = NULL;
+        mWorkers[i].observer.bind(this, i);
+        mWorkers[i].fendId = -1;
+        mWorkers[i].dmxId = -1;
+        mWorkers[i].fendOpened = false;
+        mWorkers[i].state = WORKER_IDLE;
+        mWorkers[i].percent = 0;
+        mWorkers[i].channelIndex = 0;
+        mWorkers[i].totalChannel = 0;
+    }
+}
+
+CTvScanScheduler::~CTvScanScheduler()
+{
+    stopScan();
+    //worker 0 is the CTvScanner singleton
+    for (int i = 1; i < MAX_SCAN_TUNER; i++) {
+        if (mWorkers[i].pScanner != NULL) {
+            delete mWorkers[i].pScanner;
+            mWorkers[i].pScanner = NULL;
+        }
+    }
+}
+
+int CTvScanScheduler::getTunerCount()
+{
+    int count = config_get_int(CFG_SECTION_TV, CFG_DTV_SCAN_TUNER_COUNT, 1);
+    if (count < 1) {
+        count = 1;
+    } else if (count > MAX_SCAN_TUNER) {
+        count = MAX_SCAN_TUNER;
+    }
+    return count;
+}
+
+bool CTvScanScheduler::canSchedule(CTvScanner::ScanParas &sp)
+{
+    if (getTunerCount() < 2) {
+        return false;
+    }
+    //atv scan and blind scan walk the band themselves, manual scan has one frequency
+    if (sp.getAtvMode() != TV_SCAN_ATVMODE_NONE) {
+        return false;
+    }
+    int dtvMode = sp.getDtvMode() & 0x07;
+    return dtvMode == TV_SCAN_DTVMODE_AUTO || dtvMode == TV_SCAN_DTVMODE_ALLBAND;
+}
+
+int CTvScanScheduler::openWorkerFend(ScanWorker &worker)
+{
+#ifdef SUPPORT_ADTV
+    AM_FEND_OpenPara_t para;
+    memset(&para, 0, sizeof(AM_FEND_OpenPara_t));
+    para.mode = TV_FE_AUTO;
+    int rc = AM_FEND_Open(worker.fendId, &para);
+    if ((rc != AM_FEND_ERR_BUSY) && (rc != 0)) {
+        LOGE("%s, frontend dev[%d] open failed, rc = %d", __FUNCTION__, worker.fendId, rc);
+        return -1;
+    }
+    worker.fendOpened = (rc == 0);
+#endif
+    return 0;
+}
+
+void CTvScanScheduler::closeWorkerFend(ScanWorker &worker)
+{
+#ifdef SUPPORT_ADTV
+    if (worker.fendOpened) {
+        AM_FEND_Close(worker.fendId);
+        worker.fendOpened = false;
+    }
+#endif
+}
+
+int CTvScanScheduler::Scan(CFrontEnd::FEParas &fp, CTvScanner::ScanParas &sp)
+{
+    stopScan();
+
+    AutoMutex _l(mLock);
+
+    mWorkerCount = getTunerCount();
+    int baseFend = config_get_int(CFG_SECTION_TV, FRONTEND_DTV_DEVICE, CFrontEnd::FE_DEV_ID);
+    mBeginSent = false;
+    mStoreBeginSent = false;
+    mStoreEndSent = false;
+    mServiceKeys.clear();
+    mLcnKeys.clear();
+    mStartTimeMs = systemTime(SYSTEM_TIME_MONOTONIC) / 1000000;
+
+    LOGD("%s, split scan on %d tuners", __FUNCTION__, mWorkerCount);
+
+    int started = 0;
+    for (int i = 0; i < mWorkerCount; i++) {
+        ScanWorker &worker = mWorkers[i];
+        worker.percent = 0;
+        worker.channelIndex = 0;
+        worker.totalChannel = 0;
+        worker.state = WORKER_SCANNING;
+        if (i == 0) {
+            //frontend of the singleton scanner is opened by CTv
+            worker.pScanner = CTvScanner::getInstance();
+            worker.fendId = baseFend;
+            worker.dmxId = 0;
+        } else {
+            worker.fendId = baseFend + i;
+            worker.dmxId = i;
+            if (worker.pScanner == NULL) {
+                worker.pScanner = new CTvScanner(worker.fendId, worker.dmxId);
+            }
+            if (openWorkerFend(worker) != 0) {
+                worker.state = WORKER_FINISHED;
+                continue;
+            }
+        }
+
+        worker.pScanner->setObserver(&worker.observer);
+        worker.pScanner->setPartition(i, mWorkerCount);
+        if (worker.pScanner->Scan(fp, sp) != 0) {
+            LOGW("%s, scanner %d start failed", __FUNCTION__, i);
+            worker.state = WORKER_FINISHED;
+            closeWorkerFend(worker);
+            continue;
+        }
+        started++;
+    }
+
+    //a failed worker leaves its frequencies unscanned, the caller may retry on one tuner
+    if (started == 0) {
+        for (int i = 0; i < mWorkerCount; i++) {
+            mWorkers[i].pScanner->setPartition(0, 1);
+            mWorkers[i].state = WORKER_IDLE;
+        }
+        return -1;
+    }
+    mScanning = true;
+    return 0;
+}
+
+int CTvScanScheduler::stopScan()
+{
+    CTvScanner *scanners[MAX_SCAN_TUNER];
+    int count;
+    {
+        AutoMutex _l(mLock);
+        //events still in flight are dropped once mScanning is cleared
+        mScanning = false;
+        count = mWorkerCount;
+        for (int i = 0; i < count; i++) {
+            scanners[i] = mWorkers[i].pScanner;
+        }
+    }
+
+    //AM_SCAN_Destroy waits for the scan thread, which may be blocked in onWorkerEvent
+    for (int i = 0; i < count; i++) {
+        if (scanners[i] != NULL) {
+            scanners[i]->stopScan();
+            scanners[i]->setPartition(0, 1);
+        }
+    }
+
+    AutoMutex _l(mLock);
+    for (int i = 0; i < count; i++) {
+        closeWorkerFend(mWorkers[i]);
+        mWorkers[i].state = WORKER_IDLE;
+    }
+    return 0;
+}
+
+int CTvScanScheduler::pauseScan()
+{
+    AutoMutex _l(mLock);
+    int ret = 0;
+    for (int i = 0; i < mWorkerCount; i++) {
+        if (mWorkers[i].state != WORKER_IDLE && mWorkers[i].state != WORKER_FINISHED) {
+            ret |= mWorkers[i].pScanner->pauseScan();
+        }
+    }
+    return ret;
+}
+
+int CTvScanScheduler::resumeScan()
+{
+    AutoMutex _l(mLock);
+    int ret = 0;
+    for (int i = 0; i < mWorkerCount; i++) {
+        if (mWorkers[i].state != WORKER_IDLE && mWorkers[i].state != WORKER_FINISHED) {
+            ret |= mWorkers[i].pScanner->resumeScan();
+        }
+    }
+    return ret;
+}
+
+bool CTvScanScheduler::isScanning()
+{
+    AutoMutex _l(mLock);
+    return mScanning;
+}
+
+int CTvScanScheduler::countWorkersLocked(int state)
+{
+    int count = 0;
+    for (int i = 0; i < mWorkerCount; i++) {
+        if (mWorkers[i].state >= state) {
+            count++;
+        }
+    }
+    return count;
+}
+
+//return true if ev should be passed on to the observer
+bool CTvScanScheduler::mergeEventLocked(int index, const CTvScanner::ScannerEvent &ev)
+{
+    ScanWorker &worker = mWorkers[index];
+    long long key;
+
+    switch (ev.mType) {
+    case CTvScanner::ScannerEvent::EVENT_SCAN_BEGIN:
+        if (mBeginSent) {
+            return false;
+        }
+        mBeginSent = true;
+        return true;
+    case CTvScanner::ScannerEvent::EVENT_SCAN_PROGRESS:
+        worker.percent = ev.mPercent;
+        worker.channelIndex = ev.mChannelIndex;
+        worker.totalChannel = ev.mTotalChannelCount;
+        return true;
+    case CTvScanner::ScannerEvent::EVENT_DTV_PROG_DATA:
+        //the same multiplex can lock on two tuners near a partition edge
+        key = ((long long)ev.mONetId << 32) | ((long long)(ev.mTsId & 0xffff) << 16) | (ev.mServiceId & 0xffff);
+        return mServiceKeys.insert(key).second;
+    case CTvScanner::ScannerEvent::EVENT_LCN_INFO_DATA:
+        key = ((long long)ev.mLcnInfo.net_id << 32) | ((long long)(ev.mLcnInfo.ts_id & 0xffff) << 16)
+              | (ev.mLcnInfo.service_id & 0xffff);
+        return mLcnKeys.insert(key).second;
+    case CTvScanner::ScannerEvent::EVENT_STORE_BEGIN:
+        if (worker.state < WORKER_STORING) {
+            worker.state = WORKER_STORING;
+        }
+        if (mStoreBeginSent) {
+            return false;
+        }
+        mStoreBeginSent = true;
+        return true;
+    case CTvScanner::ScannerEvent::EVENT_STORE_END:
+        if (worker.state < WORKER_STORED) {
+            worker.state = WORKER_STORED;
+        }
+        if (mStoreEndSent || countWorkersLocked(WORKER_STORED) < mWorkerCount) {
+            return false;
+        }
+        mStoreEndSent = true;
+        return true;
+    case CTvScanner::ScannerEvent::EVENT_SCAN_END:
+    case CTvScanner::ScannerEvent::EVENT_SCAN_EXIT:
+        if (worker.state == WORKER_FINISHED) {
+            return false;
+        }
+        worker.state = WORKER_FINISHED;
+        if (countWorkersLocked(WORKER_FINISHED) < mWorkerCount) {
+            return false;
+        }
+        LOGD("scan finished on %d tuners in %lld ms, %zu services", mWorkerCount,
+             (long long)(systemTime(SYSTEM_TIME_MONOTONIC) / 1000000 - mStartTimeMs),
+             mServiceKeys.size());
+        mScanning = false;
+        return true;
+    default:
+        return true;
+    }
+}
+
+void CTvScanScheduler::onWorkerEvent(int index, const CTvScanner::ScannerEvent &ev)
+{
+    CTvScanner::ScannerEvent out = ev;
+    CTvScanner::IObserver *ob;
+    {
+        AutoMutex _l(mLock);
+        if (!mScanning || !mergeEventLocked(index, ev)) {
+            return;
+        }
+        if (ev.mType == CTvScanner::ScannerEvent::EVENT_SCAN_PROGRESS) {
+            int percent = 0;
+            out.mChannelIndex = 0;
+            out.mTotalChannelCount = 0;
+            for (int i = 0; i < mWorkerCount; i++) {
+                //finished workers may not report 100 before exiting
+                percent += (mWorkers[i].state == WORKER_FINISHED) ? 100 : mWorkers[i].percent;
+                out.mChannelIndex += mWorkers[i].channelIndex;
+                out.mTotalChannelCount += mWorkers[i].totalChannel;
+            }
+            out.mPercent = percent / mWorkerCount;
+        }
+        ob = mpObserver;
+    }
+
+    if (ob != NULL) {
+        ob->onEvent(out);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVSCANSCHEDULER_H)
+#define _CTVSCANSCHEDULER_H
+
+#include <utils/Mutex.h>
+#include <utils/Timers.h>
+#include <set>
+#include "CTvScanner.h"
+
+#define CFG_DTV_SCAN_TUNER_COUNT                "dtv.scan.tuner.count"
+
+//runs one dtv scan on several frontend/demux pairs at once: the frequency list
+//is split between the scanners and their events are merged into one stream
+class CTvScanScheduler {
+public:
+    static const int MAX_SCAN_TUNER = 4;
+
+    enum {
+        WORKER_IDLE,
+        WORKER_SCANNING,
+        WORKER_STORING,
+        WORKER_STORED,
+        WORKER_FINISHED,
+    };
+
+    CTvScanScheduler();
+    ~CTvScanScheduler();
+    static CTvScanScheduler *getInstance();
+
+    //tuners available for scanning, from config
+    int getTunerCount();
+    //true if the scan can be split, only pure dtv scans are
+    bool canSchedule(CTvScanner::ScanParas &sp);
+    int Scan(CFrontEnd::FEParas &fp, CTvScanner::ScanParas &sp);
+    int stopScan();
+    int pauseScan();
+    int resumeScan();
+    bool isScanning();
+
+    void setObserver(CTvScanner::IObserver *ob)
+    {
+        mpObserver = ob;
+    }
+
+private:
+    //tags the events of one scanner with its worker index
+    class WorkerObserver: public CTvScanner::IObserver {
+    public:
+        WorkerObserver(): mpScheduler(NULL), mIndex(0) {};
+        void bind(CTvScanScheduler *scheduler, int index)
+        {
+            mpScheduler = scheduler;
+            mIndex = index;
+        }
+        virtual void onEvent(const CTvScanner::ScannerEvent &ev)
+        {
+            mpScheduler->onWorkerEvent(mIndex, ev);
+        }
+    private:
+        CTvScanScheduler *mpScheduler;
+        int mIndex;
+    };
+
+    struct ScanWorker {
+        CTvScanner *pScanner;
+        WorkerObserver observer;
+        int fendId;
+        int dmxId;
+        bool fendOpened;
+        int state;
+        int percent;
+        int channelIndex;
+        int totalChannel;
+    };
+
+    void onWorkerEvent(int index, const CTvScanner::ScannerEvent &ev);
+    bool mergeEventLocked(int index, const CTvScanner::ScannerEvent &ev);
+    int countWorkersLocked(int state);
+    int openWorkerFend(ScanWorker &worker);
+    void closeWorkerFend(ScanWorker &worker);
+
+    static CTvScanScheduler *mInstance;
+
+    CTvScanner::IObserver *mpObserver;
+    ScanWorker mWorkers[MAX_SCAN_TUNER];
+    int mWorkerCount;
+    bool mScanning;
+    bool mBeginSent;
+    bool mStoreBeginSent;
+    bool mStoreEndSent;
+    nsecs_t mStartTimeMs;
+    //(onid << 32 | tsid << 16 | sid) of services already reported
+    std::set<long long> mServiceKeys;
+    std::set<long long> mLcnKeys;
+    mutable Mutex mLock;
+};
+#endif //_CTVSCANSCHEDULER_H
@@ -16,6 +16,7 @@
 #include "CTvProgram.h"
 #include "CTvRegion.h"
 #include "CFrontEnd.h"
+#include "CTvScanHistory.h"
 
 #include <tvconfig.h>
 
@@ -27,8 +28,9 @@
 #endif
 
 CTvScanner *CTvScanner::mInstance;
-CTvScanner::ScannerEvent CTvScanner::mCurEv;
 CTvScanner::service_list_t CTvScanner::service_list_dummy;
+//scanner whose AM_SCAN thread is the calling thread, for callbacks without user data
+static __thread CTvScanner *sScanningInstance = NULL;
 
 CTvScanner *CTvScanner::getInstance()
 {
@@ -65,6 +67,53 @@ CTvScanner::CTvScanner()
     mFEType = 0;
     mVbiTsId = 0;
     mAtvIsAtsc = 0;
+    mPartIndex = 0;
+    mPartCount = 1;
+    mHistoryActive = false;
+}
+
+CTvScanner::CTvScanner(int fendId, int dmxId)
+{
+    mbScanStart = false;
+    mpObserver = NULL;
+    mSource = 0xff;
+    mMinFreq = 1;
+    mMaxFreq = 100;
+    mCurScanStartFreq = 1;
+    mCurScanEndFreq = 100;
+    mVbi = NULL;
+    mScanHandle = NULL;
+    mpTvin = NULL;
+    mMode = 0;
+    mFendID = fendId;
+    mTvMode = 0;
+    mTvOptions = 0;
+    mSat_id = 0;
+    mTsSourceID = 0;
+    mAtvMode = 0;
+    mStartFreq = 0;
+    mDirection = 0;
+    mChannelID = 0;
+    tunerStd = 0;
+    demuxID = dmxId;
+    user_band = 0;
+    ub_freq = 0;
+    mFEType = 0;
+    mVbiTsId = 0;
+    mAtvIsAtsc = 0;
+    mPartIndex = 0;
+    mPartCount = 1;
+    mHistoryActive = false;
+}
+
+void CTvScanner::setPartition(int index, int count)
+{
+    if (count < 1 || index < 0 || index >= count) {
+        LOGE("%s, invalid partition %d/%d", __FUNCTION__, index, count);
+        return;
+    }
+    mPartIndex = index;
+    mPartCount = count;
 }
 
 CTvScanner::~CTvScanner()
@@ -111,7 +160,11 @@ int CTvScanner::Scan(CFrontEnd::FEParas &fp, ScanParas &sp) {
     mAtvIsAtsc = 0;
     // Create the scan
     memset(&para, 0, sizeof(para));
-    para.fend_dev_id = config_get_int(CFG_SECTION_TV, FRONTEND_DTV_DEVICE, CFrontEnd::FE_DEV_ID);
+    if (this == mInstance) {
+        para.fend_dev_id = config_get_int(CFG_SECTION_TV, FRONTEND_DTV_DEVICE, CFrontEnd::FE_DEV_ID);
+    } else {
+        para.fend_dev_id = mFendID;
+    }
     para.vlfend_dev_id = CFrontEnd::VLFE_DEV_ID;
     para.mode = sp.getMode();
     para.proc_mode = sp.getProc();
@@ -171,6 +224,11 @@ int CTvScanner::Scan(CFrontEnd::FEParas &fp, ScanParas &sp) {
         para.dtv_para.mode |= AM_SCAN_DTVMODE_INVALIDPID;
     }
 
+    if (para.dtv_para.mode != TV_SCAN_DTVMODE_NONE && CTvScanHistory::getInstance()->isEnabled()) {
+        CTvScanHistory::getInstance()->beginScan();
+        mHistoryActive = true;
+    }
+
     if (AM_SCAN_Create(&para, &handle) != DVB_SUCCESS) {
         LOGD("SCAN CREATE fail");
         handle = NULL;
@@ -196,6 +254,10 @@ int CTvScanner::Scan(CFrontEnd::FEParas &fp, ScanParas &sp) {
     freeDtvParas(para.dtv_para);
 
     if (handle == NULL) {
+        if (mHistoryActive) {
+            CTvScanHistory::getInstance()->endScan(false);
+            mHistoryActive = false;
+        }
         return -1;
     }
     mbScanStart = true;//start call ok
@@ -244,6 +306,10 @@ int CTvScanner::stopScan()
         mbScanStart = false;//stop ok
         mFEType = -1;
     }
+    if (mHistoryActive) {
+        CTvScanHistory::getInstance()->endScan(false);
+        mHistoryActive = false;
+    }
  #endif
     return 0;
 }
@@ -302,7 +368,7 @@ void CTvScanner::notifyLcn(ScannerLcnInfo *lcn)
     mCurEv.mType = ScannerEvent::EVENT_LCN_INFO_DATA;
     mCurEv.mLcnInfo = *lcn;
 
-    getInstance()->sendEvent(mCurEv);
+    sendEvent(mCurEv);
 }
 
 void CTvScanner::notifyService(SCAN_ServiceInfo_t *srv)
@@ -325,6 +391,8 @@ void CTvScanner::notifyService(SCAN_ServiceInfo_t *srv)
 
     int feType = mCurEv.mFEParas.getFEMode().getBase();
     if (feType != TV_FE_ANALOG) {
+        if (mHistoryActive)
+            CTvScanHistory::getInstance()->onService(feType, mCurEv.mFrequency);
         mCurEv.mServiceId = srv->srv_id;
         mCurEv.mONetId = srv->tsinfo->nid;
         mCurEv.mTsId = srv->tsinfo->tsid;
@@ -478,7 +546,7 @@ void CTvScanner::notifyService(SCAN_ServiceInfo_t *srv)
     }
 
     if ((feType == TV_FE_ANALOG) || (mCurEv.mVid != 0x1fff) || mCurEv.mAcnt)
-        getInstance()->sendEvent(mCurEv);
+        sendEvent(mCurEv);
 #endif
 }
 
@@ -1497,7 +1565,9 @@ VCT_END:
 
 void CTvScanner::storeScanHelper(AM_SCAN_Result_t *result)
 {
-    if (mInstance)
+    if (sScanningInstance)
+        sScanningInstance->storeScan(result, NULL);
+    else if (mInstance)
         mInstance->storeScan(result, NULL);
     else
         LOGE("no Scanner running, ignore");
@@ -1739,7 +1809,7 @@ int CTvScanner::createDtvParas(AM_SCAN_DTVCreatePara_t &dtv_para, CFrontEnd::FEP
         return 0;
 
     dtv_para.source = fp.getFEMode().getBase();
-    dtv_para.dmx_dev_id = 0;//default 0
+    dtv_para.dmx_dev_id = demuxID;//default 0
     dtv_para.standard = (AM_SCAN_DTVStandard_t) TV_SCAN_DTV_STD_DVB;
     if (dtv_para.source == TV_FE_ATSC)
         dtv_para.standard = (AM_SCAN_DTVStandard_t) TV_SCAN_DTV_STD_ATSC;
@@ -1825,6 +1895,27 @@ int CTvScanner::createDtvParas(AM_SCAN_DTVCreatePara_t &dtv_para, CFrontEnd::FEP
         LOGD("Feature[air on cable] on, list size more: %d, total:%d", cnt, size);
     }
 
+    if (scp.getDtvMode() == TV_SCAN_DTVMODE_ALLBAND && CTvScanHistory::getInstance()->isEnabled()) {
+        CTvScanHistory::getInstance()->orderChannels(dtv_para.source, vcp);
+        size = vcp.size();
+        if (size == 0) {
+            return -1;
+        }
+    }
+
+    if (mPartCount > 1) {
+        Vector<sp<CTvChannel>> vcpPart;
+        for (int i = mPartIndex; i < size; i += mPartCount) {
+            vcpPart.add(vcp[i]);
+        }
+        vcp = vcpPart;
+        size = vcp.size();
+        LOGD("partition %d/%d, list size = %d", mPartIndex, mPartCount, size);
+        if (size == 0) {
+            return -1;
+        }
+    }
+
     if (!(dtv_para.fe_paras = static_cast<AM_FENDCTRL_DVBFrontendParameters_t *>(calloc(size, sizeof(AM_FENDCTRL_DVBFrontendParameters_t)))))
         return -1;
 
@@ -2197,8 +2288,8 @@ bool CTvScanner::checkVbiDataReady(int freq) {
 }
 
 int CTvScanner::FETypeHelperCBHelper(int id, void *para, void *user) {
-    if (mInstance)
-        mInstance->FETypeHelperCB(id, para, user);
+    if (user)
+        ((CTvScanner *)user)->FETypeHelperCB(id, para, user);
     else
         LOGE("no scanner running, ignore FETypeHelperCB");
     return -1;
@@ -2218,6 +2309,12 @@ int CTvScanner::FETypeHelperCB(int id, void *para, void *user) {
 
     mFEType = type;
 
+    if (this != mInstance) {
+        //extra scanners are dtv only and do not own CFrontEnd/CTvin
+        reconnectDmxToFend(demuxID, mFendID);
+        return 0;
+    }
+
     CFrontEnd *fe = CFrontEnd::getInstance();
     CTvin *tvin = CTvin::getInstance();
     if (type == TV_FE_ANALOG) {
@@ -2255,6 +2352,7 @@ int CTvScanner::FETypeHelperCB(int id, void *para, void *user) {
     if (pT == NULL) {
         return;
     }
+    sScanningInstance = pT;
     int AdtvMixed = (pT->mScanParas.getAtvMode() != TV_SCAN_ATVMODE_NONE
         && pT->mScanParas.getDtvMode() != TV_SCAN_DTVMODE_NONE)? 1 : 0;
     int factor =  (AdtvMixed && pT->mScanParas.getAtvMode() != TV_SCAN_ATVMODE_FREQ)? 50 : 100;
@@ -2318,6 +2416,9 @@ int CTvScanner::FETypeHelperCB(int id, void *para, void *user) {
             pT->mCurEv.mSnr = 0;
             pT->mCurEv.mType = ScannerEvent::EVENT_SCAN_PROGRESS;
 
+            if (pT->mHistoryActive && tp->fend_para.m_type != TV_FE_ANALOG)
+                CTvScanHistory::getInstance()->onProbeBegin(tp->fend_para.m_type, pT->mCurEv.mFrequency);
+
             pT->sendEvent(pT->mCurEv);
         }
         break;
@@ -2480,6 +2581,10 @@ int CTvScanner::FETypeHelperCB(int id, void *para, void *user) {
         }
         break;
         case AM_SCAN_PROGRESS_SCAN_END: {
+            if (pT->mHistoryActive) {
+                CTvScanHistory::getInstance()->endScan(true);
+                pT->mHistoryActive = false;
+            }
             pT->mCurEv.mPercent = 100;
             pT->mCurEv.mLockedStatus = 0;
             pT->mCurEv.mType = ScannerEvent::EVENT_SCAN_END;
@@ -2532,6 +2637,10 @@ int CTvScanner::FETypeHelperCB(int id, void *para, void *user) {
             pT->mCurEv.mSnr = 0;
         }
 
+        if (pT->mHistoryActive && pT->mCurEv.mFEParas.getFEMode().getBase() != TV_FE_ANALOG)
+            CTvScanHistory::getInstance()->onProbeResult(pT->mCurEv.mFEParas.getFEMode().getBase(),
+                pT->mCurEv.mFrequency, evt->locked, pT->mCurEv.mSnr, pT->mCurEv.mStrength);
+
         //if (pT->mCurEv.mMode == TV_FE_ANALOG)
         pT->sendEvent(pT->mCurEv);
         pT->mCurEv.mLockedStatus &= ~0x10;
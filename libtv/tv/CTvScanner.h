@@ -94,6 +94,8 @@ public:
     static const int AM_ATSC_ANTENNA_TYPE_CABLE_IRC = 3;
     static const int AM_ATSC_ANTENNA_TYPE_CABLE_HRC = 4;
     CTvScanner();
+    //extra scanner bound to its own frontend/demux, see CTvScanScheduler
+    CTvScanner(int fendId, int dmxId);
     ~CTvScanner();
 
     /*deprecated{{*/
@@ -111,6 +113,8 @@ public:
     /*}}deprecated*/
 
     int Scan(char *feparas, char *scanparas);
+    //only scan every count-th dtv frequency of the list, starting at index
+    void setPartition(int index, int count);
     int stopScan();
     int pauseScan();
     int resumeScan();
@@ -534,7 +538,10 @@ private:
     std::string mCurrentSystemLang;
     int mFEType;
 
-    static ScannerEvent mCurEv;
+    ScannerEvent mCurEv;
+    int mPartIndex;
+    int mPartCount;
+    bool mHistoryActive;
 
     static service_list_t service_list_dummy;
 
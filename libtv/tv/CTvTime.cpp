@@ -12,47 +12,175 @@
 
 #include "CTvTime.h"
 #include <CTvLog.h>
+#include <stdlib.h>
+
+CTvTime::CTvTime()
+{
+    mSampleCount = 0;
+    mSampleNext = 0;
+    mOutlierCount = 0;
+    mDriftMono = 0;
+    mDriftOffset = 0;
+    mDriftPpb = 0;
+    mSeq = 0;
+    mBaseMono = 0;
+    mBaseMs = 0;
+    mPpb = 0;
+    mSynced = false;
+}
+
+//boot time keeps counting in suspend, like the uptime used before
+int64_t CTvTime::monoNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
 
 long CTvTime::getSysUTCTime()
 {
-    //struct tm tm;
-    //time_t t;
-    //int64_t r = mktime_tz(&(tm), NULL);
-    //time_t t = time(NULL);
-    //LOGD("---------utc t = %ld time t=%ld", r, t);
-    return 0;
+    return (long)time(NULL);
+}
+
+int64_t CTvTime::estimateLocked(int64_t mono)
+{
+    int64_t best = 0;
+    for (int i = 0; i < mSampleCount; i++) {
+        int64_t offset = mSamples[i].offset + (mono - mSamples[i].mono) / 1000 * mDriftPpb / 1000000000000LL;
+        if (i == 0 || offset > best) {
+            best = offset;
+        }
+    }
+    return best;
+}
+
+void CTvTime::resetLocked(int64_t mono, int64_t offset)
+{
+    mSamples[0].mono = mono;
+    mSamples[0].offset = offset;
+    mSampleCount = 1;
+    mSampleNext = 1;
+    mOutlierCount = 0;
+    mDriftMono = mono;
+    mDriftOffset = offset;
+}
+
+void CTvTime::publishLocked(int64_t mono, int64_t offset)
+{
+    uint32_t seq = mSeq.load(std::memory_order_relaxed);
+    mSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    mBaseMono.store(mono, std::memory_order_relaxed);
+    mBaseMs.store(mono / 1000000 + offset, std::memory_order_relaxed);
+    mPpb.store(mDriftPpb, std::memory_order_relaxed);
+    mSeq.store(seq + 2, std::memory_order_release);
+    mSynced = true;
 }
 
 void CTvTime::setTime(long t)
 {
-    //long utcMS;
-    //time(&utcMS);
-    //nsecs_t ns = systemTime(CLOCK_REALTIME);
-    //nsecs_t tm = ns2s(ns);
-    //unsigned long ticks = times(NULL);
-    //long tm = ticks/mHZ;
-    struct sysinfo s_info;
-    int error;
-    error = sysinfo(&s_info);
+    int64_t mono = monoNs();
+    int64_t offset = (int64_t)t * 1000 - mono / 1000000;
+
+    AutoMutex _l(mLock);
+    if (mSampleCount == 0) {
+        LOGD("%s, first time %ld", __FUNCTION__, t);
+        resetLocked(mono, offset);
+        publishLocked(mono, offset);
+        return;
+    }
+
+    int64_t estimate = estimateLocked(mono);
+    if (llabs(offset - estimate) > OUTLIER_MS) {
+        if (mOutlierCount > 0 && llabs(offset - mOutliers[0].offset) > OUTLIER_MS) {
+            mOutlierCount = 0;
+        }
+        mOutliers[mOutlierCount].mono = mono;
+        mOutliers[mOutlierCount].offset = offset;
+        mOutlierCount++;
+        if (mOutlierCount < STEP_SAMPLES) {
+            LOGD("%s, drop time %ld, %lld ms off", __FUNCTION__, t, (long long)(offset - estimate));
+            return;
+        }
+
+        LOGD("%s, step to time %ld, %lld ms off", __FUNCTION__, t, (long long)(offset - estimate));
+        resetLocked(mOutliers[0].mono, mOutliers[0].offset);
+        for (int i = 1; i < STEP_SAMPLES; i++) {
+            mSamples[mSampleCount++] = mOutliers[i];
+        }
+        mSampleNext = mSampleCount % SAMPLE_COUNT;
+        publishLocked(mono, estimateLocked(mono));
+        return;
+    }
+
+    mOutlierCount = 0;
+    mSamples[mSampleNext].mono = mono;
+    mSamples[mSampleNext].offset = offset;
+    mSampleNext = (mSampleNext + 1) % SAMPLE_COUNT;
+    if (mSampleCount < SAMPLE_COUNT) {
+        mSampleCount++;
+    }
+    estimate = estimateLocked(mono);
+
+    //rate of the local clock against the stream, over a long window since
+    //the samples are whole seconds
+    int64_t elapsed = mono - mDriftMono;
+    if (elapsed >= DRIFT_WINDOW_NS) {
+        int64_t predicted = mDriftOffset + elapsed / 1000 * mDriftPpb / 1000000000000LL;
+        double residual = (double)(estimate - predicted) * 1e15 / (double)elapsed;
+        int ppb = mDriftPpb + (int)(residual / 2);
+        if (ppb > MAX_DRIFT_PPB) {
+            ppb = MAX_DRIFT_PPB;
+        } else if (ppb < -MAX_DRIFT_PPB) {
+            ppb = -MAX_DRIFT_PPB;
+        }
+        LOGD("%s, drift %d ppb", __FUNCTION__, ppb);
+        mDriftPpb = ppb;
+        mDriftMono = mono;
+        mDriftOffset = estimate;
+    }
+    publishLocked(mono, estimate);
+}
+
+int64_t CTvTime::nowMs()
+{
+    if (!mSynced) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
 
-    mDiff = t - s_info.uptime;
-    LOGD("--- mDiff=%ld", mDiff);
+    uint32_t seq;
+    int64_t baseMono;
+    int64_t baseMs;
+    int ppb;
+    do {
+        seq = mSeq.load(std::memory_order_acquire);
+        baseMono = mBaseMono.load(std::memory_order_relaxed);
+        baseMs = mBaseMs.load(std::memory_order_relaxed);
+        ppb = mPpb.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != mSeq.load(std::memory_order_relaxed));
+
+    int64_t elapsed = monoNs() - baseMono;
+    return baseMs + elapsed / 1000000 + elapsed / 1000 * ppb / 1000000000000LL;
 }
 
 long CTvTime::getTime()
 {
-    //long utcMS;
-    //time(&utcMS);
-    //nsecs_t ns = systemTime(CLOCK_REALTIME);
-    //nsecs_t sec = ns2s(ns);
+    return (long)(nowMs() / 1000);
+}
 
-    //unsigned long ticks = times(NULL);
-    //long sec = ticks/mHZ;
-    struct sysinfo s_info;
-    int error;
-    error = sysinfo(&s_info);
+long CTvTime::getDiffTime()
+{
+    return (long)((nowMs() - monoNs() / 1000000) / 1000);
+}
 
+void CTvTime::setDiffTime(long diff)
+{
+    int64_t mono = monoNs();
 
-    LOGD("--- mDiff=%ld, sec=%ld", mDiff, s_info.uptime);
-    return s_info.uptime + mDiff;
+    AutoMutex _l(mLock);
+    resetLocked(mono, (int64_t)diff * 1000);
+    publishLocked(mono, (int64_t)diff * 1000);
 }
@@ -10,32 +10,73 @@
 #ifndef _C_TV_TIME_H_
 #define _C_TV_TIME_H_
 
-#include <utils/Timers.h>
+#include <stdint.h>
 #include <time.h>
-#include <sys/times.h>
-#include <sys/sysinfo.h>
+#include <atomic>
+#include <utils/Mutex.h>
 
+using namespace android;
+
+//broadcast time, from the TDT/TOT or STT the epg scanner reports.
+//The tables only carry whole seconds, so the clock keeps the last samples
+//against a monotonic clock and uses the latest one: the stream time is
+//never ahead of the true time. Far off samples are dropped until a few
+//agree, then the clock steps. Readers never lock, see nowMs().
 class CTvTime {
 public:
-    CTvTime() {
-        mDiff = 0;
-        mHZ = sysconf( _SC_CLK_TCK );
-    }
+    static const int SAMPLE_COUNT = 16;
+    //a sample this far from the estimate is an outlier
+    static const int OUTLIER_MS = 2000;
+    //outliers in a row that agree make the clock step
+    static const int STEP_SAMPLES = 3;
+    //drift is measured over this long
+    static const int64_t DRIFT_WINDOW_NS = 3600LL * 1000000000LL;
+    static const int MAX_DRIFT_PPB = 500000;
 
+    CTvTime();
+
+    //seconds, system time
     long getSysUTCTime();
+    //a TDT/TOT/STT time in UTC seconds
     void setTime(long t);
+    //UTC seconds, system time until a table has been received
     long getTime();
-    long getDiffTime() {
-        return mDiff;
+    //UTC milliseconds
+    int64_t nowMs();
+    bool isSynced()
+    {
+        return mSynced;
     }
 
-    void setDiffTime(long diff) {
-        mDiff = diff;
-    }
+    long getDiffTime();
+    void setDiffTime(long diff);
 
 private:
-    long mDiff;
-    unsigned long mHZ;
+    struct Sample {
+        int64_t mono;
+        int64_t offset;
+    };
+
+    static int64_t monoNs();
+    int64_t estimateLocked(int64_t mono);
+    void resetLocked(int64_t mono, int64_t offset);
+    void publishLocked(int64_t mono, int64_t offset);
+
+    Mutex mLock;
+    Sample mSamples[SAMPLE_COUNT];
+    int mSampleCount;
+    int mSampleNext;
+    Sample mOutliers[STEP_SAMPLES];
+    int mOutlierCount;
+    int64_t mDriftMono;
+    int64_t mDriftOffset;
+    int mDriftPpb;
+
+    //seqlock protected, written under mLock
+    std::atomic<uint32_t> mSeq;
+    std::atomic<int64_t> mBaseMono;
+    std::atomic<int64_t> mBaseMs;
+    std::atomic<int> mPpb;
+    std::atomic<bool> mSynced;
 };
 #endif/*_C_TV_TIME_H_*/
-
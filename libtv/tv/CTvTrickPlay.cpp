@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvTrickPlay"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cutils/properties.h>
+#include "CTvTrickPlay.h"
+#include "CTvLog.h"
+
+#define TRICK_DEFAULT_SCHEDULE  "4:250,8:200,16:160,32:120,64:100"
+
+CTvTrickPlay::CTvTrickPlay(CAv *av)
+{
+    mpAv = av;
+    mpIndex = NULL;
+    mpObserver = NULL;
+    mActive = false;
+    mSpeed = 0;
+    mPosMs = 0;
+    mSavedAtvMute = 0;
+    mSavedDtvMute = 0;
+    mEnable = property_get_int32("vendor.tv.dtv.trick.enable", 1) != 0;
+    loadSchedule();
+}
+
+CTvTrickPlay::~CTvTrickPlay()
+{
+}
+
+void CTvTrickPlay::loadSchedule()
+{
+    char buf[PROPERTY_VALUE_MAX] = {0};
+    property_get("vendor.tv.dtv.trick.schedule", buf, TRICK_DEFAULT_SCHEDULE);
+
+    mScheduleCount = 0;
+    const char *p = buf;
+    while (*p && mScheduleCount < MAX_SCHEDULE) {
+        int speed, interval;
+        if (sscanf(p, "%d:%d", &speed, &interval) == 2 && speed > 0 && interval > 0) {
+            //kept sorted by speed
+            int i = mScheduleCount;
+            while (i > 0 && mSchedule[i - 1].speed > speed) {
+                mSchedule[i] = mSchedule[i - 1];
+                i--;
+            }
+            mSchedule[i].speed = speed;
+            mSchedule[i].intervalMs = interval;
+            mScheduleCount++;
+        }
+        p = strchr(p, ',');
+        if (!p)
+            break;
+        p++;
+    }
+    if (mScheduleCount == 0) {
+        LOGW("bad trick schedule \"%s\", use 250ms", buf);
+        mSchedule[0].speed = 1;
+        mSchedule[0].intervalMs = 250;
+        mScheduleCount = 1;
+    }
+}
+
+void CTvTrickPlay::setIndex(const CTsIndexer *index)
+{
+    AutoMutex _l(mLock);
+    mpIndex = index;
+}
+
+bool CTvTrickPlay::isTrickSpeed(int speed) const
+{
+    return mEnable && (speed > TRICK_MIN_SPEED || speed < -TRICK_MIN_SPEED);
+}
+
+int CTvTrickPlay::getInterval(int speed) const
+{
+    int s = abs(speed);
+    int interval = mSchedule[0].intervalMs;
+    for (int i = 0; i < mScheduleCount && mSchedule[i].speed <= s; i++) {
+        interval = mSchedule[i].intervalMs;
+    }
+    return interval;
+}
+
+int CTvTrickPlay::nextPosition(int curMs, int speed, int intervalMs, int startMs, int endMs) const
+{
+    int target = curMs + speed * intervalMs;
+    if (mpIndex != NULL) {
+        CTsIndexer::IndexEntry entry;
+        if (speed > 0) {
+            if (mpIndex->findKeyFrame(target, &entry) == 0 && entry.timeMs > curMs) {
+                target = entry.timeMs;
+            } else if (mpIndex->findNextKeyFrame(curMs, &entry) == 0) {
+                //gop longer than the step, show the next key frame anyway
+                target = entry.timeMs;
+            }
+        } else if (mpIndex->findKeyFrame(target, &entry) == 0) {
+            target = entry.timeMs;
+        }
+    }
+
+    if (speed > 0 && endMs > startMs && target >= endMs - LIVE_GUARD_MS) {
+        return -1;
+    }
+    if (speed < 0 && target <= startMs) {
+        return -1;
+    }
+    return target;
+}
+
+int CTvTrickPlay::startTrick(int speed)
+{
+    {
+        AutoMutex _l(mLock);
+        if (mActive) {
+            LOGD("%s, speed %d -> %d", __FUNCTION__, mSpeed, speed);
+            mSpeed = speed;
+            mCond.signal();
+            return 0;
+        }
+    }
+    //reap a trick play which ended by itself at the start or the live end
+    join();
+
+    {
+        AutoMutex _l(mLock);
+        int cur = 0;
+        if (mpAv->getTimeShiftTime(&cur, NULL, NULL) != 0) {
+            return -1;
+        }
+        if (mpIndex != NULL && cur > mpIndex->getDurationMs()) {
+            cur = mpIndex->getDurationMs();
+        }
+        mpAv->AudioGetMute(&mSavedAtvMute, &mSavedDtvMute);
+        mpAv->AudioSetMute(mSavedAtvMute, 1);
+        mpAv->pauseTimeShift();
+        mPosMs = cur;
+        mSpeed = speed;
+        mActive = true;
+        LOGD("%s, speed %d from %d ms, %s", __FUNCTION__, speed, cur, mpIndex ? "indexed" : "no index");
+    }
+
+    if (run("CTvTrickPlay") != NO_ERROR) {
+        AutoMutex _l(mLock);
+        leaveLocked(mPosMs);
+        return -1;
+    }
+    return 0;
+}
+
+int CTvTrickPlay::stopTrick()
+{
+    int pos;
+    {
+        AutoMutex _l(mLock);
+        if (!mActive) {
+            return -1;
+        }
+        pos = mPosMs;
+        leaveLocked(pos);
+        requestExit();
+        mCond.signal();
+    }
+    join();
+    return pos;
+}
+
+bool CTvTrickPlay::isTricking()
+{
+    AutoMutex _l(mLock);
+    return mActive;
+}
+
+//one clock per mode: the steps of an indexed recording are index times, so are
+//its bounds. The timeshift buffer has no index and moves with the player.
+void CTvTrickPlay::getBoundsLocked(int *startMs, int *endMs)
+{
+    if (mpIndex != NULL) {
+        *startMs = 0;
+        *endMs = mpIndex->getDurationMs();
+        return;
+    }
+    mpAv->getTimeShiftTime(NULL, startMs, endMs);
+}
+
+void CTvTrickPlay::leaveLocked(int posMs)
+{
+    LOGD("%s, resume at %d ms", __FUNCTION__, posMs);
+    mActive = false;
+    mpAv->seekTimeShift(posMs, true);
+    mpAv->resumeTimeShift();
+    mpAv->AudioSetMute(mSavedAtvMute, mSavedDtvMute);
+}
+
+bool CTvTrickPlay::threadLoop()
+{
+    mLock.lock();
+    while (mActive && !exitPending()) {
+        int interval = getInterval(mSpeed);
+        mCond.waitRelative(mLock, (nsecs_t)interval * 1000000LL);
+        if (!mActive || exitPending()) {
+            break;
+        }
+
+        int start = 0, end = 0;
+        getBoundsLocked(&start, &end);
+        int next = nextPosition(mPosMs, mSpeed, interval, start, end);
+        if (next < 0) {
+            //rewound to the start or caught up with live, play on from there
+            leaveLocked(mSpeed > 0 ? (end > start ? end - LIVE_GUARD_MS : mPosMs) : start);
+            break;
+        }
+        //stay paused, only leaveLocked starts the playback again
+        if (mpAv->seekTimeShift(next, false) != 0) {
+            LOGE("%s, seek to %d ms failed, stop at %d ms", __FUNCTION__, next, mPosMs);
+            leaveLocked(mPosMs);
+            break;
+        }
+        mPosMs = next;
+        if (mpObserver != NULL) {
+            mLock.unlock();
+            mpObserver->onTrickPosition(next);
+            mLock.lock();
+        }
+    }
+    mLock.unlock();
+    return false;
+}
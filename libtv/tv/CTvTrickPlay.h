@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVTRICKPLAY_H_)
+#define _CTVTRICKPLAY_H_
+
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
+#include "CAv.h"
+#include "CTsIndexer.h"
+
+using namespace android;
+
+//fast forward/rewind above TRICK_MIN_SPEED by showing single key frames:
+//the playback is paused and muted, and every step interval it is seeked
+//speed * interval further, snapped to a key frame when an index is known.
+//The step interval per speed comes from vendor.tv.dtv.trick.schedule,
+//"speed:ms,speed:ms,...".
+class CTvTrickPlay : public Thread {
+public:
+    //speeds up to this are left to the player, which decodes every frame
+    static const int TRICK_MIN_SPEED = 2;
+    static const int MAX_SCHEDULE = 8;
+    //do not step closer than this to the live end
+    static const int LIVE_GUARD_MS = 1000;
+
+    class IObserver {
+    public:
+        IObserver() {};
+        virtual ~IObserver() {};
+        virtual void onTrickPosition(int timeMs) = 0;
+    };
+
+    CTvTrickPlay(CAv *av);
+    ~CTvTrickPlay();
+
+    void setObserver(IObserver *ob)
+    {
+        mpObserver = ob;
+    }
+    //key frame index of the file played, NULL to step by time only
+    void setIndex(const CTsIndexer *index);
+    bool isTrickSpeed(int speed) const;
+    //start or change the speed of a running trick play
+    int startTrick(int speed);
+    //back to normal play at the position reached, return it or -1 if not running
+    int stopTrick();
+    bool isTricking();
+
+    int getInterval(int speed) const;
+    //next position to show, -1 when the start or the live end is reached
+    int nextPosition(int curMs, int speed, int intervalMs, int startMs, int endMs) const;
+
+private:
+    struct ScheduleEntry {
+        int speed;
+        int intervalMs;
+    };
+
+    bool threadLoop();
+    void loadSchedule();
+    void getBoundsLocked(int *startMs, int *endMs);
+    void leaveLocked(int posMs);
+
+    CAv *mpAv;
+    const CTsIndexer *mpIndex;
+    IObserver *mpObserver;
+    ScheduleEntry mSchedule[MAX_SCHEDULE];
+    int mScheduleCount;
+    bool mEnable;
+    bool mActive;
+    int mSpeed;
+    int mPosMs;
+    unsigned int mSavedAtvMute;
+    unsigned int mSavedDtvMute;
+    mutable Mutex mLock;
+    Condition mCond;
+};
+
+#endif //_CTVTRICKPLAY_H_
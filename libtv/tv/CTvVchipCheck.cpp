@@ -15,6 +15,16 @@ CTvVchipCheck:: CTvVchipCheck()
 {
     m_request_pause_detect = false;
     mDetectState = 0;
+    mLockGeneration = 0;
+    mLockBitsValid = false;
+    mpObserver = NULL;
+    mpTime = NULL;
+    mProgId = -1;
+    mBlocked = false;
+    mNeedCheck = false;
+    mNextCheck = 0;
+    mUnlockUntil = -1;
+    mWakeCount = 0;
 }
 
 CTvVchipCheck:: ~CTvVchipCheck()
@@ -22,12 +32,20 @@ CTvVchipCheck:: ~CTvVchipCheck()
 }
 
 bool CTvVchipCheck::CheckProgramBlock(int id)
+{
+    return CheckProgramBlock(id, (mpTime != NULL) ? mpTime->getTime() : 0, NULL);
+}
+
+bool CTvVchipCheck::CheckProgramBlock(int id, long now, long *nextCheck)
 {
     bool lock = false;
     CTvProgram prog;
     CTvEvent ev;
     int ret = 0;
 
+    if (nextCheck != NULL)
+        *nextCheck = 0;
+
     ret = CTvProgram::selectByID(id, prog);
     if (ret != 0) return false;
 
@@ -35,36 +53,118 @@ bool CTvVchipCheck::CheckProgramBlock(int id)
 
     if (type == CTvProgram::TYPE_ATV) {
         ret = ev.getATVProgEvent(prog.getSrc(), prog.getID(), ev);
-    } else {
-        //long epgtime = mDmTime.getTime();
-        //ret = ev.getProgPresentEvent(prog.getSrc(),prog.getSourceId(), epgtime, ev);
-    }
-    if (ret == 0) {
         if (prog.isATSCMode()) {
             // ATSC V-Chip
-            Vector<CTvDimension::VChipRating *> definedRatings = ev.getVChipRatings();
-            for (int i = 0; i < (int)definedRatings.size(); i++) {
-                CTvDimension dm;
-                if (dm.isBlocked(dm, definedRatings[i])) {
-                    lock = true;
-                    {
-                        /*CurvchipDimension = dm.getName();
-                        CurvchipAbbrev = dm.getAbbrev(definedRatings[i]->getValue());
-                        CurvchipText= dm.getText(definedRatings[i]->getValue());
-                        LOGD("%s, %d Dimension:%s, Abbrev: %s, idx:%d","TV",__LINE__,CurvchipDimension.string(),
-                            CurvchipAbbrev.string(),definedRatings[i]->getValue());*/
+            if (ret == 0)
+                lock = isRatingBlocked(ev.getVChipRatings());
+            if (nextCheck != NULL)
+                *nextCheck = now + ATV_CHECK_INTERVAL;
+        }
+    } else {
+        //the present event and the boundary where it ends or the next one starts
+        Vector<sp<CTvEvent> > events;
+        int srcId = prog.isATSCMode() ? prog.getSourceId() : prog.getID();
+        if (ev.getProgScheduleEvents(prog.getSrc(), srcId, now, 24 * 3600, events) == 0) {
+            ret = -1;
+            for (size_t i = 0; i < events.size(); i++) {
+                if (events[i]->getStartTime() <= now && events[i]->getEndTime() > now) {
+                    if (prog.isATSCMode()) {
+                        lock = isRatingBlocked(events[i]->getVChipRatings());
                     }
+                    if (nextCheck != NULL)
+                        *nextCheck = events[i]->getEndTime();
+                    ret = 0;
+                    break;
+                } else if (events[i]->getStartTime() > now) {
+                    if (nextCheck != NULL)
+                        *nextCheck = events[i]->getStartTime();
                     break;
                 }
             }
+        } else {
+            ret = -1;
         }
-    } else {
+    }
+    if (ret != 0) {
         LOGD("Present event of playing program not received yet, will unblock this program.");
     }
 
     return lock;
 }
 
+void CTvVchipCheck::loadLockBitsLocked()
+{
+    //read the generation first, a change while loading reloads next time
+    mLockGeneration = CTvDimension::getGeneration();
+    mLockBits.clear();
+
+    CTvDatabase::Cursor c;
+    CTvDatabase::GetTvDb()->select("select * from dimension_table", c);
+    if (c.moveToFirst()) {
+        int regionCol = c.getColumnIndex("rating_region");
+        int indexCol = c.getColumnIndex("index_j");
+        int valuesCol = c.getColumnIndex("values_defined");
+        int lockedCols[MAX_RATING_DIMENSION];
+        char name[16];
+        for (int i = 0; i < MAX_RATING_DIMENSION; i++) {
+            snprintf(name, sizeof(name), "locked%d", i);
+            lockedCols[i] = c.getColumnIndex(name);
+        }
+        do {
+            int region = c.getInt(regionCol);
+            int index = c.getInt(indexCol);
+            int values = c.getInt(valuesCol);
+            if (region < 0 || region >= MAX_RATING_REGION || index < 0 || index >= MAX_RATING_DIMENSION) {
+                LOGE("dimension %d/%d out of range, its locks are ignored", region, index);
+                continue;
+            }
+            uint16_t bits = 0;
+            for (int i = 0; i < values && i < MAX_RATING_DIMENSION; i++) {
+                if (lockedCols[i] >= 0 && c.getInt(lockedCols[i]) == 1)
+                    bits |= (1 << i);
+            }
+            if ((size_t)(region + 1) * MAX_RATING_DIMENSION > mLockBits.size()) {
+                mLockBits.resize((region + 1) * MAX_RATING_DIMENSION, 0);
+            }
+            mLockBits[region * MAX_RATING_DIMENSION + index] = bits;
+        } while (c.moveToNext());
+    }
+    c.close();
+    mLockBitsValid = true;
+    LOGD("rating locks loaded, generation %d", mLockGeneration);
+}
+
+bool CTvVchipCheck::isRatingBlocked(const Vector<CTvDimension::VChipRating *> &ratings)
+{
+    AutoMutex _l(mRatingLock);
+    if (!mLockBitsValid || mLockGeneration != CTvDimension::getGeneration()) {
+        loadLockBitsLocked();
+    }
+
+    for (size_t i = 0; i < ratings.size(); i++) {
+        CTvDimension::VChipRating *rating = ratings[i];
+        if (rating == NULL)
+            continue;
+        int region = rating->getRegion();
+        int index = rating->getDimension();
+        int value = rating->getValue();
+        if (region < 0 || index < 0 || index >= MAX_RATING_DIMENSION
+                || value < 0 || value >= MAX_RATING_DIMENSION) {
+            continue;
+        }
+        //no dimension of the region, nothing of it locked
+        size_t slot = (size_t)region * MAX_RATING_DIMENSION + index;
+        if (slot >= mLockBits.size()) {
+            continue;
+        }
+        if (mLockBits[slot] & (1 << value)) {
+            LOGD("rating %d/%d/%d blocked", region, index, value);
+            return true;
+        }
+    }
+    return false;
+}
+
 void *CTvVchipCheck::VchipCheckingThread (void *arg __unused)
 {
     /*CTv *pt = static_cast<CTv *> ( arg );
@@ -115,11 +215,18 @@ void *CTvVchipCheck::VchipCheckingThread (void *arg __unused)
     return NULL;
 }
 
+int CTvVchipCheck::startVChipCheck()
+{
+    LOGD ( "startVChipCheck()" );
+    return run("CTvVchipCheck");
+}
+
 int CTvVchipCheck::stopVChipCheck()
 {
     AutoMutex _l( mLock );
     LOGD ( "stopVChipCheck() and exit thread" );
     requestExit();
+    mCheckCondition.signal();
     return 0;
 }
 
@@ -128,6 +235,7 @@ int CTvVchipCheck::pauseVChipCheck()
     AutoMutex _l( mLock );
     LOGD ( "pauseVChipCheck() set request pause flag, when flag true, thread loop go pause on condition" );
     m_request_pause_detect = true;
+    mCheckCondition.signal();
     return 0;
 }
 
@@ -136,6 +244,7 @@ int CTvVchipCheck::requestAndWaitPauseVChipCheck()
     AutoMutex _l( mLock );
     LOGD ( "requestAndWaitPauseVChipCheck(),first set pause flag to true, and wait when loop run to pause code segment" );
     m_request_pause_detect = true;
+    mCheckCondition.signal();
 
     if ( mDetectState == STATE_RUNNING ) {
         mRequestPauseCondition.wait ( mLock );
@@ -149,29 +258,116 @@ int CTvVchipCheck::resumeVChipCheck()
     AutoMutex _l( mLock );
     LOGD ( "resumeVChipCheck() first set flag false, and signal to paused condition, let run loop" );
     m_request_pause_detect = false;
+    mNeedCheck = true;
     mDetectPauseCondition.signal();
     return 0;
 }
 
+void CTvVchipCheck::setProgram(int progId)
+{
+    AutoMutex _l( mLock );
+    if (progId == mProgId)
+        return;
+    mProgId = progId;
+    mUnlockUntil = -1;
+    mNextCheck = 0;
+    mNeedCheck = true;
+    mCheckCondition.signal();
+}
+
+void CTvVchipCheck::onEventsUpdated(int progId)
+{
+    AutoMutex _l( mLock );
+    if (progId != mProgId)
+        return;
+    mNeedCheck = true;
+    mCheckCondition.signal();
+}
+
+void CTvVchipCheck::requestCheck()
+{
+    AutoMutex _l( mLock );
+    mNeedCheck = true;
+    mCheckCondition.signal();
+}
+
+void CTvVchipCheck::unlockProgram(int seconds)
+{
+    AutoMutex _l( mLock );
+    long now = (mpTime != NULL) ? mpTime->getTime() : 0;
+    mUnlockUntil = (seconds > 0) ? now + seconds : 0;
+    mNeedCheck = true;
+    mCheckCondition.signal();
+}
+
+int CTvVchipCheck::getWakeCount()
+{
+    AutoMutex _l( mLock );
+    return mWakeCount;
+}
+
 bool  CTvVchipCheck::threadLoop()
 {
+    mLock.lock();
+    mDetectState = STATE_RUNNING;
     while ( !exitPending() ) { //requietexit() or requietexitWait() not call
-        while ( m_request_pause_detect ) {
+        if ( m_request_pause_detect ) {
             mRequestPauseCondition.broadcast();
-            mLock.lock();
             mDetectState = STATE_PAUSE;
-            mDetectPauseCondition.wait ( mLock ); //first unlock,when return,lock again,so need,call unlock
+            mDetectPauseCondition.wait ( mLock );
             mDetectState = STATE_RUNNING;
-            mLock.unlock();
+            continue;
         }
-        //loop codes
 
-        if ( !m_request_pause_detect ) { //not request pause, sleep 1s which loop
-            usleep ( 1000 * 1000 );
+        long now = (mpTime != NULL) ? mpTime->getTime() : 0;
+        if (mNextCheck > 0 && now >= mNextCheck)
+            mNeedCheck = true;
+
+        if (mNeedCheck) {
+            mNeedCheck = false;
+            int progId = mProgId;
+            bool blocked = false;
+            long nextCheck = 0;
+            if (progId >= 0) {
+                //the database is read without the lock
+                mLock.unlock();
+                blocked = CheckProgramBlock(progId, now, &nextCheck);
+                mLock.lock();
+                if (progId != mProgId)
+                    continue;
+            }
+
+            if (mUnlockUntil > 0 && now >= mUnlockUntil)
+                mUnlockUntil = -1;
+            if (mUnlockUntil >= 0) {
+                blocked = false;
+                if (mUnlockUntil > 0 && (nextCheck == 0 || mUnlockUntil < nextCheck))
+                    nextCheck = mUnlockUntil;
+            }
+            mNextCheck = nextCheck;
+            LOGD("program %d %s, next check at %ld (now %ld)", progId, blocked ? "blocked" : "unblocked",
+                 nextCheck, now);
+
+            if (blocked != mBlocked) {
+                mBlocked = blocked;
+                if (mpObserver != NULL) {
+                    mLock.unlock();
+                    mpObserver->onVchipBlock(progId, blocked);
+                    mLock.lock();
+                }
+            }
+            continue;
+        }
+
+        //nothing to do before the next boundary or a change
+        if (mNextCheck > 0) {
+            mCheckCondition.waitRelative(mLock, (nsecs_t)(mNextCheck - now) * 1000000000LL);
+        } else {
+            mCheckCondition.wait(mLock);
         }
+        mWakeCount++;
     }
     //exit
-    mLock.lock();
     mDetectState = STATE_STOPED;
     mLock.unlock();
     //return true, run again, return false,not run.
@@ -19,12 +19,45 @@
 #include "CTvEvent.h"
 #include "CTvLog.h"
 #include <utils/Thread.h>
+#include <vector>
 // TV ATSC rating dimension
+//the checker thread sleeps until the present event of the program ends or
+//the next one starts, and is woken early by setProgram, onEventsUpdated,
+//requestCheck and unlockProgram
 class CTvVchipCheck: public Thread {
 public:
+    class IObserver {
+    public:
+        IObserver() {};
+        virtual ~IObserver() {};
+        virtual void onVchipBlock(int progId, bool blocked) = 0;
+    };
+
     CTvVchipCheck();
     ~CTvVchipCheck();
+    void setObserver(IObserver *ob)
+    {
+        mpObserver = ob;
+    }
+    //stream time in seconds
+    void setTime(CTvTime *time)
+    {
+        mpTime = time;
+    }
     bool CheckProgramBlock(int id);
+    //nextCheck: when the block state may change by itself (event boundary), 0 if unknown
+    bool CheckProgramBlock(int id, long now, long *nextCheck);
+    //program played, -1 for none
+    void setProgram(int progId);
+    //evt_table changed for progId
+    void onEventsUpdated(int progId);
+    //locks, RRT or the time changed
+    void requestCheck();
+    //PIN entered: unblock for seconds, 0 until the program changes
+    void unlockProgram(int seconds);
+    int getWakeCount();
+    //true if any of the ratings is locked, no sql unless dimension_table changed
+    bool isRatingBlocked(const Vector<CTvDimension::VChipRating *> &ratings);
     static void *VchipCheckingThread ( void *arg );
     int startVChipCheck();
     int stopVChipCheck();
@@ -32,7 +65,33 @@ public:
     int resumeVChipCheck();
     int requestAndWaitPauseVChipCheck();
 private:
+    //xds ratings of analog programs have no schedule, they are polled this often, in seconds
+    static const int ATV_CHECK_INTERVAL = 5;
+    //rating_region is 8 bits in the RRT
+    static const int MAX_RATING_REGION = 256;
+    static const int MAX_RATING_DIMENSION = 16;
+
     bool  threadLoop();
+    void loadLockBitsLocked();
+
+    IObserver *mpObserver;
+    CTvTime *mpTime;
+    int mProgId;
+    bool mBlocked;
+    bool mNeedCheck;
+    //stream time of the next re-evaluation, 0 for none
+    long mNextCheck;
+    //-1 locked, 0 unlocked until the program changes, else unlocked until then
+    long mUnlockUntil;
+    int mWakeCount;
+    Condition mCheckCondition;
+
+    //bit n set: value n of the dimension is locked, MAX_RATING_DIMENSION per
+    //region up to the highest region of dimension_table
+    std::vector<uint16_t> mLockBits;
+    int mLockGeneration;
+    bool mLockBitsValid;
+    mutable Mutex mRatingLock;
     mutable Mutex mLock;
     Condition mDetectPauseCondition;
     Condition mRequestPauseCondition;
@@ -13,8 +13,14 @@
 #pragma clang diagnostic ignored "-Wundefined-bool-conversion"
 
 #include <assert.h>
+#include <time.h>
+#include <stdio.h>
 #include <tinyxml2.h>
 #include "CTvDatabase.h"
+#include "CTvDimension.h"
+#include "CTvBookingScheduler.h"
+#include "CTvRegion.h"
+#include "CTvXmlPullParser.h"
 #include <tvutils.h>
 #include <tvconfig.h>
 
@@ -45,6 +51,11 @@ const char CTvDatabase::ofdmModes[][32] = {"dvbt", "dvbt2"};
 const char CTvDatabase::atvVideoStds[][32] = {"auto", "pal", "ntsc", "secam"};
 const char CTvDatabase::atvAudioStds[][32] = {"dk", "i", "bg", "m", "l", "auto"};
 
+const CStringTable CTvDatabase::feTypeTable(CTvDatabase::feTypes);
+const CStringTable CTvDatabase::modTable(CTvDatabase::mods);
+const CStringTable CTvDatabase::bandwidthTable(CTvDatabase::bandwidths);
+const CStringTable CTvDatabase::ofdmModeTable(CTvDatabase::ofdmModes);
+
 CTvDatabase::CTvDatabase()
 {
     /*int kernelVersion = getKernelMajorVersion();
@@ -54,6 +65,8 @@ CTvDatabase::CTvDatabase()
         strcpy(defaultDbXmlPath, CTV_DATABASE_DEFAULT_XML_0);
     }*/
     strcpy(defaultDbXmlPath, CTV_DATABASE_DEFAULT_XML_1);
+    mCompactJobs = 0;
+    mCompactExit = false;
 }
 
 int CTvDatabase::isFreqListExist()
@@ -71,6 +84,7 @@ int CTvDatabase::isFreqListExist()
 int CTvDatabase::UnInitTvDb()
 {
 #ifdef SUPPORT_ADTV
+    stopCompact();
     AM_DB_UnSetup();
     closeDb();
 #endif
@@ -89,10 +103,9 @@ int CTvDatabase::InitTvDb(const char *path)
             }
             //setup and path set
             AM_DB_Setup((char *)path, getHandle());
-            if (isFreqListExist() == false) {
-                importXmlToDB(defaultDbXmlPath);
-                LOGD("scan region table is NULL, so import freq XML again\n");
-            }
+            CTvRegion::invalidate();
+            //again when the table is empty or the xml changed
+            importXmlToDB(defaultDbXmlPath, false);
         } else {
             if (isFileExist(path)) { // if just exist, create flag not set, delete it
                 LOGD("tv db file (%s) exist, but delete it", path);
@@ -124,6 +137,7 @@ int CTvDatabase::InitTvDb(const char *path)
 CTvDatabase::~CTvDatabase()
 {
 #ifdef SUPPORT_ADTV
+    stopCompact();
     AM_DB_UnSetup();
 #endif
 }
@@ -152,40 +166,275 @@ int CTvDatabase::getChannelParaList(char *path, Vector<sp<ChannelPara> > &vcp)
 int CTvDatabase::ClearDbTable()
 {
     LOGD("Clearing database ...");
-#ifdef SUPPORT_ADTV
-    exeSql("delete from net_table");
-    exeSql("delete from ts_table");
-    exeSql("delete from srv_table");
-    exeSql("delete from evt_table");
-    exeSql("delete from booking_table");
-    exeSql("delete from grp_table");
-    exeSql("delete from grp_map_table");
-    exeSql("delete from dimension_table");
-    exeSql("delete from sat_para_table");
-    exeSql("delete from region_table");
-#endif
-    return 0;
+    return resetTables(RESET_ALL);
 }
 
 int CTvDatabase::clearDbAllProgramInfoTable()
 {
     LOGD("Clearing clearDbAllProgramInfoTable ...");
+    return resetTables(RESET_SCAN | RESET_EPG | RESET_BOOKING | RESET_USER, RESET_COMPACT);
+}
+
+#ifdef SUPPORT_ADTV
+static const struct {
+    int group;
+    const char *table;
+} resetGroupTables[] = {
+    {CTvDatabase::RESET_SCAN, "net_table"},
+    {CTvDatabase::RESET_SCAN, "ts_table"},
+    {CTvDatabase::RESET_SCAN, "srv_table"},
+    {CTvDatabase::RESET_SCAN, "sat_para_table"},
+    {CTvDatabase::RESET_SCAN, "dimension_table"},
+    {CTvDatabase::RESET_EPG, "evt_table"},
+    {CTvDatabase::RESET_BOOKING, "booking_table"},
+    {CTvDatabase::RESET_USER, "grp_table"},
+    {CTvDatabase::RESET_USER, "grp_map_table"},
+    {CTvDatabase::RESET_REGION, "region_table"},
+};
+
+//a row holding the db_id of a cleared table goes with it. db_evt_id is left
+//out, a booking keeps its own copy of the event
+static const struct {
+    const char *column;
+    const char *table;
+} resetRefs[] = {
+    {"db_net_id", "net_table"},
+    {"db_ts_id", "ts_table"},
+    {"db_srv_id", "srv_table"},
+    {"db_sat_para_id", "sat_para_table"},
+};
+
+static bool containsTable(const Vector<String8> &tables, const char *name)
+{
+    for (size_t i = 0; i < tables.size(); i++) {
+        if (strcmp(tables[i].string(), name) == 0)
+            return true;
+    }
+    return false;
+}
+
+static int getPragmaInt(sqlite3 *h, const char *sql)
+{
+    int value = -1;
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v2(h, sql, -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+#endif
+
+//tables of the groups that exist, with the ones referring to them
+int CTvDatabase::getResetTables(int groups, Vector<String8> &tables)
+{
+#ifdef SUPPORT_ADTV
+    struct TableRefs {
+        String8 name;
+        int refs;
+    };
+    Vector<TableRefs> all;
+    Cursor c;
+    select("select name from sqlite_master where type = 'table' and name not like 'sqlite_%'", c);
+    if (c.moveToFirst()) {
+        do {
+            TableRefs t;
+            t.name = c.getString(0);
+            t.refs = 0;
+            all.push_back(t);
+        } while (c.moveToNext());
+    }
+    c.close();
+
+    for (size_t i = 0; i < all.size(); i++) {
+        TableRefs &t = all.editItemAt(i);
+        select(String8::format("select name from pragma_table_info('%s')", t.name.string()), c);
+        if (c.moveToFirst()) {
+            do {
+                String8 column = c.getString(0);
+                for (size_t j = 0; j < sizeof(resetRefs) / sizeof(resetRefs[0]); j++) {
+                    if (strcmp(column.string(), resetRefs[j].column) == 0)
+                        t.refs |= 1 << j;
+                }
+            } while (c.moveToNext());
+        }
+        c.close();
+        for (size_t j = 0; j < sizeof(resetGroupTables) / sizeof(resetGroupTables[0]); j++) {
+            if ((groups & resetGroupTables[j].group) && strcmp(t.name.string(), resetGroupTables[j].table) == 0) {
+                tables.push_back(t.name);
+                break;
+            }
+        }
+    }
+
+    bool added = true;
+    while (added) {
+        added = false;
+        for (size_t i = 0; i < all.size(); i++) {
+            if (containsTable(tables, all[i].name.string()))
+                continue;
+            for (size_t j = 0; j < sizeof(resetRefs) / sizeof(resetRefs[0]); j++) {
+                if ((all[i].refs & (1 << j)) && containsTable(tables, resetRefs[j].table)) {
+                    tables.push_back(all[i].name);
+                    added = true;
+                    break;
+                }
+            }
+        }
+    }
+    return tables.size();
+#else
+    return -1;
+#endif
+}
+
+int CTvDatabase::resetTables(int groups, int flags)
+{
 #ifdef SUPPORT_ADTV
-    exeSql("delete from net_table");
-    exeSql("delete from ts_table");
-    exeSql("delete from srv_table");
-    exeSql("delete from evt_table");
-    exeSql("delete from booking_table");
-    exeSql("delete from grp_table");
-    exeSql("delete from grp_map_table");
-    exeSql("delete from dimension_table");
-    exeSql("delete from sat_para_table");
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Vector<String8> tables;
+    getResetTables(groups, tables);
+
+    beginTransaction();//-----------------------------------------------
+    for (size_t i = 0; i < tables.size(); i++) {
+        if (!exeSql(String8::format("delete from %s", tables[i].string()))) {
+            LOGE("%s, clear %s failed(%s)", __FUNCTION__, tables[i].string(), sqlite3_errmsg(getHandle()));
+            rollbackTransaction();
+            return -1;
+        }
+    }
+    commitTransaction();//------------------------------------------------------
+
+    //after the commit, the caches reload from the cleared tables
+    if (containsTable(tables, "booking_table"))
+        CTvBookingScheduler::invalidate();
+    if (containsTable(tables, "dimension_table"))
+        CTvDimension::invalidate();
+    if (containsTable(tables, "region_table"))
+        CTvRegion::invalidate();
+    if (flags & RESET_COMPACT)
+        startCompact(COMPACT_VACUUM);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    LOGD("%s, %zu tables cleared in %lld ms", __FUNCTION__, tables.size(),
+         (long long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
 #endif
     return 0;
 }
 
+void CTvDatabase::analyzeTables()
+{
+    startCompact(COMPACT_ANALYZE);
+}
+
+void CTvDatabase::startCompact(int jobs)
+{
+#ifdef SUPPORT_ADTV
+    const char *path = sqlite3_db_filename(getHandle(), "main");
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    AutoMutex _l(mCompactLock);
+    if (mCompactExit)
+        return;
+    mCompactPath = String8(path);
+    mCompactJobs |= jobs;
+    if (mCompactor == NULL) {
+        mCompactor = new Compactor(this);
+        mCompactor->run("CTvDbCompactor");
+    }
+#endif
+}
+
+void CTvDatabase::stopCompact()
+{
+    sp<Compactor> compactor;
+    {
+        AutoMutex _l(mCompactLock);
+        mCompactExit = true;
+        compactor = mCompactor;
+    }
+    if (compactor != NULL)
+        compactor->join();
+    AutoMutex _l(mCompactLock);
+    mCompactExit = false;
+}
+
+//small steps on a connection of its own, the writes of the other connections
+//get the db between them
+bool CTvDatabase::compactLoop()
+{
+#ifdef SUPPORT_ADTV
+    int jobs;
+    String8 path;
+    {
+        AutoMutex _l(mCompactLock);
+        if (mCompactJobs == 0 || mCompactExit) {
+            mCompactor.clear();
+            return false;
+        }
+        jobs = mCompactJobs;
+        mCompactJobs = 0;
+        path = mCompactPath;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sqlite3 *h = NULL;
+    if (sqlite3_open_v2(path.string(), &h, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        LOGE("%s, open %s failed", __FUNCTION__, path.string());
+        sqlite3_close(h);
+        return true;
+    }
+    sqlite3_busy_timeout(h, SQLITE_BUSY_TIMEOUT_MS);
+    sqlite3_exec(h, "pragma synchronous=NORMAL;", NULL, NULL, NULL);
+
+    int freed = 0;
+    if (jobs & COMPACT_VACUUM) {
+        freed = getPragmaInt(h, "pragma freelist_count");
+        if (getPragmaInt(h, "pragma auto_vacuum") == 0) {
+            //once, right after a reset the vacuum has few rows to copy
+            if (sqlite3_exec(h, "pragma auto_vacuum=incremental;vacuum;", NULL, NULL, NULL) != SQLITE_OK)
+                LOGE("%s, vacuum failed(%s)", __FUNCTION__, sqlite3_errmsg(h));
+        } else {
+            String8 sql = String8::format("pragma incremental_vacuum(%d);", CTV_DATABASE_VACUUM_PAGES);
+            int left;
+            while ((left = getPragmaInt(h, "pragma freelist_count")) > 0) {
+                {
+                    AutoMutex _l(mCompactLock);
+                    if (mCompactExit)
+                        break;
+                }
+                if (sqlite3_exec(h, sql.string(), NULL, NULL, NULL) != SQLITE_OK
+                    || getPragmaInt(h, "pragma freelist_count") >= left) {
+                    LOGE("%s, incremental vacuum stuck(%s)", __FUNCTION__, sqlite3_errmsg(h));
+                    break;
+                }
+                usleep(CTV_DATABASE_COMPACT_PAUSE_MS * 1000);
+            }
+        }
+        freed -= getPragmaInt(h, "pragma freelist_count");
+    }
+
+    //stats of the tables as filled, the sampled rows keep it short on a big
+    //evt_table
+    if (jobs & COMPACT_ANALYZE) {
+        String8 sql = String8::format("pragma analysis_limit=%d;analyze;", CTV_DATABASE_ANALYSIS_LIMIT);
+        if (sqlite3_exec(h, sql.string(), NULL, NULL, NULL) != SQLITE_OK)
+            LOGE("%s, analyze failed(%s)", __FUNCTION__, sqlite3_errmsg(h));
+    }
+    sqlite3_close(h);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    LOGD("%s, jobs 0x%x, %d pages freed in %lld ms", __FUNCTION__, jobs, freed,
+         (long long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
+#endif
+    return true;
+}
+
 //showboz now just channellist
-int CTvDatabase::importXmlToDB(const char *xmlPath)
+int CTvDatabase::importXmlToDB(const char *xmlPath, bool force)
 {
 #ifdef SUPPORT_ADTV
     if ((xmlPath == NULL)
@@ -193,44 +442,95 @@ int CTvDatabase::importXmlToDB(const char *xmlPath)
         LOGD("%s don't exist.", xmlPath);
         return -1;
     }
-    //delete region table before importing xml
-    exeSql("delete from region_table");
 
-    XMLDocument myDocument;
-    myDocument.LoadFile(xmlPath);
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CTvXmlPullParser parser;
+    if (parser.open(xmlPath) != 0) {
+        return -1;
+    }
+
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)parser.getContentHash());
+    if (!force && isFreqListExist() && strcmp(config_get_str(CFG_SECTION_TV, CFG_TV_REGION_XML_HASH, ""), hash) == 0) {
+        LOGD("%s unchanged, skip import", xmlPath);
+        return 0;
+    }
+
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v2(getHandle(), "insert into region_table(name,fe_type,frequency,symbol_rate,modulation,"
+                           "bandwidth,ofdm_mode,logical_channel_num,display) values(?,?,?,?,?,?,?,?,?)",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        LOGE("%s, prepare failed(%s)", __FUNCTION__, sqlite3_errmsg(getHandle()));
+        return -1;
+    }
 
-    XMLElement *RootElement = myDocument.RootElement();
     beginTransaction();//-----------------------------------------------
+    //delete region table before importing xml
+    exeSql("delete from region_table");
+    int rows = 0, lists = 0;
+    int ret = 0;
+    bool inList = false;
+    std::string listName;
+    int listFeType = -1;
+    int type;
     //list-->entry
-    for (XMLElement *channel_list_element = RootElement->FirstChildElement("channel_list"); channel_list_element != NULL; channel_list_element = channel_list_element->NextSiblingElement("channel_list")) {
-        //LOGD("showboz-----channel_list =%d", channel_list_element);
-        const char *channel_name = channel_list_element->Attribute("name");
-        const char *channel_fe_type = channel_list_element->Attribute("fe_type");
-        //LOGD("showboz-----channel_list name = %s type=%s", channel_name, channel_fe_type);
-
-        for (XMLElement *channel_entry = channel_list_element->FirstChildElement("channel_entry") ; channel_entry != NULL; channel_entry = channel_entry->NextSiblingElement("channel_entry")) {
-            int freq = -1, symb = -1, channelNum = -1;
-            String8 cmd = String8("insert into region_table(name,fe_type,frequency,symbol_rate,modulation,bandwidth,ofdm_mode,logical_channel_num,display)");
-            cmd += String8("values(\'") + channel_name + String8("\',") + String8::format("%d", StringToIndex(feTypes, channel_fe_type)) + String8(",");
-            cmd += String8::format("%d", channel_entry->IntAttribute("frequency", freq)) + String8(",");
-            cmd += String8::format("%d", channel_entry->IntAttribute("symbol_rate", symb)) + String8(",");
-            //LOGD("showboz---------m=%s,b=%s,o=%s", channel_entry->Attribute("modulation"), channel_entry->Attribute("bandwidth"), channel_entry->Attribute("ofdm_mode"));
-            cmd += String8::format("%d", StringToIndex(mods, channel_entry->Attribute("modulation"))) + String8(",");
-            cmd += String8::format("%d", StringToIndex(bandwidths, channel_entry->Attribute("bandwidth"))) + String8(",");
-            cmd += String8::format("%d", StringToIndex(ofdmModes, channel_entry->Attribute("ofdm_mode"))) + String8(",");
-            cmd += String8::format("%d", channel_entry->IntAttribute("id", channelNum)) + String8(",");
-            const char *physical_channel_display = channel_entry->Attribute("display");
-            if (physical_channel_display) {
-                cmd += String8("\'") + physical_channel_display + String8("\')");
-            } else {
-                cmd += String8::format("\'%d\'", channelNum) + String8(")");
+    while ((type = parser.next()) > CTvXmlPullParser::XML_END_DOCUMENT) {
+        if (type == CTvXmlPullParser::XML_END_TAG) {
+            if (parser.getDepth() == 1)
+                inList = false;
+            continue;
+        }
+        if (parser.getDepth() == 2) {
+            inList = (strcmp(parser.getName(), "channel_list") == 0);
+            if (inList) {
+                const char *name = parser.getAttribute("name");
+                listName = (name != NULL) ? name : "";
+                listFeType = StringToIndex(feTypeTable, parser.getAttribute("fe_type"));
+                lists++;
             }
-            //LOGD("exeSql string = %s\n", cmd.string());
-            exeSql(cmd.string());
+            continue;
+        }
+        if (!inList || parser.getDepth() != 3 || strcmp(parser.getName(), "channel_entry") != 0)
+            continue;
+
+        //the display of an entry without one is "-1", as before
+        const char *display = parser.getAttribute("display");
+        sqlite3_bind_text(stmt, 1, listName.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, listFeType);
+        sqlite3_bind_int(stmt, 3, parser.getIntAttribute("frequency", -1));
+        sqlite3_bind_int(stmt, 4, parser.getIntAttribute("symbol_rate", -1));
+        sqlite3_bind_int(stmt, 5, StringToIndex(modTable, parser.getAttribute("modulation")));
+        sqlite3_bind_int(stmt, 6, StringToIndex(bandwidthTable, parser.getAttribute("bandwidth")));
+        sqlite3_bind_int(stmt, 7, StringToIndex(ofdmModeTable, parser.getAttribute("ofdm_mode")));
+        sqlite3_bind_int(stmt, 8, parser.getIntAttribute("id", -1));
+        sqlite3_bind_text(stmt, 9, (display != NULL) ? display : "-1", -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            LOGE("%s, insert failed(%s)", __FUNCTION__, sqlite3_errmsg(getHandle()));
+            ret = -1;
+            break;
         }
+        sqlite3_reset(stmt);
+        rows++;
+    }
+    sqlite3_finalize(stmt);
+    if (type == CTvXmlPullParser::XML_ERROR) {
+        LOGE("%s, %s is not valid xml", __FUNCTION__, xmlPath);
+        ret = -1;
     }
 
+    if (ret != 0) {
+        //keep the old lists
+        rollbackTransaction();
+        return ret;
+    }
     commitTransaction();//------------------------------------------------------
+    CTvRegion::invalidate();
+    config_set_str(CFG_SECTION_TV, CFG_TV_REGION_XML_HASH, hash);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    LOGD("%s, %d rows of %d lists from %s (%zu bytes) in %lld ms", __FUNCTION__, rows, lists, xmlPath,
+         parser.getSize(), (long long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
 #endif
     return 0;
 }
@@ -20,12 +20,20 @@
 #include <utils/Vector.h>
 #include <utils/RefBase.h>
 #include <CSqlite.h>
+#include <CStringTable.h>
 
 #include "CTvLog.h"
 
 
 #define CTV_DATABASE_DEFAULT_XML_0        "odm/etc/tvconfig/tv_default.xml"
 #define CTV_DATABASE_DEFAULT_XML_1        "/mnt/vendor/odm_ext/etc/tvconfig/tv_default.xml"
+//content hash of the last region xml imported
+#define CFG_TV_REGION_XML_HASH            "tv_region_xml_hash"
+//free pages given back per step of the background compaction
+#define CTV_DATABASE_VACUUM_PAGES         128
+#define CTV_DATABASE_COMPACT_PAUSE_MS     20
+//rows sampled per index by analyzeTables
+#define CTV_DATABASE_ANALYSIS_LIMIT       1000
 using namespace android;
 
 class CTvDatabase: public CSqlite {
@@ -33,6 +41,16 @@ public:
     static const int DB_VERSION = 8;
     static const char *DB_VERSION_FIELD;
 
+    //table groups of resetTables
+    static const int RESET_SCAN = 0x01;     //net, ts, srv, sat_para and dimension tables
+    static const int RESET_EPG = 0x02;      //evt_table
+    static const int RESET_BOOKING = 0x04;  //booking_table
+    static const int RESET_USER = 0x08;     //grp and grp_map tables
+    static const int RESET_REGION = 0x10;   //region_table
+    static const int RESET_ALL = 0x1f;
+    //flags of resetTables
+    static const int RESET_COMPACT = 0x01;
+
     static const char feTypes[][32];
     static const char srvTypes[][32];
     static const char vidFmts[][32];
@@ -48,15 +66,14 @@ public:
     static const char ofdmModes[][32];
     static const char atvVideoStds[][32];
     static const char atvAudioStds[][32];
-    template<typename T>
-    int StringToIndex(const T &t, const char *item)
+    //lookups of the names importXmlToDB reads
+    static const CStringTable feTypeTable;
+    static const CStringTable modTable;
+    static const CStringTable bandwidthTable;
+    static const CStringTable ofdmModeTable;
+    static int StringToIndex(const CStringTable &t, const char *item)
     {
-        if (item == NULL) return -1;
-        int size = sizeof(t) / sizeof(t[0]);
-        for (int i = 0; i < size; i++) {
-            if (strcmp(t[i], item) == 0) return i;
-        }
-        return -1;
+        return t.indexOf(item);
     }
 public:
     CTvDatabase();
@@ -80,15 +97,49 @@ public:
     static int getChannelParaList(char *path, Vector<sp<ChannelPara> > &vcp);
 
     int importDbToXml();
-    int importXmlToDB(const char *xmlPath);
+    //force false skips a file with the content of the last import
+    int importXmlToDB(const char *xmlPath, bool force = true);
     bool isAtv256ProgInsertForSkyworth();
     int insert256AtvProgForSkyworth();
     int ClearDbTable();
     int clearDbAllProgramInfoTable();
+    //clears the tables of the groups in one transaction, with the tables whose
+    //db_net_id, db_ts_id, db_srv_id or db_sat_para_id point into them.
+    //RESET_COMPACT frees the pages in the background
+    int resetTables(int groups, int flags = 0);
+    //planner stats refreshed in the background, once the tables are filled
+    void analyzeTables();
 private:
+    //jobs of the compactor
+    static const int COMPACT_VACUUM = 0x01;
+    static const int COMPACT_ANALYZE = 0x02;
+
+    class Compactor: public Thread {
+    public:
+        Compactor(CTvDatabase *owner)
+        {
+            mpOwner = owner;
+        }
+    private:
+        bool threadLoop()
+        {
+            return mpOwner->compactLoop();
+        }
+        CTvDatabase *mpOwner;
+    };
+
     static CTvDatabase *mpDb;
     int isFreqListExist(void);
+    int getResetTables(int groups, Vector<String8> &tables);
+    void startCompact(int jobs);
+    void stopCompact();
+    bool compactLoop();
     char defaultDbXmlPath[128];
+    sp<Compactor> mCompactor;
+    int mCompactJobs;
+    bool mCompactExit;
+    String8 mCompactPath;
+    Mutex mCompactLock;
 };
 
 #endif  //_CTVDATABASE_H
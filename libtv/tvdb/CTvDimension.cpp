@@ -23,6 +23,8 @@
  *TV ATSC rating dimension
  */
 
+std::atomic<int> CTvDimension::mGeneration(0);
+
 void CTvDimension::createFromCursor(CTvDatabase::Cursor &c)
 {
     int col;
@@ -387,6 +389,7 @@ void CTvDimension::setLockStatus(int valueIndex, int status)
         cmd += String8("=") + String8::format("%d", status) + String8(" where db_id = ") + String8::format("%d", id);
 
         CTvDatabase::GetTvDb()->exeSql(cmd.string());
+        invalidate();
     }
 }
 
@@ -487,6 +490,7 @@ void CTvDimension::insertNewDimension(const int region, String8 regionName, Stri
 
     cmd += String8(")");
     CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    invalidate();
 }
 /**
  * ??????Standard ATSC V-Chip Dimensions
@@ -494,6 +498,7 @@ void CTvDimension::insertNewDimension(const int region, String8 regionName, Stri
 void CTvDimension::builtinAtscDimensions()
 {
     CTvDatabase::GetTvDb()->exeSql("delete from dimension_table");
+    invalidate();
 
     /* Add U.S. Rating region 0x1 */
     const char *abbrev0[] = {"", "None", "TV-G", "TV-PG", "TV-14", "TV-MA"};
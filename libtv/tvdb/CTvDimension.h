@@ -16,6 +16,7 @@
 
 #include "CTvLog.h"
 
+#include <atomic>
 #include <vector>
 
 // TV ATSC rating dimension
@@ -75,6 +76,15 @@ public:
                                    int indexj, int *lock, const char **abbrev, const char **text, int size);
     static  void builtinAtscDimensions();
     static  int isDimensionTblExist();
+    //bumped on every change of dimension_table, lets lock caches reload
+    static int getGeneration()
+    {
+        return mGeneration;
+    }
+    static void invalidate()
+    {
+        mGeneration++;
+    }
     String8 getCurdimension();
     String8 getCurAbbr();
     String8 getCurText();
@@ -93,5 +103,6 @@ private:
     String8 CurvchipDimension;
     String8 CurvchipAbbrev;
     String8 CurvchipText;
+    static std::atomic<int> mGeneration;
 };
 #endif  //_CTVDIMENSION_H
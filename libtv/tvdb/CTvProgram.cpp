@@ -600,7 +600,7 @@ int CTvProgram::updateVolComp(int progID, int volValue)
     String8 cmd = String8("update srv_table set volume = ") + String8::format("%d", volValue) +
                   String8(" where srv_table.db_id = ") + String8::format("%d", progID);
     LOGD("%s, cmd = %s\n", "TV", cmd.string());
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 
     return 0;
 }
@@ -943,7 +943,7 @@ void CTvProgram::setCurrAudioTrackIndex(int programId, int audioIndex)
     cmd = String8("update srv_table set current_aud = ")
           + String8::format("%d", audioIndex) + String8(" where srv_table.db_id = ") + String8::format("%d", programId);
 
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 }
 
 void CTvProgram::setFavoriteFlag(int progId, bool bFavor)
@@ -953,7 +953,7 @@ void CTvProgram::setFavoriteFlag(int progId, bool bFavor)
     cmd = String8("update srv_table set favor = ")
           + String8::format("%d", bFavor ? 1 : 0) + String8(" where srv_table.db_id = ") + String8::format("%d", progId);
 
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 }
 
 void CTvProgram::setSkipFlag(int progId, bool bSkipFlag)
@@ -963,7 +963,7 @@ void CTvProgram::setSkipFlag(int progId, bool bSkipFlag)
     cmd = String8("update srv_table set skip = ") + String8::format("%d", bSkipFlag ? 1 : 0)
           + String8(" where srv_table.db_id = ") + String8::format("%d", progId);
 
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 }
 
 void CTvProgram::updateProgramName(int progId, String8 strName)
@@ -981,14 +981,12 @@ void CTvProgram::swapChanOrder(int ProgId1, int chanOrderNum1, int ProgId2, int
 {
     String8 cmd;
 
+    //one posted string, both rows commit in the same batch
     cmd = String8("update srv_table set chan_order = ") + String8::format("%d", chanOrderNum2)
-          + String8(" where db_id = ") + String8::format("%d", ProgId1);
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
-
-    String8 cmd2;
-    cmd2 = String8("update srv_table set chan_order = ") + String8::format("%d", chanOrderNum1)
-           + String8(" where db_id = ") + String8::format("%d", ProgId2);
-    CTvDatabase::GetTvDb()->exeSql(cmd2.string());
+          + String8(" where db_id = ") + String8::format("%d", ProgId1)
+          + String8("; update srv_table set chan_order = ") + String8::format("%d", chanOrderNum1)
+          + String8(" where db_id = ") + String8::format("%d", ProgId2);
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 }
 
 void CTvProgram::setLockFlag(int progId, bool bLockFlag)
@@ -998,7 +996,7 @@ void CTvProgram::setLockFlag(int progId, bool bLockFlag)
     cmd = String8("update srv_table set lock = ") + String8::format("%d", bLockFlag ? 1 : 0)
           + String8(" where srv_table.db_id = ") + String8::format("%d", progId);
 
-    CTvDatabase::GetTvDb()->exeSql(cmd.string());
+    CTvDatabase::GetTvDb()->postSql(cmd.string());
 }
 
 bool CTvProgram::getLockFlag()
@@ -13,8 +13,14 @@
 
 #include "CTvRegion.h"
 #include "CTvDatabase.h"
+#include <algorithm>
 
 char CTvRegion::stCountry[COUNTRY_NAME_LEN] = "US";
+std::atomic<int> CTvRegion::mGeneration(0);
+int CTvRegion::mLoadedGeneration = -1;
+std::vector<CTvRegion::RegionList> CTvRegion::mLists;
+Mutex CTvRegion::mCacheLock;
+
 CTvRegion::CTvRegion(CTvDatabase db __unused)
 {
     id = 0;
@@ -39,113 +45,154 @@ CTvRegion CTvRegion::selectByID()
     return r;
 }
 
-int CTvRegion::getChannelListByName(char *name, Vector<sp<CTvChannel> > &vcp)
+//whole region_table in one select, grouped by list name
+void CTvRegion::loadLocked()
 {
-    if (name == NULL)
-        return -1;
-
-    String8 cmd;
-    cmd = String8("select * from region_table where name = ") + String8("\'") + name + String8("\'");
+    int generation = mGeneration;
+    mLists.clear();
 
     CTvDatabase::Cursor c;
-    CTvDatabase::GetTvDb()->select(cmd, c);
-    int col, size = 0;
-    int id;
-    int mode;
-    int frequency = 0;
-    int bandwidth;
-    int modulation;
-    int symbolRate;
-    int ofdmMode;
-    int channelNum = 0;
-    //add dtmb extra channel frequency
-    String8 physicalNumDisplayName;
-
+    CTvDatabase::GetTvDb()->select("select * from region_table", c);
     if (c.moveToFirst()) {
+        int nameCol = c.getColumnIndex("name");
+        int idCol = c.getColumnIndex("db_id");
+        int modeCol = c.getColumnIndex("fe_type");
+        int freqCol = c.getColumnIndex("frequency");
+        int modCol = c.getColumnIndex("modulation");
+        int bwCol = c.getColumnIndex("bandwidth");
+        int symbCol = c.getColumnIndex("symbol_rate");
+        int ofdmCol = c.getColumnIndex("ofdm_mode");
+        int numCol = c.getColumnIndex("logical_channel_num");
+        int displayCol = c.getColumnIndex("display");
+        RegionList *list = NULL;
         do {
-            col = c.getColumnIndex("db_id");
-            id = c.getInt(col);
-            col = c.getColumnIndex("fe_type");
-            mode = c.getInt(col);
-            col = c.getColumnIndex("frequency");
-            frequency = c.getInt(col);
-            col = c.getColumnIndex("modulation");
-            modulation = c.getInt(col);
-            col = c.getColumnIndex("bandwidth");
-            bandwidth = c.getInt(col);
-            col = c.getColumnIndex("symbol_rate");
-            symbolRate = c.getInt(col);
-            col = c.getColumnIndex("ofdm_mode");
-            ofdmMode = c.getInt(col);
-            col = c.getColumnIndex("logical_channel_num");
-            channelNum = c.getInt(col);
-            col = c.getColumnIndex("display");
-            physicalNumDisplayName = c.getString(col);//add dtmb extra channel displayname
-            CTvChannel *tempCTvChannel = new CTvChannel(id, mode, frequency, bandwidth, modulation, symbolRate, ofdmMode, channelNum);
-            if (tempCTvChannel) {
-              tempCTvChannel->setPhysicalNumDisplayName(physicalNumDisplayName);
+            String8 name = c.getString(nameCol);
+            if (list == NULL || strcmp(list->name.string(), name.string()) != 0) {
+                list = NULL;
+                for (size_t i = 0; i < mLists.size(); i++) {
+                    if (strcmp(mLists[i].name.string(), name.string()) == 0) {
+                        list = &mLists[i];
+                        break;
+                    }
+                }
+                if (list == NULL) {
+                    mLists.push_back(RegionList());
+                    list = &mLists.back();
+                    list->name = name;
+                }
             }
-            vcp.add(tempCTvChannel);
-            size++;
+            RegionChannel rc;
+            rc.id = c.getInt(idCol);
+            rc.mode = c.getInt(modeCol);
+            rc.frequency = c.getInt(freqCol);
+            rc.modulation = c.getInt(modCol);
+            rc.bandwidth = c.getInt(bwCol);
+            rc.symbolRate = c.getInt(symbCol);
+            rc.ofdmMode = c.getInt(ofdmCol);
+            rc.channelNum = c.getInt(numCol);
+            rc.display = c.getString(displayCol);
+            list->channels.push_back(rc);
         } while (c.moveToNext());
     }
     c.close();
 
-    return size;
+    std::sort(mLists.begin(), mLists.end(), [](const RegionList &a, const RegionList &b) {
+        return strcmp(a.name.string(), b.name.string()) < 0;
+    });
+    size_t total = 0;
+    for (size_t i = 0; i < mLists.size(); i++) {
+        RegionList &list = mLists[i];
+        list.byFreq.resize(list.channels.size());
+        for (size_t j = 0; j < list.channels.size(); j++) {
+            list.byFreq[j] = j;
+        }
+        const std::vector<RegionChannel> &channels = list.channels;
+        std::sort(list.byFreq.begin(), list.byFreq.end(), [&channels](int a, int b) {
+            if (channels[a].frequency != channels[b].frequency)
+                return channels[a].frequency < channels[b].frequency;
+            return a < b;
+        });
+        total += list.channels.size();
+    }
+    mLoadedGeneration = generation;
+    LOGD("%s, %zu lists, %zu channels", __FUNCTION__, mLists.size(), total);
+}
+
+const CTvRegion::RegionList *CTvRegion::findListLocked(const char *name)
+{
+    if (mLoadedGeneration != mGeneration) {
+        loadLocked();
+    }
+
+    std::vector<RegionList>::const_iterator it = std::lower_bound(mLists.begin(), mLists.end(), name,
+        [](const RegionList &list, const char *key) {
+            return strcmp(list.name.string(), key) < 0;
+        });
+    if (it == mLists.end() || strcmp(it->name.string(), name) != 0) {
+        return NULL;
+    }
+    return &*it;
+}
+
+//rows with beginFreq <= frequency <= endFreq, in table order
+void CTvRegion::freqRangeLocked(const RegionList &list, int beginFreq, int endFreq, std::vector<int> &rows)
+{
+    const std::vector<RegionChannel> &channels = list.channels;
+    std::vector<int>::const_iterator first = std::lower_bound(list.byFreq.begin(), list.byFreq.end(), beginFreq,
+        [&channels](int row, int freq) {
+            return channels[row].frequency < freq;
+        });
+    std::vector<int>::const_iterator last = std::upper_bound(first, list.byFreq.end(), endFreq,
+        [&channels](int freq, int row) {
+            return freq < channels[row].frequency;
+        });
+    rows.assign(first, last);
+    std::sort(rows.begin(), rows.end());
+}
+
+CTvChannel *CTvRegion::newChannel(const RegionChannel &rc)
+{
+    return new CTvChannel(rc.id, rc.mode, rc.frequency, rc.bandwidth, rc.modulation, rc.symbolRate,
+                          rc.ofdmMode, rc.channelNum);
+}
+
+int CTvRegion::getChannelListByName(char *name, Vector<sp<CTvChannel> > &vcp)
+{
+    if (name == NULL)
+        return -1;
+
+    AutoMutex _l(mCacheLock);
+    const RegionList *list = findListLocked(name);
+    if (list == NULL)
+        return 0;
+
+    for (size_t i = 0; i < list->channels.size(); i++) {
+        CTvChannel *tempCTvChannel = newChannel(list->channels[i]);
+        //add dtmb extra channel displayname
+        tempCTvChannel->setPhysicalNumDisplayName(list->channels[i].display);
+        vcp.add(tempCTvChannel);
+    }
+    return list->channels.size();
 }
 
 int CTvRegion::getChannelListByNameAndFreqRange(char *name, int beginFreq, int endFreq, Vector<sp<CTvChannel> > &vcp)
 {
     if (name == NULL)
         return -1;
-    int ret = 0;
-    String8 cmd;
-    cmd = String8("select * from region_table where name = ") + String8("\'") + name + String8("\'")
-          + String8(" and frequency >= ") + String8::format("%d", beginFreq) + String8(" and frequency <= ")
-          + String8::format("%d", endFreq);
 
-    CTvDatabase::Cursor c;
-    CTvDatabase::GetTvDb()->select(cmd, c);
-    int col, size = 0;
-    int id;
-    int mode;
-    int frequency = 0;
-    int bandwidth;
-    int modulation;
-    int symbolRate;
-    int ofdmMode;
-    int channelNum = 0;
-
-    do {
-        if (c.moveToFirst()) {
-            do {
-                col = c.getColumnIndex("db_id");
-                id = c.getInt(col);
-                col = c.getColumnIndex("fe_type");
-                mode = c.getInt(col);
-                col = c.getColumnIndex("frequency");
-                frequency = c.getInt(col);
-                col = c.getColumnIndex("modulation");
-                modulation = c.getInt(col);
-                col = c.getColumnIndex("bandwidth");
-                bandwidth = c.getInt(col);
-                col = c.getColumnIndex("symbol_rate");
-                symbolRate = c.getInt(col);
-                col = c.getColumnIndex("ofdm_mode");
-                ofdmMode = c.getInt(col);
-                col = c.getColumnIndex("logical_channel_num");
-                channelNum = c.getInt(col);
-                vcp.add(new CTvChannel(id, mode, frequency, bandwidth, modulation, symbolRate, ofdmMode, channelNum));
-                size++;
-            } while (c.moveToNext());
-        } else {
-            ret = -1;
-            break;
-        }
-    } while (false);
+    AutoMutex _l(mCacheLock);
+    const RegionList *list = findListLocked(name);
+    if (list == NULL)
+        return -1;
 
-    c.close();
-    return ret;
+    std::vector<int> rows;
+    freqRangeLocked(*list, beginFreq, endFreq, rows);
+    if (rows.empty())
+        return -1;
+    for (size_t i = 0; i < rows.size(); i++) {
+        vcp.add(newChannel(list->channels[rows[i]]));
+    }
+    return 0;
 }
 
 char* CTvRegion::getTvCountry()
@@ -174,25 +221,15 @@ Vector<String8> CTvRegion::getAllCountry()
 
 int CTvRegion::getLogicNumByNameAndfreq(char *name, int freq)
 {
-    int ret = 0;
-    int col = 0;
-
     if (name == NULL)
         return -1;
 
-    String8 cmd;
-    cmd = String8("select * from region_table where name = ") + String8("\'") + name + String8("\'");
-    cmd += String8(" and frequency = ") + String8::format("%d", freq);
-
-
-    CTvDatabase::Cursor c;
-    CTvDatabase::GetTvDb()->select(cmd, c);
-    if (c.moveToFirst()) {
-        col = c.getColumnIndex("logical_channel_num");
-        ret = c.getInt(col);
-    }
-    c.close();
+    AutoMutex _l(mCacheLock);
+    const RegionList *list = findListLocked(name);
+    if (list == NULL)
+        return 0;
 
-    return ret;
+    std::vector<int> rows;
+    freqRangeLocked(*list, freq, freq, rows);
+    return rows.empty() ? 0 : list->channels[rows[0]].channelNum;
 }
-
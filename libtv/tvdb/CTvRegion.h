@@ -14,6 +14,9 @@
 #include "CTvChannel.h"
 #include <utils/String8.h>
 #include <utils/Vector.h>
+#include <utils/Mutex.h>
+#include <vector>
+#include <atomic>
 
 #define COUNTRY_NAME_LEN        3
 using namespace android;
@@ -33,9 +36,44 @@ public:
     static void  setTvCountry(const char *country);
     Vector<String8> getAllCountry();
     //CTvChannel getChannels();
+    //region_table re-imported, the channel cache reloads on next use
+    static void invalidate()
+    {
+        mGeneration++;
+    }
 
     private:
+        //one row of region_table
+        struct RegionChannel {
+            int id;
+            int mode;
+            int frequency;
+            int bandwidth;
+            int modulation;
+            int symbolRate;
+            int ofdmMode;
+            int channelNum;
+            String8 display;
+        };
+
+        //rows in table order, byFreq sorted by (frequency, row)
+        struct RegionList {
+            String8 name;
+            std::vector<RegionChannel> channels;
+            std::vector<int> byFreq;
+        };
+
+        static const RegionList *findListLocked(const char *name);
+        static void loadLocked();
+        static void freqRangeLocked(const RegionList &list, int beginFreq, int endFreq, std::vector<int> &rows);
+        static CTvChannel *newChannel(const RegionChannel &rc);
+
         static char stCountry[COUNTRY_NAME_LEN];
+        static std::atomic<int> mGeneration;
+        static int mLoadedGeneration;
+        //sorted by name
+        static std::vector<RegionList> mLists;
+        static Mutex mCacheLock;
 };
 
 #endif  //_CTVREGION_H
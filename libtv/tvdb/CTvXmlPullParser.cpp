@@ -0,0 +1,361 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CTvXmlPullParser"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "CTvXmlPullParser.h"
+#include "CTvLog.h"
+
+CTvXmlPullParser::CTvXmlPullParser()
+{
+    mFd = -1;
+    mData = NULL;
+    mSize = 0;
+    mPos = NULL;
+    mDepth = 0;
+    mPendingEnd = false;
+}
+
+CTvXmlPullParser::~CTvXmlPullParser()
+{
+    close();
+}
+
+int CTvXmlPullParser::open(const char *path)
+{
+    close();
+    mFd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (mFd < 0) {
+        LOGE("%s, open %s failed(%s)", __FUNCTION__, path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(mFd, &st) != 0 || st.st_size <= 0) {
+        LOGE("%s, %s is empty", __FUNCTION__, path);
+        close();
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, mFd, 0);
+    if (map == MAP_FAILED) {
+        LOGE("%s, mmap %s failed(%s)", __FUNCTION__, path, strerror(errno));
+        close();
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    mData = (const char *)map;
+    mSize = st.st_size;
+    mPos = mData;
+    return 0;
+}
+
+void CTvXmlPullParser::close()
+{
+    if (mData != NULL) {
+        munmap((void *)mData, mSize);
+    }
+    if (mFd >= 0) {
+        ::close(mFd);
+    }
+    mFd = -1;
+    mData = NULL;
+    mSize = 0;
+    mPos = NULL;
+    mDepth = 0;
+    mPendingEnd = false;
+    mName.clear();
+    mArena.clear();
+    mAttributes.clear();
+}
+
+uint64_t CTvXmlPullParser::getContentHash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < mSize; i++) {
+        hash = (hash ^ (unsigned char)mData[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+//moves past the next end, false when the file ends first
+bool CTvXmlPullParser::skipUntil(const char *end)
+{
+    const char *limit = mData + mSize;
+    size_t len = strlen(end);
+    while (mPos + len <= limit) {
+        const char *p = (const char *)memchr(mPos, end[0], limit - mPos);
+        if (p == NULL || p + len > limit) {
+            break;
+        }
+        if (memcmp(p, end, len) == 0) {
+            mPos = p + len;
+            return true;
+        }
+        mPos = p + 1;
+    }
+    mPos = limit;
+    return false;
+}
+
+static void appendUtf8(std::vector<char> &out, unsigned int c)
+{
+    if (c < 0x80) {
+        out.push_back(c);
+    } else if (c < 0x800) {
+        out.push_back(0xC0 | (c >> 6));
+        out.push_back(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out.push_back(0xE0 | (c >> 12));
+        out.push_back(0x80 | ((c >> 6) & 0x3F));
+        out.push_back(0x80 | (c & 0x3F));
+    } else {
+        out.push_back(0xF0 | (c >> 18));
+        out.push_back(0x80 | ((c >> 12) & 0x3F));
+        out.push_back(0x80 | ((c >> 6) & 0x3F));
+        out.push_back(0x80 | (c & 0x3F));
+    }
+}
+
+//entities and newlines the way tinyxml2 reads attribute values
+bool CTvXmlPullParser::decodeValue(const char *begin, const char *end)
+{
+    static const struct {
+        const char *name;
+        char c;
+    } entities[] = {
+        {"quot;", '"'}, {"amp;", '&'}, {"apos;", '\''}, {"lt;", '<'}, {"gt;", '>'},
+    };
+
+    const char *p = begin;
+    while (p < end) {
+        if (*p == '\r') {
+            mArena.push_back('\n');
+            p += (p + 1 < end && p[1] == '\n') ? 2 : 1;
+            continue;
+        }
+        if (*p != '&') {
+            mArena.push_back(*p++);
+            continue;
+        }
+
+        const char *semi = (const char *)memchr(p, ';', end - p);
+        bool decoded = false;
+        if (semi != NULL && p + 1 < semi && p[1] == '#') {
+            bool hex = (p + 2 < semi) && (p[2] == 'x' || p[2] == 'X');
+            const char *digits = p + (hex ? 3 : 2);
+            unsigned int c = 0;
+            const char *q = digits;
+            for (; q < semi && (hex ? isxdigit((unsigned char)*q) : isdigit((unsigned char)*q)); q++) {
+                c = c * (hex ? 16 : 10) + (isdigit((unsigned char)*q) ? *q - '0' : (tolower(*q) - 'a' + 10));
+            }
+            if (q == semi && q > digits && c > 0 && c <= 0x10FFFF) {
+                appendUtf8(mArena, c);
+                p = semi + 1;
+                decoded = true;
+            }
+        } else if (semi != NULL) {
+            for (size_t i = 0; i < sizeof(entities) / sizeof(entities[0]); i++) {
+                size_t len = strlen(entities[i].name);
+                if ((size_t)(semi + 1 - (p + 1)) == len && memcmp(p + 1, entities[i].name, len) == 0) {
+                    mArena.push_back(entities[i].c);
+                    p = semi + 1;
+                    decoded = true;
+                    break;
+                }
+            }
+        }
+        if (!decoded) {
+            //unknown entities are kept as they are
+            mArena.push_back(*p++);
+        }
+    }
+    mArena.push_back('\0');
+    return true;
+}
+
+//mPos is past '<' of a start tag
+bool CTvXmlPullParser::parseTag()
+{
+    const char *limit = mData + mSize;
+    const char *p = mPos;
+
+    mArena.clear();
+    mAttributes.clear();
+    const char *name = p;
+    while (p < limit && !isspace((unsigned char)*p) && *p != '/' && *p != '>') {
+        p++;
+    }
+    if (p == name || p >= limit) {
+        return false;
+    }
+    mName.assign(name, p - name);
+
+    while (true) {
+        while (p < limit && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (p >= limit) {
+            return false;
+        }
+        if (*p == '>') {
+            p++;
+            break;
+        }
+        if (*p == '/') {
+            if (p + 1 >= limit || p[1] != '>') {
+                return false;
+            }
+            mPendingEnd = true;
+            p += 2;
+            break;
+        }
+
+        const char *attrName = p;
+        while (p < limit && !isspace((unsigned char)*p) && *p != '=' && *p != '>' && *p != '/') {
+            p++;
+        }
+        const char *attrNameEnd = p;
+        while (p < limit && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (attrNameEnd == attrName || p >= limit || *p != '=') {
+            return false;
+        }
+        p++;
+        while (p < limit && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (p >= limit || (*p != '"' && *p != '\'')) {
+            return false;
+        }
+        const char *value = p + 1;
+        const char *valueEnd = (const char *)memchr(value, *p, limit - value);
+        if (valueEnd == NULL) {
+            return false;
+        }
+
+        Attribute attr;
+        attr.name = mArena.size();
+        mArena.insert(mArena.end(), attrName, attrNameEnd);
+        mArena.push_back('\0');
+        attr.value = mArena.size();
+        decodeValue(value, valueEnd);
+        mAttributes.push_back(attr);
+        p = valueEnd + 1;
+    }
+
+    mPos = p;
+    return true;
+}
+
+int CTvXmlPullParser::next()
+{
+    if (mData == NULL) {
+        return XML_ERROR;
+    }
+    if (mPendingEnd) {
+        //the end of a <tag/>
+        mPendingEnd = false;
+        mDepth--;
+        return XML_END_TAG;
+    }
+
+    const char *limit = mData + mSize;
+    while (true) {
+        const char *p = (const char *)memchr(mPos, '<', limit - mPos);
+        if (p == NULL) {
+            mPos = limit;
+            return (mDepth == 0) ? XML_END_DOCUMENT : XML_ERROR;
+        }
+        mPos = p + 1;
+        size_t left = limit - mPos;
+
+        if (left >= 1 && *mPos == '?') {
+            if (!skipUntil("?>"))
+                return XML_ERROR;
+        } else if (left >= 3 && memcmp(mPos, "!--", 3) == 0) {
+            if (!skipUntil("-->"))
+                return XML_ERROR;
+        } else if (left >= 8 && memcmp(mPos, "![CDATA[", 8) == 0) {
+            if (!skipUntil("]]>"))
+                return XML_ERROR;
+        } else if (left >= 1 && *mPos == '!') {
+            if (!skipUntil(">"))
+                return XML_ERROR;
+        } else if (left >= 1 && *mPos == '/') {
+            const char *name = mPos + 1;
+            const char *end = (const char *)memchr(name, '>', limit - name);
+            if (end == NULL || mDepth <= 0) {
+                return XML_ERROR;
+            }
+            const char *nameEnd = name;
+            while (nameEnd < end && !isspace((unsigned char)*nameEnd)) {
+                nameEnd++;
+            }
+            mName.assign(name, nameEnd - name);
+            mArena.clear();
+            mAttributes.clear();
+            mPos = end + 1;
+            mDepth--;
+            return XML_END_TAG;
+        } else {
+            if (!parseTag()) {
+                LOGE("%s, bad tag at %zu", __FUNCTION__, (size_t)(p - mData));
+                return XML_ERROR;
+            }
+            mDepth++;
+            return XML_START_TAG;
+        }
+    }
+}
+
+const char *CTvXmlPullParser::getAttribute(const char *name) const
+{
+    for (size_t i = 0; i < mAttributes.size(); i++) {
+        if (strcmp(&mArena[mAttributes[i].name], name) == 0) {
+            return &mArena[mAttributes[i].value];
+        }
+    }
+    return NULL;
+}
+
+int CTvXmlPullParser::getIntAttribute(const char *name, int def) const
+{
+    const char *value = getAttribute(name);
+    if (value == NULL) {
+        return def;
+    }
+
+    const char *p = value;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        unsigned int v;
+        if (sscanf(value, "%x", &v) == 1) {
+            return (int)v;
+        }
+    } else {
+        int v;
+        if (sscanf(value, "%d", &v) == 1) {
+            return v;
+        }
+    }
+    return def;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CTVXMLPULLPARSER_H)
+#define _CTVXMLPULLPARSER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//forward only reader of an mmap'd xml file, for the large tv config files
+//that only need their elements and attributes. Text, comments and
+//processing instructions are skipped.
+class CTvXmlPullParser {
+public:
+    enum {
+        XML_ERROR = -1,
+        XML_END_DOCUMENT = 0,
+        XML_START_TAG,
+        XML_END_TAG,
+    };
+
+    CTvXmlPullParser();
+    ~CTvXmlPullParser();
+
+    int open(const char *path);
+    void close();
+    //XML_START_TAG, XML_END_TAG, XML_END_DOCUMENT or XML_ERROR
+    int next();
+    //element of the last tag. The depth of a start tag is its own, the root
+    //is 1, the depth of an end tag is its parent's
+    const char *getName() const
+    {
+        return mName.c_str();
+    }
+    int getDepth() const
+    {
+        return mDepth;
+    }
+    //entity decoded, valid until the next call of next(). NULL when absent
+    const char *getAttribute(const char *name) const;
+    //like tinyxml2 IntAttribute
+    int getIntAttribute(const char *name, int def) const;
+    //fnv-1a of the whole file, once opened
+    uint64_t getContentHash() const;
+    size_t getSize() const
+    {
+        return mSize;
+    }
+
+private:
+    struct Attribute {
+        size_t name;
+        size_t value;
+    };
+
+    bool skipUntil(const char *end);
+    bool parseTag();
+    bool decodeValue(const char *begin, const char *end);
+
+    int mFd;
+    const char *mData;
+    size_t mSize;
+    const char *mPos;
+    int mDepth;
+    bool mPendingEnd;
+    std::string mName;
+    //names and values of the attributes, NUL separated
+    std::vector<char> mArena;
+    std::vector<Attribute> mAttributes;
+};
+
+#endif  //_CTVXMLPULLPARSER_H
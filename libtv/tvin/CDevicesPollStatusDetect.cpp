@@ -26,6 +26,51 @@
 
 #include "CDevicesPollStatusDetect.h"
 
+typedef struct hdmi_detect_bit_map_s {
+    int bit;
+    tvin_port_t port;
+} hdmi_detect_bit_map_t;
+
+static const hdmi_detect_bit_map_t HDMI_DETECT_BIT_MAP[] = {
+    {HDMI_DETECT_STATUS_BIT_A, TVIN_PORT_HDMI0},
+    {HDMI_DETECT_STATUS_BIT_B, TVIN_PORT_HDMI1},
+    {HDMI_DETECT_STATUS_BIT_C, TVIN_PORT_HDMI2},
+    {HDMI_DETECT_STATUS_BIT_D, TVIN_PORT_HDMI3},
+};
+
+#define HDMI_DETECT_BIT_MAP_SIZE (sizeof(HDMI_DETECT_BIT_MAP) / sizeof(HDMI_DETECT_BIT_MAP[0]))
+
+CDevicesPollStatusDetect::CHotplugEventQueue::CHotplugEventQueue(CDevicesPollStatusDetect *pDetect)
+{
+    mpDetect = pDetect;
+}
+
+CDevicesPollStatusDetect::CHotplugEventQueue::~CHotplugEventQueue()
+{
+}
+
+void CDevicesPollStatusDetect::CHotplugEventQueue::postEdge(int source, int debounceMs)
+{
+    CMessage msg;
+    msg.mType = source;
+    //a newer edge of the same source restarts the debounce window
+    removeMsg(msg);
+    msg.mDelayMs = debounceMs;
+    sendMsg(msg);
+}
+
+void CDevicesPollStatusDetect::CHotplugEventQueue::cancelEdge(int source)
+{
+    CMessage msg;
+    msg.mType = source;
+    removeMsg(msg);
+}
+
+void CDevicesPollStatusDetect::CHotplugEventQueue::handleMessage(CMessage &msg)
+{
+    mpDetect->deliverHotplugEdge(msg.mType);
+}
+
 CDevicesPollStatusDetect::CDevicesPollStatusDetect()
 {
     m_event.events = 0;
@@ -37,6 +82,14 @@ CDevicesPollStatusDetect::CDevicesPollStatusDetect()
     mpObserver = NULL;
     mVdinDetectFd = -1;
     mVdin2DetectFd = -1;
+    for (int i = 0; i < SOURCE_MAX; i++) {
+        mHotplugState[i].port = TVIN_PORT_NULL;
+        mHotplugState[i].stable = -1;
+        mHotplugState[i].pending = -1;
+    }
+    mHdmiDebounceMs = config_get_int(CFG_SECTION_TV, CFG_HDMI_HOTPLUG_DEBOUNCE_MS, HDMI_HOTPLUG_DEBOUNCE_MS_DEF);
+    mAvinDebounceMs = config_get_int(CFG_SECTION_TV, CFG_AVIN_HOTPLUG_DEBOUNCE_MS, AVIN_HOTPLUG_DEBOUNCE_MS_DEF);
+    mHotplugEventQueue = sp<CHotplugEventQueue>::make(this);
     if (mEpoll.create() < 0) {
         return;
     }
@@ -56,6 +109,9 @@ CDevicesPollStatusDetect::CDevicesPollStatusDetect()
 
 CDevicesPollStatusDetect::~CDevicesPollStatusDetect()
 {
+    //no debounced edge may reach the observer after this
+    if (mHotplugEventQueue != NULL)
+        mHotplugEventQueue->stopMsgQueue();
 }
 
 int CDevicesPollStatusDetect::startDetect()
@@ -82,6 +138,7 @@ int CDevicesPollStatusDetect::startDetect()
 
         LOGD("startDetect get vdin2 device fd :%d", fd);
     }
+    mHotplugEventQueue->startMsgQueue();
     this->run("CDevicesPollStatusDetect");
     return 0;
 }
@@ -122,44 +179,22 @@ int CDevicesPollStatusDetect::SourceInputMaptoChipHdmiPort(tv_source_input_t sou
 {
     tvin_port_t source_port = TVIN_PORT_NULL;
     source_port = CTvin::getInstance()->Tvin_GetSourcePortBySourceInput(source_input);
-    switch (source_port) {
-    case TVIN_PORT_HDMI0:
-        return HDMI_DETECT_STATUS_BIT_A;
-        break;
-    case TVIN_PORT_HDMI1:
-        return HDMI_DETECT_STATUS_BIT_B;
-        break;
-    case TVIN_PORT_HDMI2:
-        return HDMI_DETECT_STATUS_BIT_C;
-        break;
-    case TVIN_PORT_HDMI3:
-        return HDMI_DETECT_STATUS_BIT_D;
-        break;
-    default:
-        return HDMI_DETECT_STATUS_BIT_A;
-        break;
+    for (unsigned int i = 0; i < HDMI_DETECT_BIT_MAP_SIZE; i++) {
+        if (HDMI_DETECT_BIT_MAP[i].port == source_port) {
+            return HDMI_DETECT_BIT_MAP[i].bit;
+        }
     }
+    return HDMI_DETECT_STATUS_BIT_A;
 }
 
 tv_source_input_t CDevicesPollStatusDetect::ChipHdmiPortMaptoSourceInput(int port)
 {
-    switch (port) {
-    case HDMI_DETECT_STATUS_BIT_A:
-        return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI0);
-        break;
-    case HDMI_DETECT_STATUS_BIT_B:
-        return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI1);
-        break;
-    case HDMI_DETECT_STATUS_BIT_C:
-        return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI2);
-        break;
-    case HDMI_DETECT_STATUS_BIT_D:
-        return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI3);
-        break;
-    default:
-        return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI0);
-        break;
+    for (unsigned int i = 0; i < HDMI_DETECT_BIT_MAP_SIZE; i++) {
+        if (HDMI_DETECT_BIT_MAP[i].bit == port) {
+            return CTvin::getInstance()->Tvin_PortToSourceInput(HDMI_DETECT_BIT_MAP[i].port);
+        }
     }
+    return CTvin::getInstance()->Tvin_PortToSourceInput(TVIN_PORT_HDMI0);
 }
 
 int CDevicesPollStatusDetect::GetSourceConnectStatus(tv_source_input_t source_input)
@@ -215,6 +250,105 @@ int CDevicesPollStatusDetect::GetSourceConnectStatus(tv_source_input_t source_in
     return PlugStatus;
 }
 
+void CDevicesPollStatusDetect::initHotplugState()
+{
+    AutoMutex _l(mLock);
+    for (unsigned int i = 0; i < HDMI_DETECT_BIT_MAP_SIZE; i++) {
+        int source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_BIT_MAP[i].bit);
+        if (source < 0 || source >= SOURCE_MAX) {
+            continue;
+        }
+        mHotplugState[source].port = HDMI_DETECT_BIT_MAP[i].port;
+        mHotplugState[source].stable = (m_hdmi_status & HDMI_DETECT_BIT_MAP[i].bit) ? CC_SOURCE_PLUG_IN : CC_SOURCE_PLUG_OUT;
+        mHotplugState[source].pending = mHotplugState[source].stable;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        int source = (m_avin_status[i].channel == AVIN_CHANNEL2) ? SOURCE_AV2 : SOURCE_AV1;
+        mHotplugState[source].port = m_avin_status[i].channel;
+        mHotplugState[source].stable = (m_avin_status[i].status == AVIN_STATUS_IN) ? CC_SOURCE_PLUG_IN : CC_SOURCE_PLUG_OUT;
+        mHotplugState[source].pending = mHotplugState[source].stable;
+    }
+}
+
+void CDevicesPollStatusDetect::onHotplugEdge(int source, int port, int plug, int debounceMs)
+{
+    if (source < 0 || source >= SOURCE_MAX) {
+        LOGE("%s: invalid source %d, port %d", __FUNCTION__, source, port);
+        return;
+    }
+
+    AutoMutex _l(mLock);
+    struct hotplug_state_s *state = &mHotplugState[source];
+    state->port = port;
+    state->pending = plug;
+    if (state->pending == state->stable) {
+        //bounced back inside the debounce window, nothing to report
+        LOGD("%s: %s edge coalesced", __FUNCTION__, inputToName((tv_source_input_t)source));
+        mHotplugEventQueue->cancelEdge(source);
+    } else {
+        mHotplugEventQueue->postEdge(source, debounceMs);
+    }
+}
+
+void CDevicesPollStatusDetect::deliverHotplugEdge(int source)
+{
+    int plug = -1;
+    {
+        AutoMutex _l(mLock);
+        struct hotplug_state_s *state = &mHotplugState[source];
+        if (state->pending == state->stable) {
+            return;
+        }
+        state->stable = state->pending;
+        plug = state->stable;
+    }
+
+    LOGD("%s: %s %s", __FUNCTION__, inputToName((tv_source_input_t)source), (CC_SOURCE_PLUG_IN == plug)?"plug in":"plug out");
+    if (mpObserver != NULL) {
+        mpObserver->onSourceConnect(source, plug);
+    }
+}
+
+void CDevicesPollStatusDetect::handleAvinStatus(const struct report_data_s *status)
+{
+    for (int i = 0; i < 2; i++) {
+        if (/*status[i].channel == m_avin_status[i].channel &&*/ status[i].status != m_avin_status[i].status) {
+            int source = -1, plug = -1;
+            if (status[i].status == AVIN_STATUS_IN) {
+                plug = CC_SOURCE_PLUG_IN;
+            } else {
+                plug = CC_SOURCE_PLUG_OUT;
+            }
+
+            if (status[i].channel == AVIN_CHANNEL1) {
+                source = SOURCE_AV1;
+            } else if (status[i].channel == AVIN_CHANNEL2) {
+                source = SOURCE_AV2;
+            }
+
+            LOGD("%s detected\n", inputToName((tv_source_input_t)source));
+            onHotplugEdge(source, status[i].channel, plug, mAvinDebounceMs);
+        }//not equal
+        m_avin_status[i] = status[i];
+    }
+}
+
+void CDevicesPollStatusDetect::handleHdmiStatus(int hdmi_status)
+{
+    int changed = hdmi_status ^ m_hdmi_status;
+    for (unsigned int i = 0; i < HDMI_DETECT_BIT_MAP_SIZE; i++) {
+        if ((changed & HDMI_DETECT_BIT_MAP[i].bit) == 0) {
+            continue;
+        }
+
+        int source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_BIT_MAP[i].bit);
+        int plug = (hdmi_status & HDMI_DETECT_BIT_MAP[i].bit) ? CC_SOURCE_PLUG_IN : CC_SOURCE_PLUG_OUT;
+        onHotplugEdge(source, HDMI_DETECT_BIT_MAP[i].port, plug, mHdmiDebounceMs);
+    }
+    m_hdmi_status = hdmi_status;
+}
+
 bool CDevicesPollStatusDetect::threadLoop()
 {
     if ( mpObserver == NULL ) {
@@ -228,6 +362,7 @@ bool CDevicesPollStatusDetect::threadLoop()
     mHdmiDetectFile.readFile((void *)(&m_hdmi_status), sizeof(int));
     mAvinDetectFile.readFile((void *)(&m_avin_status), sizeof(struct report_data_s) * 2);
     LOGD("CDevicesPollStatusDetect Loop, get init hdmi = 0x%x  avin[0].status = %d, avin[1].status = %d", m_hdmi_status, m_avin_status[0].status, m_avin_status[1].status);
+    initHotplugState();
 
     while (!exitPending()) { //requietexit() or requietexitWait() not call
         int num = mEpoll.wait();
@@ -240,79 +375,12 @@ bool CDevicesPollStatusDetect::threadLoop()
                 if (fd == mAvinDetectFile.getFd()) {//avin
                     struct report_data_s status[2];
                     mAvinDetectFile.readFile((void *)(&status), sizeof(struct report_data_s) * 2);
-                    for (int i = 0; i < 2; i++) {
-                        int source = -1, plug = -1;
-                        if (/*status[i].channel == m_avin_status[i].channel &&*/ status[i].status != m_avin_status[i].status) {
-                            //LOGD("status[i].status != m_avin_status[i].status");
-                            if (status[i].status == AVIN_STATUS_IN) {
-                                plug = CC_SOURCE_PLUG_IN;
-                            } else {
-                                plug = CC_SOURCE_PLUG_OUT;
-                            }
-
-                            if (status[i].channel == AVIN_CHANNEL1) {
-                                source = SOURCE_AV1;
-                            } else if (status[i].channel == AVIN_CHANNEL2) {
-                                source = SOURCE_AV2;
-                            }
-
-                            LOGD("%s detected\n", inputToName((tv_source_input_t)source));
-                            if (mpObserver != NULL) {
-                                mpObserver->onSourceConnect(source, plug);
-                            }
-                        }//not equal
-                        m_avin_status[i] = status[i];
-                    }
+                    handleAvinStatus(status);
                 } else if (fd == mHdmiDetectFile.getFd()) { //hdmi
                     int hdmi_status = 0;
                     mHdmiDetectFile.readFile((void *)(&hdmi_status), sizeof(int));
                     LOGD("HDMI detected\n");
-                    int source = -1, plug = -1;
-                    if ((hdmi_status & HDMI_DETECT_STATUS_BIT_A) != (m_hdmi_status  & HDMI_DETECT_STATUS_BIT_A) ) {
-                        if ((hdmi_status & HDMI_DETECT_STATUS_BIT_A) == HDMI_DETECT_STATUS_BIT_A) {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_A);
-                            plug = CC_SOURCE_PLUG_IN;
-                        } else {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_A);
-                            plug = CC_SOURCE_PLUG_OUT;
-                        }
-                        mpObserver->onSourceConnect(source, plug);
-                    }
-
-                    if ((hdmi_status & HDMI_DETECT_STATUS_BIT_B) != (m_hdmi_status  & HDMI_DETECT_STATUS_BIT_B) ) {
-                        if ((hdmi_status & HDMI_DETECT_STATUS_BIT_B) == HDMI_DETECT_STATUS_BIT_B) {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_B);
-                            plug = CC_SOURCE_PLUG_IN;
-                        } else {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_B);
-                            plug = CC_SOURCE_PLUG_OUT;
-                        }
-                        mpObserver->onSourceConnect(source, plug);
-                    }
-
-                    if ((hdmi_status & HDMI_DETECT_STATUS_BIT_C) != (m_hdmi_status  & HDMI_DETECT_STATUS_BIT_C) ) {
-                        if ((hdmi_status & HDMI_DETECT_STATUS_BIT_C) == HDMI_DETECT_STATUS_BIT_C) {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_C);
-                            plug = CC_SOURCE_PLUG_IN;
-                        } else {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_C);
-                            plug = CC_SOURCE_PLUG_OUT;
-                        }
-                        mpObserver->onSourceConnect(source, plug);
-                    }
-
-                    if ((hdmi_status & HDMI_DETECT_STATUS_BIT_D) != (m_hdmi_status  & HDMI_DETECT_STATUS_BIT_D) ) {
-                        if ((hdmi_status & HDMI_DETECT_STATUS_BIT_D) == HDMI_DETECT_STATUS_BIT_D) {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_D);
-                            plug = CC_SOURCE_PLUG_IN;
-                        } else {
-                            source = ChipHdmiPortMaptoSourceInput(HDMI_DETECT_STATUS_BIT_D);
-                            plug = CC_SOURCE_PLUG_OUT;
-                        }
-                        mpObserver->onSourceConnect(source, plug);
-                    }
-
-                    m_hdmi_status = hdmi_status;
+                    handleHdmiStatus(hdmi_status);
                 }else if ( fd == mVdinDetectFd ) {
                     LOGD("VDIN detected\n");
                     if (mpObserver != NULL) {
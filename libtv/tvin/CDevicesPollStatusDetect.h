@@ -12,6 +12,7 @@
 
 #include <utils/Thread.h>
 #include <CFile.h>
+#include <CMsgQueue.h>
 #include <zepoll.h>
 
 enum avin_status_e {
@@ -44,6 +45,12 @@ static const int HDMI_DETECT_STATUS_BIT_B = 0x02;
 static const int HDMI_DETECT_STATUS_BIT_C = 0x04;
 static const int HDMI_DETECT_STATUS_BIT_D = 0x08;
 
+//hotplug debounce window, an edge must stay stable this long before it is reported
+#define CFG_HDMI_HOTPLUG_DEBOUNCE_MS            "hdmi.hotplug.debounce.ms"
+#define CFG_AVIN_HOTPLUG_DEBOUNCE_MS            "avin.hotplug.debounce.ms"
+static const int HDMI_HOTPLUG_DEBOUNCE_MS_DEF = 200;
+static const int AVIN_HOTPLUG_DEBOUNCE_MS_DEF = 100;
+
 static const char *AVIN_DETECT_PATH = "/dev/avin_detect";
 static const char *HDMI_DETECT_PATH = "/dev/hdmirx0";
 static const char *VPP_POLL_PATCH = "/dev/amvideo_poll";
@@ -71,8 +78,32 @@ public:
         mpObserver = pOb;
     };
 private:
+    //delivers debounced hotplug edges to the observer out of the epoll thread
+    class CHotplugEventQueue: public CMsgQueueThread {
+    public:
+        CHotplugEventQueue(CDevicesPollStatusDetect *pDetect);
+        ~CHotplugEventQueue();
+        void postEdge(int source, int debounceMs);
+        void cancelEdge(int source);
+    private:
+        virtual void handleMessage(CMessage &msg);
+        CDevicesPollStatusDetect *mpDetect;
+    };
+
+    //per source (one source per physical port) hotplug state
+    struct hotplug_state_s {
+        int port;
+        int stable;//last status reported to observer
+        int pending;//last status read from driver
+    };
+
     bool threadLoop();
     const char* inputToName(tv_source_input_t srcInput);
+    void initHotplugState();
+    void onHotplugEdge(int source, int port, int plug, int debounceMs);
+    void deliverHotplugEdge(int source);
+    void handleAvinStatus(const struct report_data_s *status);
+    void handleHdmiStatus(int hdmi_status);
 
     int mVdinDetectFd;
     int mVdin2DetectFd;
@@ -85,5 +116,9 @@ private:
     CFile mVppPollFile;
     struct report_data_s m_avin_status[2];
     int m_hdmi_status;
+    sp<CHotplugEventQueue> mHotplugEventQueue;
+    struct hotplug_state_s mHotplugState[SOURCE_MAX];
+    int mHdmiDebounceMs;
+    int mAvinDebounceMs;
 };
 #endif
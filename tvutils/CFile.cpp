@@ -16,6 +16,9 @@
 
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
 
 CFile::CFile()
 {
@@ -87,11 +90,10 @@ int CFile::readFile(void *pBuf, int uLen)
     return ret;
 }
 
-int CFile::copyTo(const char *dstPath)
+int CFile::copyTo(const char *dstPath, int flags, CopyProgressCb progress, void *user)
 {
     if (strlen(mPath) <= 0)
         return -1;
-    int dstFd;
     if (mFd == -1) {
         if ((mFd = open(mPath, O_RDONLY)) == -1) {
             LOGE("Open %s Error:%s/n", mPath, strerror(errno));
@@ -99,44 +101,200 @@ int CFile::copyTo(const char *dstPath)
         }
     }
 
-    if ((dstFd = open(dstPath, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR)) == -1) {
-        LOGE("Open %s Error:%s/n", dstPath, strerror(errno));
+    return copyFd(mFd, dstPath, flags, progress, user);
+}
+
+int CFile::copyFile(const char *srcPath, const char *dstPath, int flags, CopyProgressCb progress, void *user)
+{
+    int srcFd = open(srcPath, O_RDONLY | O_CLOEXEC);
+    if (srcFd < 0) {
+        LOGE("Open %s Error:%s/n", srcPath, strerror(errno));
+        return -1;
+    }
+
+    int ret = copyFd(srcFd, dstPath, flags, progress, user);
+    close(srcFd);
+    return ret;
+}
+
+int CFile::copyFd(int srcFd, const char *dstPath, int flags, CopyProgressCb progress, void *user)
+{
+    char tmpPath[CC_MAX_FILE_PATH_LEN + 8];
+    const char *target = dstPath;
+    if (flags & COPY_ATOMIC) {
+        snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", dstPath);
+        target = tmpPath;
+    }
+
+    struct stat st;
+    long long total = (fstat(srcFd, &st) == 0 && S_ISREG(st.st_mode)) ? (long long)st.st_size : 0;
+    int dstFd = open(target, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (dstFd < 0) {
+        LOGE("Open %s Error:%s/n", target, strerror(errno));
         return -1;
     }
 
-    int bytes_read, bytes_write;
-    char buffer[BUFFER_SIZE];
-    char *ptr;
     int ret = 0;
-    while ((bytes_read = read(mFd, buffer, BUFFER_SIZE))) {
-        if ((bytes_read == -1) && (errno != EINTR)) {
+    long long copied = copyData(srcFd, dstFd, total, progress, user);
+    if (copied < 0) {
+        ret = -1;
+    } else if ((flags & (COPY_SYNC | COPY_ATOMIC)) && fsync(dstFd) != 0) {
+        LOGE("sync %s Error:%s/n", target, strerror(errno));
+        ret = -1;
+    } else if (flags & COPY_VERIFY) {
+        unsigned int srcCrc = 0, dstCrc = 0;
+        if (crcFd(srcFd, copied, &srcCrc) != 0 || crcFd(dstFd, copied, &dstCrc) != 0 || srcCrc != dstCrc) {
+            LOGE("verify %s failed, crc 0x%08x/0x%08x", target, srcCrc, dstCrc);
             ret = -1;
-            break;
-        } else if (bytes_read > 0) {
-            ptr = buffer;
-            while ((bytes_write = write(dstFd, ptr, bytes_read))) {
-                if ((bytes_write == -1) && (errno != EINTR)) {
-                    ret = -1;
-                    break;
-                }
-                else if (bytes_write == bytes_read) {
-                    ret = 0;
-                    break;
-                }
-                else if (bytes_write > 0) {
-                    ptr += bytes_write;
-                    bytes_read -= bytes_write;
+        }
+    }
+    close(dstFd);
+
+    if (flags & COPY_ATOMIC) {
+        if (ret == 0 && rename(tmpPath, dstPath) != 0) {
+            LOGE("rename to %s Error:%s/n", dstPath, strerror(errno));
+            ret = -1;
+        }
+        if (ret != 0) {
+            unlink(tmpPath);
+            return ret;
+        }
+
+        char dirPath[CC_MAX_FILE_PATH_LEN];
+        snprintf(dirPath, sizeof(dirPath), "%s", dstPath);
+        char *slash = strrchr(dirPath, '/');
+        if (slash != NULL) {
+            *slash = '\0';
+            int dirFd = open(dirPath[0] ? dirPath : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirFd >= 0) {
+                fsync(dirFd);
+                close(dirFd);
+            }
+        }
+    }
+    return ret;
+}
+
+//bytes copied from offset 0 to the end of src, -1 on error. total is only
+//for the progress, 0 when unknown (sysfs, pipes)
+long long CFile::copyData(int srcFd, int dstFd, long long total, CopyProgressCb progress, void *user)
+{
+    enum {
+        MODE_COPY_RANGE,
+        MODE_SENDFILE,
+        MODE_READ_WRITE,
+    };
+    int mode = (total > 0) ? MODE_COPY_RANGE : MODE_READ_WRITE;
+    long long done = 0;
+    char *buffer = NULL;
+
+    while (true) {
+        ssize_t n = -1;
+        if (mode == MODE_COPY_RANGE) {
+#ifdef __NR_copy_file_range
+            loff_t inOff = done;
+            loff_t outOff = done;
+            n = syscall(__NR_copy_file_range, srcFd, &inOff, dstFd, &outOff, COPY_CHUNK_SIZE, 0);
+#else
+            errno = ENOSYS;
+#endif
+            if (n < 0 && errno != EINTR) {
+                //cross filesystem on older kernels, or not supported at all
+                mode = MODE_SENDFILE;
+                continue;
+            }
+        } else if (mode == MODE_SENDFILE) {
+            off_t inOff = done;
+            if (lseek(dstFd, done, SEEK_SET) < 0) {
+                n = -1;
+            } else {
+                n = sendfile(dstFd, srcFd, &inOff, COPY_CHUNK_SIZE);
+            }
+            if (n < 0 && errno != EINTR) {
+                mode = MODE_READ_WRITE;
+                continue;
+            }
+        } else {
+            if (buffer == NULL && (buffer = (char *)malloc(COPY_BUFFER_SIZE)) == NULL) {
+                return -1;
+            }
+            n = pread(srcFd, buffer, COPY_BUFFER_SIZE, done);
+            if (n > 0) {
+                ssize_t written = 0;
+                while (written < n) {
+                    ssize_t w = pwrite(dstFd, buffer + written, n - written, done + written);
+                    if (w < 0) {
+                        if (errno == EINTR)
+                            continue;
+                        LOGE("write Error:%s/n", strerror(errno));
+                        free(buffer);
+                        return -1;
+                    }
+                    written += w;
                 }
+            } else if (n < 0 && errno != EINTR) {
+                LOGE("read Error:%s/n", strerror(errno));
+                free(buffer);
+                return -1;
             }
-            if (bytes_write == -1) {
-                ret = -1;
-                break;
+        }
+
+        if (n < 0) {
+            //EINTR
+            continue;
+        }
+        if (n == 0) {
+            //some special files report a size but give nothing to copy_file_range
+            if (mode != MODE_READ_WRITE && done == 0) {
+                mode = MODE_READ_WRITE;
+                continue;
             }
+            break;
+        }
+        done += n;
+        if (progress != NULL && progress(done, total, user) != 0) {
+            LOGD("copy cancelled at %lld", done);
+            free(buffer);
+            errno = ECANCELED;
+            return -1;
         }
     }
-    fsync(dstFd);
-    close(dstFd);
-    return ret;
+
+    free(buffer);
+    return done;
+}
+
+int CFile::crcFd(int fd, long long total, unsigned int *crc)
+{
+    static unsigned int table[256];
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, []() {
+        for (unsigned int i = 0; i < 256; i++) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+    });
+
+    unsigned char *buffer = (unsigned char *)malloc(COPY_BUFFER_SIZE);
+    if (buffer == NULL)
+        return -1;
+    unsigned int c = 0xFFFFFFFF;
+    long long done = 0;
+    while (done < total) {
+        ssize_t n = pread(fd, buffer, COPY_BUFFER_SIZE, done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        for (ssize_t i = 0; i < n; i++)
+            c = table[(c ^ buffer[i]) & 0xFF] ^ (c >> 8);
+        done += n;
+    }
+    free(buffer);
+    *crc = c ^ 0xFFFFFFFF;
+    return (done == total) ? 0 : -1;
 }
 
 
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CFlashDevice"
+
+#include "include/CFlashDevice.h"
+#include "include/CTvLog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <mtd/mtd-user.h>
+
+#define FLASH_DEFAULT_PAGE      4096
+
+pthread_mutex_t CFlashDevice::sDevicesLock = PTHREAD_MUTEX_INITIALIZER;
+CFlashDevice *CFlashDevice::sDevices[FLASH_MAX_DEVICES] = {NULL};
+
+CFlashDevice *CFlashDevice::get(const char *path)
+{
+    if (path == NULL) {
+        return NULL;
+    }
+
+    CFlashDevice *dev = NULL;
+    pthread_mutex_lock(&sDevicesLock);
+    for (int i = 0; i < FLASH_MAX_DEVICES; i++) {
+        if (sDevices[i] != NULL && strcmp(sDevices[i]->mPath, path) == 0) {
+            dev = sDevices[i];
+            break;
+        }
+    }
+    if (dev == NULL) {
+        for (int i = 0; i < FLASH_MAX_DEVICES; i++) {
+            if (sDevices[i] == NULL) {
+                dev = sDevices[i] = new CFlashDevice(path);
+                break;
+            }
+        }
+        if (dev == NULL) {
+            LOGE("%s: no free slot for %s\n", __FUNCTION__, path);
+        }
+    }
+    pthread_mutex_unlock(&sDevicesLock);
+    return dev;
+}
+
+CFlashDevice::CFlashDevice(const char *path)
+{
+    snprintf(mPath, sizeof(mPath), "%s", path);
+    mFd = -1;
+    mIsMtd = false;
+    mIsNand = false;
+    mEraseSize = FLASH_DEFAULT_PAGE;
+    mSize = 0;
+    mMap = NULL;
+    memset(mPages, 0, sizeof(mPages));
+    mLruClock = 0;
+    mHits = 0;
+    mMisses = 0;
+    pthread_mutex_init(&mLock, NULL);
+}
+
+CFlashDevice::~CFlashDevice()
+{
+    dropCacheLocked();
+    if (mMap != NULL) {
+        munmap(mMap, mSize);
+        mMap = NULL;
+    }
+    if (mFd >= 0) {
+        close(mFd);
+        mFd = -1;
+    }
+    pthread_mutex_destroy(&mLock);
+}
+
+int CFlashDevice::openLocked()
+{
+    if (mFd >= 0) {
+        return 0;
+    }
+
+    mFd = open(mPath, O_RDWR);
+    if (mFd < 0) {
+        mFd = open(mPath, O_RDONLY);
+    }
+    if (mFd < 0) {
+        LOGE("%s: open %s error(%s)\n", __FUNCTION__, mPath, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    fstat(mFd, &st);
+    struct mtd_info_user info;
+    if (S_ISCHR(st.st_mode) && ioctl(mFd, MEMGETINFO, &info) == 0) {
+        mIsMtd = true;
+        mIsNand = (info.type == MTD_NANDFLASH || info.type == MTD_MLCNANDFLASH);
+        mSize = info.size;
+        if (info.erasesize > 0) {
+            mEraseSize = info.erasesize;
+        }
+    } else if (S_ISBLK(st.st_mode)) {
+        uint64_t size = 0;
+        ioctl(mFd, BLKGETSIZE64, &size);
+        mSize = size;
+    } else {
+        mSize = st.st_size;
+    }
+
+    //only direct mapped nor flash drivers allow this, plain files may grow
+    if (mSize > 0 && (uint64_t)(size_t)mSize == mSize && ((mIsMtd && !mIsNand) || S_ISBLK(st.st_mode))) {
+        void *map = mmap(NULL, mSize, PROT_READ, MAP_SHARED, mFd, 0);
+        if (map != MAP_FAILED) {
+            mMap = (unsigned char *)map;
+        }
+    }
+    LOGD("%s: %s, %s, size 0x%llx, erase 0x%x, %s\n", __FUNCTION__, mPath,
+         mIsMtd ? (mIsNand ? "nand" : "nor") : "file", (unsigned long long)mSize, mEraseSize,
+         mMap ? "mapped" : "cached");
+    return 0;
+}
+
+int CFlashDevice::readDeviceLocked(unsigned int offset, unsigned int length, unsigned char *buffer)
+{
+    unsigned int done = 0;
+    while (done < length) {
+        ssize_t n = pread(mFd, buffer + done, length - done, (off_t)offset + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("%s: read 0x%x error(%s)\n", __FUNCTION__, offset + done, strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+CFlashDevice::Page *CFlashDevice::getPageLocked(unsigned int base)
+{
+    Page *victim = &mPages[0];
+    for (int i = 0; i < FLASH_CACHE_PAGES; i++) {
+        if (mPages[i].data != NULL && mPages[i].base == base) {
+            mPages[i].lru = ++mLruClock;
+            mHits++;
+            return &mPages[i];
+        }
+        if (mPages[i].data == NULL || (victim->data != NULL && mPages[i].lru < victim->lru)) {
+            victim = &mPages[i];
+        }
+    }
+
+    mMisses++;
+    if (victim->data == NULL) {
+        victim->data = (unsigned char *)malloc(mEraseSize);
+        if (victim->data == NULL) {
+            LOGE("%s: malloc page failed\n", __FUNCTION__);
+            return NULL;
+        }
+    }
+    int n = readDeviceLocked(base, mEraseSize, victim->data);
+    if (n < 0) {
+        free(victim->data);
+        victim->data = NULL;
+        return NULL;
+    }
+    //past the end of a file reads as erased
+    memset(victim->data + n, 0xff, mEraseSize - n);
+    victim->base = base;
+    victim->lru = ++mLruClock;
+    return victim;
+}
+
+int CFlashDevice::read(unsigned int offset, unsigned int length, unsigned char *buffer)
+{
+    if (buffer == NULL) {
+        LOGE("%s: buffer is NULL!\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mLock);
+    if (openLocked() < 0) {
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+
+    int ret = length;
+    if (mMap != NULL && offset < mSize && length <= mSize - offset) {
+        memcpy(buffer, mMap + offset, length);
+    } else if (mSize > 0 && offset >= mSize) {
+        ret = 0;
+    } else {
+        if (mSize > 0 && length > mSize - offset) {
+            length = (unsigned int)(mSize - offset);
+            ret = length;
+        }
+        unsigned int done = 0;
+        while (done < length) {
+            unsigned int pos = offset + done;
+            unsigned int base = pos - pos % mEraseSize;
+            unsigned int in = pos - base;
+            unsigned int n = mEraseSize - in;
+            if (n > length - done) {
+                n = length - done;
+            }
+
+            //whole pages of a bulk read go around the cache, unless already cached
+            bool cached = false;
+            for (int i = 0; i < FLASH_CACHE_PAGES; i++) {
+                if (mPages[i].data != NULL && mPages[i].base == base) {
+                    cached = true;
+                    break;
+                }
+            }
+            if (n == mEraseSize && !cached) {
+                unsigned int run = (length - done) - (length - done) % mEraseSize;
+                int r = readDeviceLocked(pos, run, buffer + done);
+                if (r < 0) {
+                    ret = -1;
+                    break;
+                }
+                done += r;
+                if ((unsigned int)r < run) {
+                    ret = done;
+                    break;
+                }
+                continue;
+            }
+
+            Page *page = getPageLocked(base);
+            if (page == NULL) {
+                ret = -1;
+                break;
+            }
+            memcpy(buffer + done, page->data + in, n);
+            done += n;
+        }
+    }
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+int CFlashDevice::writeBlockLocked(unsigned int base, unsigned int offset, unsigned int length,
+                                   const unsigned char *buffer)
+{
+    unsigned int in = offset - base;
+
+    if (!mIsMtd) {
+        unsigned int done = 0;
+        while (done < length) {
+            ssize_t n = pwrite(mFd, buffer + done, length - done, (off_t)offset + done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOGE("%s: write 0x%x error(%s)\n", __FUNCTION__, offset + done, strerror(errno));
+                return -1;
+            }
+            done += n;
+        }
+        for (int i = 0; i < FLASH_CACHE_PAGES; i++) {
+            if (mPages[i].data != NULL && mPages[i].base == base) {
+                memcpy(mPages[i].data + in, buffer, length);
+            }
+        }
+        if ((uint64_t)offset + length > mSize) {
+            mSize = (uint64_t)offset + length;
+        }
+        return length;
+    }
+
+    Page *page = getPageLocked(base);
+    if (page == NULL) {
+        return -1;
+    }
+    if (memcmp(page->data + in, buffer, length) == 0) {
+        return length;
+    }
+
+    //nor flash programs 1 to 0 without an erase, anything else needs one.
+    //A nand page is programmed once after an erase, whatever the bits.
+    bool needErase = mIsNand;
+    for (unsigned int i = 0; i < length && !needErase; i++) {
+        if ((page->data[in + i] & buffer[i]) != buffer[i]) {
+            needErase = true;
+        }
+    }
+
+    memcpy(page->data + in, buffer, length);
+    const unsigned char *src = buffer;
+    unsigned int pos = offset;
+    unsigned int len = length;
+    if (needErase) {
+        if (eraseBlockLocked(base) < 0) {
+            dropCacheLocked();
+            return -1;
+        }
+        src = page->data;
+        pos = base;
+        len = mEraseSize;
+    }
+
+    unsigned int done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(mFd, src + done, len - done, (off_t)pos + done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOGE("%s: write 0x%x error(%s)\n", __FUNCTION__, pos + done, strerror(errno));
+            dropCacheLocked();
+            return -1;
+        }
+        done += n;
+    }
+    return length;
+}
+
+int CFlashDevice::eraseBlockLocked(unsigned int base)
+{
+    if (mIsNand) {
+        //erasing or writing a bad block loses data elsewhere, leave it to the bbt
+        loff_t ofs = base;
+        int bad = ioctl(mFd, MEMGETBADBLOCK, &ofs);
+        if (bad != 0) {
+            LOGE("%s: block 0x%x is bad(%d)\n", __FUNCTION__, base, bad);
+            return -1;
+        }
+    }
+    struct erase_info_user erase;
+    erase.start = base;
+    erase.length = mEraseSize;
+    if (ioctl(mFd, MEMERASE, &erase) < 0) {
+        LOGE("%s: erase 0x%x error(%s)\n", __FUNCTION__, base, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int CFlashDevice::write(unsigned int offset, unsigned int length, const unsigned char *buffer)
+{
+    if (buffer == NULL) {
+        LOGE("%s: buffer is NULL!\n", __FUNCTION__);
+        return -1;
+    }
+
+    pthread_mutex_lock(&mLock);
+    if (openLocked() < 0) {
+        pthread_mutex_unlock(&mLock);
+        return -1;
+    }
+
+    int ret = length;
+    unsigned int done = 0;
+    while (done < length) {
+        unsigned int pos = offset + done;
+        unsigned int base = pos - pos % mEraseSize;
+        unsigned int n = mEraseSize - (pos - base);
+        if (n > length - done) {
+            n = length - done;
+        }
+        if (writeBlockLocked(base, pos, n, buffer + done) < 0) {
+            ret = -1;
+            break;
+        }
+        done += n;
+    }
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+void CFlashDevice::dropCache()
+{
+    pthread_mutex_lock(&mLock);
+    dropCacheLocked();
+    pthread_mutex_unlock(&mLock);
+}
+
+void CFlashDevice::dropCacheLocked()
+{
+    for (int i = 0; i < FLASH_CACHE_PAGES; i++) {
+        free(mPages[i].data);
+        mPages[i].data = NULL;
+    }
+}
+
+void CFlashDevice::getStats(unsigned int *hits, unsigned int *misses)
+{
+    pthread_mutex_lock(&mLock);
+    if (hits != NULL) {
+        *hits = mHits;
+    }
+    if (misses != NULL) {
+        *misses = mMisses;
+    }
+    pthread_mutex_unlock(&mLock);
+}
@@ -82,14 +82,28 @@ int CMsgQueueThread::startMsgQueue()
     return 0;
 }
 
+//drops the pending messages and waits for a handleMessage still running
+void CMsgQueueThread::stopMsgQueue()
+{
+    requestExit();
+    {
+        AutoMutex _l(mLockQueue);
+        m_v_msg.clear();
+        mGetMsgCondition.signal();
+    }
+    join();
+}
+
 bool CMsgQueueThread::threadLoop()
 {
     while (!exitPending()) { //requietexit() or requietexitWait() not call
         mLockQueue.lock();
-        while (m_v_msg.size() == 0) { //msg queue is empty
+        while (m_v_msg.size() == 0 && !exitPending()) { //msg queue is empty
             mGetMsgCondition.wait(mLockQueue);//first unlock,when return,lock again,so need,call unlock
         }
         mLockQueue.unlock();
+        if (exitPending())
+            break;
         //get delay time
         CMessage msg;
         nsecs_t delayMs = 0;
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: c++ file
+ */
+
+#define LOG_TAG "tvserver"
+#define LOG_TV_TAG "CPropertyWatch"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#if defined(__ANDROID__)
+#include <cutils/properties.h>
+#include <sys/system_properties.h>
+#else
+#include <sys/inotify.h>
+#endif
+
+#include "include/CPropertyWatch.h"
+#include "include/CTvLog.h"
+
+//every property set bumps the area serial, which is waited on for this long.
+//stopWatch is seen at the next property change or after it.
+#define PROPERTY_WAIT_TIMEOUT_MS    5000
+
+CPropertyWatch::CPropertyWatch()
+{
+    mpObserver = NULL;
+    mCount = 0;
+    mSerial = 0;
+    mNotifyFd = -1;
+    mStopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    mWakeCount = 0;
+}
+
+CPropertyWatch::~CPropertyWatch()
+{
+    if (mNotifyFd >= 0) {
+        close(mNotifyFd);
+    }
+    if (mStopFd >= 0) {
+        close(mStopFd);
+    }
+}
+
+int CPropertyWatch::addProperty(const char *name, const char *def)
+{
+    AutoMutex _l(mLock);
+    if (name == NULL || mCount >= MAX_PROPERTIES) {
+        return -1;
+    }
+
+    Property &prop = mProperties[mCount++];
+    snprintf(prop.name, sizeof(prop.name), "%s", name);
+    snprintf(prop.def, sizeof(prop.def), "%s", (def != NULL) ? def : "");
+    prop.value[0] = '\0';
+    prop.valid = false;
+#if defined(__ANDROID__)
+    prop.info = NULL;
+    prop.serial = 0;
+#endif
+    return 0;
+}
+
+int CPropertyWatch::startWatch()
+{
+#if defined(__ANDROID__)
+    mSerial = __system_property_area_serial();
+    for (int i = 0; i < mCount; i++) {
+        mProperties[i].info = __system_property_find(mProperties[i].name);
+        if (mProperties[i].info != NULL) {
+            mProperties[i].serial = __system_property_serial(mProperties[i].info);
+        }
+    }
+#else
+    mkdir(PROPERTY_WATCH_FAKE_DIR, 0755);
+    mNotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (mNotifyFd < 0 || inotify_add_watch(mNotifyFd, PROPERTY_WATCH_FAKE_DIR,
+                                           IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+        LOGE("%s, watch %s failed(%s)", __FUNCTION__, PROPERTY_WATCH_FAKE_DIR, strerror(errno));
+        return -1;
+    }
+#endif
+    return run("CPropertyWatch");
+}
+
+int CPropertyWatch::stopWatch()
+{
+    uint64_t one = 1;
+    requestExit();
+    if (mStopFd >= 0) {
+        write(mStopFd, &one, sizeof(one));
+    }
+    //waits for a callback running on the watch thread, unless called from it
+    if (getTid() != gettid()) {
+        AutoMutex _l(mObserverLock);
+        mpObserver = NULL;
+    } else {
+        mpObserver = NULL;
+    }
+    return 0;
+}
+
+void CPropertyWatch::readProperty(const Property &prop, char *value)
+{
+#if defined(__ANDROID__)
+    char buf[PROPERTY_VALUE_MAX] = {0};
+    property_get(prop.name, buf, prop.def);
+    snprintf(value, VALUE_MAX_LEN, "%s", buf);
+#else
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", PROPERTY_WATCH_FAKE_DIR, prop.name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    int len = (fd >= 0) ? read(fd, value, VALUE_MAX_LEN - 1) : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (len < 0) {
+        snprintf(value, VALUE_MAX_LEN, "%s", prop.def);
+        return;
+    }
+    while (len > 0 && (value[len - 1] == '\n' || value[len - 1] == '\r')) {
+        len--;
+    }
+    value[len] = '\0';
+#endif
+}
+
+//false on timeout or stop
+bool CPropertyWatch::waitChange()
+{
+#if defined(__ANDROID__)
+    struct timespec timeout = {PROPERTY_WAIT_TIMEOUT_MS / 1000, (PROPERTY_WAIT_TIMEOUT_MS % 1000) * 1000000L};
+    bool changed = false;
+    uint32_t area = mSerial;
+    if (!exitPending() && __system_property_wait(NULL, mSerial, &area, &timeout)) {
+        mSerial = area;
+        //something changed, maybe a watched one. info and serial are only
+        //touched by the watch thread after start
+        for (int i = 0; i < mCount; i++) {
+            Property &prop = mProperties[i];
+            if (prop.info == NULL) {
+                //an unset property has no prop_info until it is first set
+                prop.info = __system_property_find(prop.name);
+                if (prop.info != NULL) {
+                    prop.serial = __system_property_serial(prop.info);
+                    changed = true;
+                }
+                continue;
+            }
+            uint32_t serial = __system_property_serial(prop.info);
+            if (serial != prop.serial) {
+                prop.serial = serial;
+                changed = true;
+            }
+        }
+    }
+#else
+    struct pollfd fds[2];
+    fds[0].fd = mNotifyFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = mStopFd;
+    fds[1].events = POLLIN;
+    bool changed = false;
+    if (poll(fds, 2, -1) > 0 && (fds[0].revents & POLLIN)) {
+        char events[1024];
+        while (read(mNotifyFd, events, sizeof(events)) > 0) {
+        }
+        changed = true;
+    }
+#endif
+    AutoMutex _l(mLock);
+    mWakeCount++;
+    return changed;
+}
+
+void CPropertyWatch::checkChanges()
+{
+    char values[MAX_PROPERTIES][VALUE_MAX_LEN];
+    bool fire[MAX_PROPERTIES];
+    int count;
+    {
+        AutoMutex _l(mLock);
+        count = mCount;
+        for (int i = 0; i < count; i++) {
+            readProperty(mProperties[i], values[i]);
+            fire[i] = !mProperties[i].valid || strcmp(mProperties[i].value, values[i]) != 0;
+            if (fire[i]) {
+                memcpy(mProperties[i].value, values[i], VALUE_MAX_LEN);
+                mProperties[i].valid = true;
+            }
+        }
+    }
+
+    AutoMutex _l(mObserverLock);
+    for (int i = 0; i < count; i++) {
+        if (fire[i] && mpObserver != NULL && !exitPending()) {
+            mpObserver->onPropertyChanged(mProperties[i].name, values[i]);
+        }
+    }
+}
+
+bool CPropertyWatch::threadLoop()
+{
+    checkChanges();
+    while (!exitPending()) {
+        if (waitChange()) {
+            checkChanges();
+        }
+    }
+
+    LOGD("%s, exiting...\n", "CPropertyWatch");
+    return false;
+}
+
+int CPropertyWatch::getValue(const char *name, char *value, int size)
+{
+    AutoMutex _l(mLock);
+    for (int i = 0; i < mCount; i++) {
+        if (strcmp(mProperties[i].name, name) == 0) {
+            snprintf(value, size, "%s", mProperties[i].valid ? mProperties[i].value : mProperties[i].def);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int CPropertyWatch::getWakeCount()
+{
+    AutoMutex _l(mLock);
+    return mWakeCount;
+}
@@ -10,6 +10,7 @@
 #define LOG_TAG "tvserver"
 #define LOG_TV_TAG "CSqlite"
 
+#include <strings.h>
 #include "include/CSqlite.h"
 #include "include/CTvLog.h"
 
@@ -18,11 +19,18 @@ using namespace android;
 CSqlite::CSqlite()
 {
     mHandle = NULL;
+    mWriterHandle = NULL;
+    mPostedSeq = 0;
+    mDoneSeq = 0;
+    mCheckpoint = false;
+    mReaderCount = 0;
+    mWriterExit = false;
 }
 
 CSqlite::~CSqlite()
 {
 #ifdef SUPPORT_ADTV
+    stopWal();
     if (mHandle != NULL) {
         sqlite3_close(mHandle);
         mHandle = NULL;
@@ -62,6 +70,7 @@ int CSqlite::openDb(const char *path)
         mHandle = NULL;
         return -1;
     }
+    setupWal();
 #endif
     return 0;
 }
@@ -70,6 +79,7 @@ int CSqlite::closeDb()
 {
     int rval = 0;
 #ifdef SUPPORT_ADTV
+    stopWal();
     if (mHandle != NULL) {
         rval = sqlite3_close(mHandle);
         mHandle = NULL;
@@ -80,7 +90,252 @@ int CSqlite::closeDb()
 
 void CSqlite::setHandle(sqlite3 *h)
 {
+    if (h == mHandle)
+        return;
+    stopWal();
     mHandle = h;
+    if (mHandle != NULL)
+        setupWal();
+}
+
+//wal lets the readers go on while the writer commits. Checkpoints are left to
+//the writer thread instead of whichever connection commits past the limit.
+void CSqlite::setupWal()
+{
+#ifdef SUPPORT_ADTV
+    const char *path = sqlite3_db_filename(mHandle, "main");
+    if (path == NULL || path[0] == '\0')
+        return;
+
+    char **result = NULL;
+    int row = 0, col = 0;
+    bool wal = sqlite3_get_table(mHandle, "PRAGMA journal_mode=WAL;", &result, &row, &col, NULL) == SQLITE_OK
+               && row == 1 && result[1] != NULL && strcasecmp(result[1], "wal") == 0;
+    if (result != NULL)
+        sqlite3_free_table(result);
+    if (!wal) {
+        LOGE("%s, wal not supported by %s", __FUNCTION__, path);
+        return;
+    }
+
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA journal_size_limit=%d;", SQLITE_WAL_SIZE_LIMIT);
+    sqlite3_busy_timeout(mHandle, SQLITE_BUSY_TIMEOUT_MS);
+    sqlite3_exec(mHandle, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+    sqlite3_exec(mHandle, sql, NULL, NULL, NULL);
+    if (sqlite3_open_v2(path, &mWriterHandle, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+        LOGE("%s, open writer of %s failed", __FUNCTION__, path);
+        sqlite3_close(mWriterHandle);
+        mWriterHandle = NULL;
+        return;
+    }
+    sqlite3_busy_timeout(mWriterHandle, SQLITE_BUSY_TIMEOUT_MS);
+    sqlite3_exec(mWriterHandle, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL);
+    sqlite3_wal_hook(mHandle, walHook, this);
+    sqlite3_wal_hook(mWriterHandle, walHook, this);
+
+    AutoMutex _l(mWalLock);
+    mPath = String8(path);
+    mWriter = new Writer(this);
+    mWriter->run("CSqliteWriter");
+    LOGD("%s, %s in wal mode", __FUNCTION__, path);
+#endif
+}
+
+//posted writes are committed before it returns
+void CSqlite::stopWal()
+{
+#ifdef SUPPORT_ADTV
+    sp<Writer> writer;
+    {
+        AutoMutex _l(mWalLock);
+        writer = mWriter;
+    }
+    if (writer == NULL)
+        return;
+
+    //writerLoop returns false once the queue is drained
+    {
+        AutoMutex _l(mWalLock);
+        mWriterExit = true;
+        mWriterCond.signal();
+    }
+    writer->join();
+    //the hook runs under the mutex of the connection and takes mWalLock
+    if (mHandle != NULL)
+        sqlite3_wal_hook(mHandle, NULL, NULL);
+
+    AutoMutex _l(mWalLock);
+    mWriter.clear();
+    mWriterExit = false;
+    mPending.clear();
+    mDoneSeq = mPostedSeq;
+    mDoneCond.broadcast();
+    while ((int)mIdleReaders.size() < mReaderCount)
+        mReaderCond.wait(mWalLock);
+    for (size_t i = 0; i < mIdleReaders.size(); i++)
+        sqlite3_close(mIdleReaders[i]);
+    mIdleReaders.clear();
+    mReaderCount = 0;
+    sqlite3_close(mWriterHandle);
+    mWriterHandle = NULL;
+#endif
+}
+
+int CSqlite::walHook(void *data, sqlite3 *h __unused, const char *db __unused, int pages)
+{
+    CSqlite *self = (CSqlite *)data;
+    if (pages >= SQLITE_WAL_CHECKPOINT_PAGES) {
+        AutoMutex _l(self->mWalLock);
+        self->mCheckpoint = true;
+        self->mWriterCond.signal();
+    }
+    return SQLITE_OK;
+}
+
+bool CSqlite::writerLoop()
+{
+#ifdef SUPPORT_ADTV
+    Vector<String8> batch;
+    bool checkpoint;
+    {
+        AutoMutex _l(mWalLock);
+        while (mPending.isEmpty() && !mCheckpoint && !mWriterExit)
+            mWriterCond.wait(mWalLock);
+        //on exit the queue is drained first
+        if (mPending.isEmpty() && !mCheckpoint)
+            return false;
+        if (!mPending.isEmpty() && mPending.size() < SQLITE_WRITER_BATCH && !mWriterExit)
+            mWriterCond.waitRelative(mWalLock, (nsecs_t)SQLITE_WRITER_LINGER_MS * 1000000);
+        size_t count = mPending.size() < SQLITE_WRITER_BATCH ? mPending.size() : SQLITE_WRITER_BATCH;
+        for (size_t i = 0; i < count; i++)
+            batch.push_back(mPending[i]);
+        if (count > 0)
+            mPending.removeItemsAt(0, count);
+        checkpoint = mCheckpoint;
+        mCheckpoint = false;
+    }
+
+    if (!batch.isEmpty())
+        writeBatch(batch);
+    if (checkpoint)
+        sqlite3_wal_checkpoint_v2(mWriterHandle, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+
+    AutoMutex _l(mWalLock);
+    mDoneSeq += batch.size();
+    mDoneCond.broadcast();
+#endif
+    return true;
+}
+
+//busy past SQLITE_WRITER_BUSY_RETRY timeouts, the batch is dropped rather
+//than blocking every later write and the readers waiting on them
+int CSqlite::writeBatch(const Vector<String8> &batch)
+{
+#ifdef SUPPORT_ADTV
+    char *errmsg = NULL;
+    int rval;
+    int retry = 0;
+    while ((rval = sqlite3_exec(mWriterHandle, "begin immediate;", NULL, NULL, NULL)) == SQLITE_BUSY
+           && ++retry < SQLITE_WRITER_BUSY_RETRY)
+        LOGE("%s, db busy, retry %zu writes", __FUNCTION__, batch.size());
+    if (rval == SQLITE_BUSY) {
+        LOGE("%s, db still busy, %zu writes dropped", __FUNCTION__, batch.size());
+        return -1;
+    }
+    if (rval != SQLITE_OK)
+        LOGE("%s, begin failed(%s), %zu writes without transaction", __FUNCTION__,
+             sqlite3_errmsg(mWriterHandle), batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+        if (sqlite3_exec(mWriterHandle, batch[i].string(), NULL, NULL, &errmsg) != SQLITE_OK) {
+            LOGE("%s, %s failed(%s)", __FUNCTION__, batch[i].string(), errmsg ? errmsg : "Unknown");
+            sqlite3_free(errmsg);
+            errmsg = NULL;
+        }
+    }
+    if (rval != SQLITE_OK)
+        return 0;
+    retry = 0;
+    while ((rval = sqlite3_exec(mWriterHandle, "commit;", NULL, NULL, NULL)) == SQLITE_BUSY
+           && ++retry < SQLITE_WRITER_BUSY_RETRY)
+        LOGE("%s, db busy, retry commit of %zu writes", __FUNCTION__, batch.size());
+    if (rval != SQLITE_OK) {
+        LOGE("%s, commit of %zu writes failed(%s), dropped", __FUNCTION__, batch.size(),
+             sqlite3_errmsg(mWriterHandle));
+        sqlite3_exec(mWriterHandle, "rollback;", NULL, NULL, NULL);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+bool CSqlite::postSql(const char *sql)
+{
+    if (sql == NULL)
+        return false;
+    //inside a transaction of the main connection the writer could only wait
+    //for its commit, the write joins the transaction instead
+    if (mHandle != NULL && sqlite3_get_autocommit(mHandle)) {
+        AutoMutex _l(mWalLock);
+        //a producer faster than the disk waits instead of growing the queue
+        while (mWriter != NULL && !mWriterExit && mPending.size() >= SQLITE_WRITER_QUEUE_MAX)
+            mDoneCond.wait(mWalLock);
+        if (mWriter != NULL && !mWriterExit) {
+            mPending.push_back(String8(sql));
+            mPostedSeq++;
+            mWriterCond.signal();
+            return true;
+        }
+    }
+    return exeSql(sql);
+}
+
+void CSqlite::waitWritesLocked(int64_t seq)
+{
+    while (mDoneSeq < seq && mWriter != NULL) {
+        //somebody waits, no use lingering for more writes
+        mWriterCond.signal();
+        mDoneCond.wait(mWalLock);
+    }
+}
+
+void CSqlite::flush()
+{
+    AutoMutex _l(mWalLock);
+    waitWritesLocked(mPostedSeq);
+}
+
+//NULL when not in wal mode
+sqlite3 *CSqlite::acquireReader()
+{
+    AutoMutex _l(mWalLock);
+    waitWritesLocked(mPostedSeq);
+    while (mWriter != NULL) {
+        if (!mIdleReaders.isEmpty()) {
+            sqlite3 *h = mIdleReaders.top();
+            mIdleReaders.pop();
+            return h;
+        }
+        if (mReaderCount < SQLITE_READER_COUNT) {
+            sqlite3 *h = NULL;
+            if (sqlite3_open_v2(mPath.string(), &h, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK) {
+                sqlite3_close(h);
+                return NULL;
+            }
+            sqlite3_busy_timeout(h, SQLITE_BUSY_TIMEOUT_MS);
+            mReaderCount++;
+            return h;
+        }
+        mReaderCond.wait(mWalLock);
+    }
+    return NULL;
+}
+
+void CSqlite::releaseReader(sqlite3 *h)
+{
+    AutoMutex _l(mWalLock);
+    mIdleReaders.push_back(h);
+    mReaderCond.signal();
 }
 
 sqlite3 *CSqlite::getHandle()
@@ -99,7 +354,12 @@ int CSqlite::select(const char *sql, CSqlite::Cursor &c)
     if (strncmp(sql, "select", 6))
         return -1;
     //LOGD("sql=%s", sql);
-    if (sqlite3_get_table(mHandle, sql, &pResult, &row, &col, &errmsg) != SQLITE_OK) {
+    //inside a transaction only the main connection sees its writes
+    sqlite3 *reader = sqlite3_get_autocommit(mHandle) ? acquireReader() : NULL;
+    int rval = sqlite3_get_table(reader ? reader : mHandle, sql, &pResult, &row, &col, &errmsg);
+    if (reader != NULL)
+        releaseReader(reader);
+    if (rval != SQLITE_OK) {
         LOGD("errmsg=%s", errmsg);
         if (pResult != NULL)
             sqlite3_free_table(pResult);
@@ -121,6 +381,12 @@ bool CSqlite::exeSql(const char *sql)
 #ifdef SUPPORT_ADTV
     char *errmsg;
     if (sql == NULL) return false;
+    //after every write posted so far, whichever thread posted it. Not inside
+    //a transaction, the writer would wait for its commit.
+    if (mHandle != NULL && sqlite3_get_autocommit(mHandle)) {
+        AutoMutex _l(mWalLock);
+        waitWritesLocked(mPostedSeq);
+    }
     if (sqlite3_exec(mHandle, sql, NULL, NULL, &errmsg) != SQLITE_OK) {
         //LOGE("exeSql=: %s error=%s", sql, errmsg ? errmsg : "Unknown");
         if (errmsg)
@@ -20,9 +20,22 @@
 #define CC_MAX_FILE_PATH_LEN       (256)
 
 #define BUFFER_SIZE 1024
+#define COPY_BUFFER_SIZE           (64 * 1024)
+#define COPY_CHUNK_SIZE            (1024 * 1024)
+
+//bytes copied so far, return non zero to cancel the copy
+typedef int (*CopyProgressCb)(long long done, long long total, void *user);
 
 class CFile {
 public:
+    enum {
+        COPY_SYNC = 0x1,
+        //copy to a temp file renamed over the destination
+        COPY_ATOMIC = 0x2,
+        //compare the crc32 of both files after the copy
+        COPY_VERIFY = 0x4,
+    };
+
     CFile(const char *path);
     CFile();
     virtual ~CFile();
@@ -30,7 +43,10 @@ public:
     virtual int closeFile();
     virtual int writeFile(const unsigned char *pData, int uLen);
     virtual int readFile(void *pBuf, int uLen);
-    int copyTo(const char *dstPath);
+    int copyTo(const char *dstPath, int flags = COPY_SYNC, CopyProgressCb progress = NULL, void *user = NULL);
+    //copy_file_range, then sendfile, then read/write, whichever the filesystems allow
+    static int copyFile(const char *srcPath, const char *dstPath, int flags = COPY_SYNC,
+                        CopyProgressCb progress = NULL, void *user = NULL);
     static int delFile(const char *path);
     static int  getFileAttrValue(const char *path);
     static int  setFileAttrValue(const char *path, int value);
@@ -47,6 +63,10 @@ public:
         return mFd;
     };
 protected:
+    static int copyFd(int srcFd, const char *dstPath, int flags, CopyProgressCb progress, void *user);
+    static long long copyData(int srcFd, int dstFd, long long total, CopyProgressCb progress, void *user);
+    static int crcFd(int fd, long long total, unsigned int *crc);
+
     char mPath[CC_MAX_FILE_PATH_LEN];
     int  mFd;
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#ifndef C_FLASH_DEVICE_H
+#define C_FLASH_DEVICE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define FLASH_SPI_DEVICE            "/dev/mtd/mtd0"
+#define FLASH_CACHE_PAGES           8
+#define FLASH_MAX_DEVICES           4
+
+//a flash device kept open: an mtd partition, a block device or a plain file.
+//Reads come from the mapping when the driver allows mmap, else from a small
+//LRU cache of erase block sized pages. Writes are read-modify-write per erase
+//block. Nor flash is erased only when a bit has to go from 0 to 1, nand pages
+//can be programmed once so a changed nand block is always erased and rewritten.
+class CFlashDevice {
+public:
+    //shared instance of a device, opened on first use
+    static CFlashDevice *get(const char *path);
+    static CFlashDevice *getSpiFlash()
+    {
+        return get(FLASH_SPI_DEVICE);
+    }
+
+    CFlashDevice(const char *path);
+    ~CFlashDevice();
+
+    //bytes read, -1 on error
+    int read(unsigned int offset, unsigned int length, unsigned char *buffer);
+    //bytes written, -1 on error
+    int write(unsigned int offset, unsigned int length, const unsigned char *buffer);
+    //drop the cached pages, the device stays open
+    void dropCache();
+
+    bool isMtd() const
+    {
+        return mIsMtd;
+    }
+    bool isNand() const
+    {
+        return mIsNand;
+    }
+    unsigned int getEraseSize() const
+    {
+        return mEraseSize;
+    }
+    uint64_t getSize() const
+    {
+        return mSize;
+    }
+    void getStats(unsigned int *hits, unsigned int *misses);
+
+private:
+    struct Page {
+        unsigned int base;
+        unsigned int lru;
+        unsigned char *data;
+    };
+
+    int openLocked();
+    int readDeviceLocked(unsigned int offset, unsigned int length, unsigned char *buffer);
+    Page *getPageLocked(unsigned int base);
+    int writeBlockLocked(unsigned int base, unsigned int offset, unsigned int length, const unsigned char *buffer);
+    int eraseBlockLocked(unsigned int base);
+    void dropCacheLocked();
+
+    static pthread_mutex_t sDevicesLock;
+    static CFlashDevice *sDevices[FLASH_MAX_DEVICES];
+
+    char mPath[256];
+    int mFd;
+    bool mIsMtd;
+    bool mIsNand;
+    unsigned int mEraseSize;
+    uint64_t mSize;
+    unsigned char *mMap;
+    Page mPages[FLASH_CACHE_PAGES];
+    unsigned int mLruClock;
+    unsigned int mHits;
+    unsigned int mMisses;
+    pthread_mutex_t mLock;
+};
+#endif
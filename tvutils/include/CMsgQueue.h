@@ -29,6 +29,7 @@ public:
     CMsgQueueThread();
     virtual ~CMsgQueueThread();
     int startMsgQueue();
+    void stopMsgQueue();
     void sendMsg(CMessage &msg);
     void removeMsg(CMessage &msg);
     void clearMsg();
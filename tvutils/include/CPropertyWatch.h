@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#ifndef C_PROPERTY_WATCH_H
+#define C_PROPERTY_WATCH_H
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#if defined(__ANDROID__)
+#include <sys/system_properties.h>
+#endif
+
+//without bionic, properties are the files of this directory
+#define PROPERTY_WATCH_FAKE_DIR     "/tmp/tvserver_props"
+
+using namespace android;
+
+//sleeps until a watched property changes and calls the observer once per
+//change of a watched property, never for an unchanged value. The first call
+//of each property gives its value at start.
+class CPropertyWatch: public Thread {
+public:
+    static const int MAX_PROPERTIES = 8;
+    static const int NAME_MAX_LEN = 64;
+    static const int VALUE_MAX_LEN = 92;
+
+    class IObserver {
+    public:
+        IObserver() {};
+        virtual ~IObserver() {};
+        virtual void onPropertyChanged(const char *name, const char *value) = 0;
+    };
+
+    CPropertyWatch();
+    ~CPropertyWatch();
+
+    void setObserver(IObserver *pOb)
+    {
+        AutoMutex _l(mObserverLock);
+        mpObserver = pOb;
+    };
+    //before startWatch, def is the value of an unset property
+    int addProperty(const char *name, const char *def);
+    int startWatch();
+    //no callback runs once it returns, the thread itself may take until the
+    //next property change to exit
+    int stopWatch();
+    //last value delivered
+    int getValue(const char *name, char *value, int size);
+    int getWakeCount();
+
+private:
+    struct Property {
+        char name[NAME_MAX_LEN];
+        char def[VALUE_MAX_LEN];
+        char value[VALUE_MAX_LEN];
+        bool valid;
+#if defined(__ANDROID__)
+        const prop_info *info;
+        uint32_t serial;
+#endif
+    };
+
+    bool threadLoop();
+    void readProperty(const Property &prop, char *value);
+    bool waitChange();
+    void checkChanges();
+
+    IObserver *mpObserver;
+    Property mProperties[MAX_PROPERTIES];
+    int mCount;
+    unsigned int mSerial;
+    int mNotifyFd;
+    int mStopFd;
+    int mWakeCount;
+    mutable Mutex mLock;
+    //held while the observer is called
+    Mutex mObserverLock;
+};
+#endif
@@ -11,10 +11,29 @@
 #define _CSQLITE_H_
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <utils/String8.h>
 #include <utils/Vector.h>
 #include <utils/RefBase.h>
+#include <utils/Thread.h>
+#include <utils/Mutex.h>
+#include <utils/Condition.h>
 #include <sqlite3.h>
+
+//wal pages after which the writer thread checkpoints
+#define SQLITE_WAL_CHECKPOINT_PAGES     1000
+#define SQLITE_WAL_SIZE_LIMIT           (4 * 1024 * 1024)
+#define SQLITE_BUSY_TIMEOUT_MS          3000
+//read only connections of select
+#define SQLITE_READER_COUNT             4
+//statements of one writer transaction at most
+#define SQLITE_WRITER_BATCH             256
+#define SQLITE_WRITER_QUEUE_MAX         (4 * SQLITE_WRITER_BATCH)
+//lets a burst of posted writes share a transaction
+#define SQLITE_WRITER_LINGER_MS         10
+//busy timeouts a batch waits out before it is dropped
+#define SQLITE_WRITER_BUSY_RETRY        3
+
 using namespace android;
 class CSqlite {
 public:
@@ -164,6 +183,13 @@ public:
     bool integrityCheck();
     int select(const char *sql, Cursor &);
     bool exeSql(const char *sql);
+    //run later by the writer thread, grouped with other posted writes in one
+    //transaction. For writes nobody checks the result of; a select or exeSql
+    //of any thread waits for the writes posted before it. Statements that
+    //must commit together go in one sql string.
+    bool postSql(const char *sql);
+    //every write posted so far is committed
+    void flush();
     void insert();
     void del();
     void update();
@@ -176,7 +202,45 @@ public:
         sync();
     };
 private:
+    class Writer: public Thread {
+    public:
+        Writer(CSqlite *owner)
+        {
+            mpOwner = owner;
+        }
+    private:
+        bool threadLoop()
+        {
+            return mpOwner->writerLoop();
+        }
+        CSqlite *mpOwner;
+    };
+
     static int  sqlite3_exec_callback(void *data, int nColumn, char **colValues, char **colNames);
+    static int walHook(void *data, sqlite3 *h, const char *db, int pages);
+    void setupWal();
+    void stopWal();
+    bool writerLoop();
+    int writeBatch(const Vector<String8> &batch);
+    void waitWritesLocked(int64_t seq);
+    sqlite3 *acquireReader();
+    void releaseReader(sqlite3 *h);
+
     sqlite3 *mHandle;
+    //wal mode only
+    sqlite3 *mWriterHandle;
+    sp<Writer> mWriter;
+    Vector<String8> mPending;
+    int64_t mPostedSeq;
+    int64_t mDoneSeq;
+    bool mCheckpoint;
+    bool mWriterExit;
+    Vector<sqlite3 *> mIdleReaders;
+    int mReaderCount;
+    String8 mPath;
+    Mutex mWalLock;
+    Condition mWriterCond;
+    Condition mDoneCond;
+    Condition mReaderCond;
 };
 #endif //CSQLITE
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2014 Amlogic, Inc. All rights reserved.
+ *
+ * This source code is subject to the terms and conditions defined in the
+ * file 'LICENSE' which is part of this source code package.
+ *
+ * Description: header file
+ */
+
+#if !defined(_CSTRINGTABLE_H_)
+#define _CSTRINGTABLE_H_
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+//index <-> name of a fixed array of names. The seed of the hash is searched
+//once so that every name has a slot of its own, a lookup is one hash and one
+//strcmp. For a repeated name the first index.
+class CStringTable {
+public:
+    template<size_t N, size_t L>
+    CStringTable(const char (&names)[N][L])
+    {
+        mNames = names[0];
+        mStride = L;
+        mCount = N;
+        size_t slots = 4;
+        while (slots < 2 * N) {
+            slots <<= 1;
+        }
+        for (mSeed = 0; !build(slots); mSeed++) {
+            if (mSeed == MAX_SEEDS) {
+                mSeed = 0;
+                slots <<= 1;
+            }
+        }
+    }
+
+    //-1 for NULL or a name not in the table
+    int indexOf(const char *name) const
+    {
+        if (name == NULL)
+            return -1;
+        int index = mSlots[hash(name) & mMask];
+        return (index >= 0 && strcmp(nameAt(index), name) == 0) ? index : -1;
+    }
+
+    const char *nameOf(int index, const char *def = NULL) const
+    {
+        return (index >= 0 && (size_t)index < mCount) ? nameAt(index) : def;
+    }
+
+    int size() const
+    {
+        return mCount;
+    }
+
+private:
+    static const unsigned int MAX_SEEDS = 256;
+
+    const char *nameAt(int index) const
+    {
+        return mNames + index * mStride;
+    }
+
+    //fnv-1a
+    unsigned int hash(const char *name) const
+    {
+        unsigned int h = 2166136261u ^ (mSeed * 0x9e3779b9u);
+        for (const unsigned char *p = (const unsigned char *)name; *p != '\0'; p++) {
+            h = (h ^ *p) * 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    bool build(size_t slots)
+    {
+        mSlots.assign(slots, -1);
+        mMask = slots - 1;
+        for (size_t i = 0; i < mCount; i++) {
+            int &slot = mSlots[hash(nameAt(i)) & mMask];
+            if (slot >= 0 && strcmp(nameAt(slot), nameAt(i)) != 0)
+                return false;
+            if (slot < 0)
+                slot = i;
+        }
+        return true;
+    }
+
+    const char *mNames;
+    size_t mStride;
+    size_t mCount;
+    unsigned int mSeed;
+    unsigned int mMask;
+    std::vector<int> mSlots;
+};
+#endif //_CSTRINGTABLE_H_
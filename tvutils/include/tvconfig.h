@@ -62,6 +62,15 @@
 #define CFG_DTV_CHECK_SCRAMBLE_AV               "dtv.check.scramble.av"
 #define CFG_DTV_CHECK_DATA_AUDIO                "dtv.check.data.audio"
 #define CFG_DTV_SCAN_STOREMODE_VALIDPID         "dtv.scan.skip.invalidpid"
+#define CFG_DTV_SCAN_HISTORY_ENABLE             "dtv.scan.history.enable"
+#define CFG_DTV_SCAN_HISTORY_PATH               "dtv.scan.history.path"
+#define CFG_DTV_SCAN_HISTORY_SKIP_MISS          "dtv.scan.history.skip.miss"
+#define CFG_DTV_EPG_BATCH_MS                    "dtv.epg.batch.ms"
+#define CFG_DTV_VCHIP_CHECK_ENABLE              "dtv.vchip.check.enable"
+#define CFG_DTV_VCHIP_UNLOCK_TIMEOUT            "dtv.vchip.unlock.timeout"
+#define CFG_DTV_TEXT_LANGS                      "dtv.text.langs"
+#define CFG_DTV_ATSC_HUFFMAN_TITLE              "dtv.atsc.huffman.title"
+#define CFG_DTV_ATSC_HUFFMAN_DESC               "dtv.atsc.huffman.desc"
 
 #define CFG_TVIN_KERNELPET_DISABLE              "tvin.kernelpet_disable"
 #define CFG_TVIN_KERNELPET_TIMEROUT             "tvin.kernelpet.timeout"
@@ -124,6 +133,7 @@
 
 #define FRONTEND_TS_SOURCE                      "frontend.ts.source"
 #define FRONTEND_DTV_DEVICE                     "frontend.dtv.device"
+#define FRONTEND_SAMPLER_STALE_MS               "frontend.sampler.stale.ms"
 
 extern int tv_config_load(const char *file_name);
 extern int tv_config_unload();
@@ -36,6 +36,7 @@
 #include "include/tvconfig.h"
 #include "include/tvutils.h"
 #include "include/CTvLog.h"
+#include "include/CFlashDevice.h"
 
 #include <vector>
 #include <map>
@@ -1259,35 +1260,13 @@ int tvSpiOpen(void) {
     return fd;
 }
 int tvSpiRead(unsigned int offset, unsigned int ulength, unsigned char *pubuf) {
-    int err = -1;
-    int fd = tvSpiOpen();
-
-    if (fd < 0) {
-        LOGE("%s:fd < 0!\n", __FUNCTION__);
-        return -1;
-    }
-    if (NULL == pubuf) {
-        LOGE("%s:pbuf is NULL!\n", __FUNCTION__);
-        close(fd);
-        return -1;
-    }
-    if (offset != (unsigned int)lseek (fd, offset, SEEK_SET)) {
-        LOGE("%s lseek error(%s)!\n", __FUNCTION__, strerror(errno));
-        close(fd);
+    //kept open and cached, panel tables read the same flash area many times
+    CFlashDevice *dev = CFlashDevice::getSpiFlash();
+    if (dev == NULL) {
         return -1;
     }
 
-    err = read (fd, pubuf, ulength);
-    if (err < 0) {
-        LOGE("%s read error(%s)!\n", __FUNCTION__, strerror(errno));
-        close(fd);
-        return -1;
-    }
-
-    LOGD("%s:read success!\n", __FUNCTION__);
-    close(fd);
-    return err;
-
+    return dev->read(offset, ulength, pubuf);
 }
 
 int tvSpiRead(int fd, unsigned int offset, unsigned int ulength, unsigned char *pubuf) {
@@ -1342,6 +1321,15 @@ int tvSpiwrite(int fd, unsigned int offset, unsigned int ulength, unsigned char
     return err;
 }
 
+//partitions go through CFlashDevice, plain files keep the open/read path
+static bool isFlashDevice(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    return S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode);
+}
+
 int tvFlashRead(const char *partition_name, long offset,unsigned char *buffer, unsigned int length) {
     int fd = -1;
     if (partition_name == NULL || buffer == NULL) {
@@ -1353,6 +1341,13 @@ int tvFlashRead(const char *partition_name, long offset,unsigned char *buffer, u
         return -1;
     }
     LOGD("%s, partition_name = %s, offset = %ld, read_length = %d", __FUNCTION__, partition_name, offset, length);
+    if (isFlashDevice(partition_name)) {
+        CFlashDevice *dev = CFlashDevice::get(partition_name);
+        if (dev == NULL || dev->read(offset, length, buffer) <= 0) {
+            return -1;
+        }
+        return 0;
+    }
     errno = 0;
     fd = open(partition_name, O_RDONLY);
     if (fd < 0) {
@@ -1387,6 +1382,13 @@ int tvFlashWrite(const char *partition_name, long offset,unsigned char *buffer,
         return -1;
     }
     LOGD("%s, partition_name = %s, offset = %ld, write_length = %d", __FUNCTION__, partition_name, offset, length);
+    if (isFlashDevice(partition_name)) {
+        CFlashDevice *dev = CFlashDevice::get(partition_name);
+        if (dev == NULL || dev->write(offset, length, buffer) < 0) {
+            return -1;
+        }
+        return 0;
+    }
     errno = 0;
     fd = open(partition_name, O_RDWR | O_SYNC | O_CREAT, S_IRUSR | S_IWUSR);
     if (fd < 0) {